@@ -0,0 +1,17 @@
+//glsl version 4.5
+#version 450
+
+layout( set = 1, binding = 0 ) uniform sampler2D fog;
+
+layout( location = 0 ) in vec2 fogUV;
+
+layout( location = 0 ) out vec4 outFragColor;
+
+void main()
+{
+	vec4 f = texture( fog, fogUV );
+
+	//Unexplored is nearly opaque, explored but out of sight is dimmed
+	float alpha = mix( mix( 0.95f, 0.55f, f.g ), 0.0f, f.r );
+	outFragColor = vec4( 0.0f, 0.0f, 0.0f, alpha );
+}
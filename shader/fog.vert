@@ -0,0 +1,28 @@
+//glsl version 4.5
+#version 450
+
+layout( location = 0 ) out vec2 fogUV;
+
+layout( set = 0, binding = 0 ) uniform CameraBuffer {
+	mat4 view;
+	mat4 proj;
+	mat4 view_proj;
+} cam_data;
+
+layout( push_constant ) uniform OverlayParams {
+	vec2 origin;
+	float size;
+	float height;
+} overlay;
+
+const vec2 corners[6] = vec2[](
+	vec2( 0.0, 0.0 ), vec2( 1.0, 0.0 ), vec2( 1.0, 1.0 ),
+	vec2( 1.0, 1.0 ), vec2( 0.0, 1.0 ), vec2( 0.0, 0.0 )
+);
+
+void main()
+{
+	vec2 xz = overlay.origin + corners[gl_VertexIndex] * overlay.size;
+	gl_Position = cam_data.view_proj * vec4( xz.x, overlay.height, xz.y, 1.0f );
+	fogUV = corners[gl_VertexIndex];
+}
@@ -0,0 +1,57 @@
+//glsl version 4.5
+#version 450
+
+layout( location = 0 ) in vec3 worldPos;
+
+layout( location = 0 ) out vec4 outFragColor;
+
+layout( push_constant ) uniform GridParams {
+	vec4 color;
+	vec4 cam_pos;
+	vec2 cell_size;
+	vec2 offset;
+	vec2 half_extent;
+	float line_width;
+	uint type;
+} grid;
+
+const vec2 HEX = vec2( 1.0f, 1.7320508f );
+
+//Offset from the closest hex center, hexes with an inner radius of 0.5
+vec2 hex_local( vec2 p ){
+	vec4 centers = floor( vec4( p, p - vec2( 0.5f, 1.0f )) / HEX.xyxy ) + 0.5f;
+	vec2 a = p - centers.xy * HEX;
+	vec2 b = p - ( centers.zw + 0.5f ) * HEX;
+	return dot( a, a ) < dot( b, b ) ? a : b;
+}
+
+float hex_dist( vec2 p ){
+	p = abs( p );
+	return max( dot( p, normalize( HEX )), p.x );
+}
+
+void main()
+{
+	vec2 coord = ( worldPos.xz - grid.offset ) / grid.cell_size;
+	vec2 px = fwidth( coord );
+
+	//Distance to the closest line, in pixels
+	float line;
+	if( grid.type == 1u ){
+		float edge = 0.5f - hex_dist( hex_local( coord ));
+		line = edge / max( px.x, px.y );
+	} else {
+		vec2 d = abs( fract( coord - 0.5f ) - 0.5f ) / px;
+		line = min( d.x, d.y );
+	}
+
+	//Wider filter further away from the camera, fade out before cells get smaller than a few pixels
+	float dist = length( worldPos - grid.cam_pos.xyz );
+	float aa = 1.0f + 2.0f * dist / grid.cam_pos.w;
+
+	float coverage = 1.0f - smoothstep( 0.5f * grid.line_width - 0.5f * aa, 0.5f * grid.line_width + 0.5f * aa, line );
+	float fade = ( 1.0f - smoothstep( 0.5f * grid.cam_pos.w, grid.cam_pos.w, dist ))
+		* clamp(( 1.0f / max( px.x, px.y ) - 2.0f ) / 4.0f, 0.0f, 1.0f );
+
+	outFragColor = vec4( grid.color.rgb, grid.color.a * coverage * fade );
+}
@@ -0,0 +1,33 @@
+//glsl version 4.5
+#version 450
+
+layout( location = 0 ) out vec3 worldPos;
+
+layout( set = 0, binding = 0 ) uniform CameraBuffer {
+	mat4 view;
+	mat4 proj;
+	mat4 view_proj;
+} cam_data;
+
+layout( push_constant ) uniform GridParams {
+	vec4 color;
+	vec4 cam_pos;		//xyz camera position, w distance at which the grid has faded out
+	vec2 cell_size;
+	vec2 offset;
+	vec2 half_extent;
+	float line_width;	//in pixels
+	uint type;			//0 square, 1 hex
+} grid;
+
+//Two triangles spanning the grid, no vertex buffer
+const vec2 corners[6] = vec2[](
+	vec2(-1.0,-1.0 ), vec2( 1.0,-1.0 ), vec2( 1.0, 1.0 ),
+	vec2( 1.0, 1.0 ), vec2(-1.0, 1.0 ), vec2(-1.0,-1.0 )
+);
+
+void main()
+{
+	vec2 xz = grid.offset + corners[gl_VertexIndex] * grid.half_extent;
+	worldPos = vec3( xz.x, 0.0f, xz.y );
+	gl_Position = cam_data.view_proj * vec4( worldPos, 1.0f );
+}
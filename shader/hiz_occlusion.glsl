@@ -0,0 +1,46 @@
+//Shared by the culling shaders, include with GL_GOOGLE_include_directive
+
+//True if the sphere lies behind everything the depth pyramid saw. view_proj is the camera the pyramid was built with
+bool hiz_occluded( sampler2D pyramid, mat4 view_proj, vec2 pyramid_size, vec4 bounds ){
+	vec3 ndc_min = vec3( 1.0 );
+	vec3 ndc_max = vec3( -1.0 );
+
+	for( int c = 0; c < 8; ++c ){
+		vec3 corner = bounds.xyz + bounds.w * vec3(
+				( c & 1 ) != 0 ? 1.0 : -1.0,
+				( c & 2 ) != 0 ? 1.0 : -1.0,
+				( c & 4 ) != 0 ? 1.0 : -1.0 );
+
+		vec4 clip = view_proj * vec4( corner, 1.0 );
+
+		//Crosses the near plane, no usable screen rect
+		if( clip.w <= 0.0 )
+			return false;
+
+		vec3 ndc = clip.xyz / clip.w;
+		ndc_min = min( ndc_min, ndc );
+		ndc_max = max( ndc_max, ndc );
+	}
+
+	//Not in the previous view, nothing is known about it
+	if( any( lessThan( ndc_min.xy, vec2( -1.0 ))) || any( greaterThan( ndc_max.xy, vec2( 1.0 ))))
+		return false;
+
+	vec2 uv_min = ndc_min.xy * 0.5 + 0.5;
+	vec2 uv_max = ndc_max.xy * 0.5 + 0.5;
+
+	//Mip where the rect spans at most 2 x 2 texels
+	vec2 size = ( uv_max - uv_min ) * pyramid_size;
+	float lod = ceil( log2( max( max( size.x, size.y ), 1.0 )));
+	lod = min( lod, float( textureQueryLevels( pyramid ) - 1 ));
+
+	ivec2 mip_size = textureSize( pyramid, int( lod ));
+	ivec2 t_min = clamp( ivec2( uv_min * vec2( mip_size )), ivec2( 0 ), mip_size - 1 );
+	ivec2 t_max = clamp( ivec2( uv_max * vec2( mip_size )), ivec2( 0 ), mip_size - 1 );
+
+	float farthest = max(
+			max( texelFetch( pyramid, t_min, int( lod )).g, texelFetch( pyramid, ivec2( t_max.x, t_min.y ), int( lod )).g ),
+			max( texelFetch( pyramid, ivec2( t_min.x, t_max.y ), int( lod )).g, texelFetch( pyramid, t_max, int( lod )).g ));
+
+	return ndc_min.z > farthest;
+}
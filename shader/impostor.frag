@@ -0,0 +1,19 @@
+//glsl version 4.5
+#version 450
+
+layout( set = 1, binding = 0 ) uniform sampler2D atlas;
+
+layout( location = 0 ) in vec2 atlasUV;
+
+layout( location = 0 ) out vec4 outFragColor;
+
+void main()
+{
+	vec4 c = texture( atlas, atlasUV );
+
+	//Cut out, so impostors sort with the rest of the scene through depth
+	if( c.a < 0.5f )
+		discard;
+
+	outFragColor = vec4( c.rgb, 1.0f );
+}
@@ -0,0 +1,71 @@
+//glsl version 4.5
+#version 450
+
+layout( location = 0 ) out vec2 atlasUV;
+
+layout( set = 0, binding = 0 ) uniform CameraBuffer {
+	mat4 view;
+	mat4 proj;
+	mat4 view_proj;
+} cam_data;
+
+struct Impostor {
+	mat4 transform;
+	vec4 sphere;		//Object space, what the slot was baked around
+	uint slot;
+	uint pad0;
+	uint pad1;
+	uint pad2;
+};
+
+//Written by indirect_cull.comp
+layout( std430, set = 1, binding = 1 ) readonly buffer Impostors {
+	Impostor impostors[];
+};
+
+//Keep in sync with ImpostorAtlas
+const uint TILE_SIZE = 64;
+const uint VIEWS = 8;
+const uint SLOTS_X = 4;
+const vec2 ATLAS_SIZE = vec2( 2048.0, 2048.0 );
+
+const vec2 corners[6] = vec2[](
+	vec2(-1.0,-1.0 ), vec2( 1.0,-1.0 ), vec2( 1.0, 1.0 ),
+	vec2( 1.0, 1.0 ), vec2(-1.0, 1.0 ), vec2(-1.0,-1.0 )
+);
+
+//Inverse of octahedral_decode() in VkImpostors.cpp
+vec2 octahedral_encode( vec3 d ){
+	d /= abs( d.x ) + abs( d.y ) + abs( d.z );
+
+	vec2 e = d.xz;
+	if( d.y < 0.0 )
+		e = ( 1.0 - abs( d.zx )) * vec2( d.x >= 0.0 ? 1.0 : -1.0, d.z >= 0.0 ? 1.0 : -1.0 );
+
+	return e * 0.5 + 0.5;
+}
+
+void main()
+{
+	Impostor imp = impostors[gl_InstanceIndex];
+	vec2 corner = corners[gl_VertexIndex];
+
+	//Direction to the camera in object space, the quad is built there like the bake view
+	vec3 cam_pos = -transpose( mat3( cam_data.view )) * cam_data.view[3].xyz;
+	vec3 to_cam = cam_pos - ( imp.transform * vec4( imp.sphere.xyz, 1.0 )).xyz;
+	vec3 dir = normalize( transpose( mat3( imp.transform )) * to_cam );
+
+	vec3 hint = abs( dir.y ) > 0.99 ? vec3( 0.0, 0.0, 1.0 ) : vec3( 0.0, 1.0, 0.0 );
+	vec3 right = normalize( cross( hint, dir ));
+	vec3 up = cross( dir, right );
+
+	vec3 pos = imp.sphere.xyz + ( corner.x * right + corner.y * up ) * imp.sphere.w;
+	gl_Position = cam_data.view_proj * imp.transform * vec4( pos, 1.0 );
+
+	//Tile of the view closest to the camera
+	uvec2 cell = min( uvec2( octahedral_encode( dir ) * float( VIEWS )), uvec2( VIEWS - 1 ));
+	uvec2 tile = uvec2( imp.slot % SLOTS_X, imp.slot / SLOTS_X ) * VIEWS + cell;
+
+	vec2 in_tile = vec2( corner.x * 0.5 + 0.5, 0.5 - corner.y * 0.5 );
+	atlasUV = ( vec2( tile ) + in_tile ) * float( TILE_SIZE ) / ATLAS_SIZE;
+}
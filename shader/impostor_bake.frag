@@ -0,0 +1,23 @@
+//glsl version 4.5
+#version 450
+
+layout( set = 0, binding = 0 ) uniform sampler2D tex1;
+
+layout( location = 0 ) in vec4 UV1UV2;
+layout( location = 1 ) in vec3 norm;
+
+layout( location = 0 ) out vec4 outFragColor;
+
+layout( push_constant ) uniform BakeParams {
+	mat4 view_proj;
+	vec4 light_dir;
+} bake;
+
+void main()
+{
+	vec3 albedo = texture( tex1, UV1UV2.xy ).xyz;
+
+	//Two sided like triangle.frag, the lights of the scene are not known here
+	float diffuse = abs( dot( normalize( norm ), bake.light_dir.xyz ));
+	outFragColor = vec4( albedo * ( 0.35f + 0.65f * diffuse ), 1.0f );
+}
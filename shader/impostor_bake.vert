@@ -0,0 +1,22 @@
+//glsl version 4.5
+#version 450
+
+layout( location = 0 ) in vec3 vPos;
+layout( location = 1 ) in vec3 vNorm;
+layout( location = 2 ) in vec3 vCol;
+layout( location = 3 ) in vec4 vUV1UV2;
+
+layout( location = 0 ) out vec4 fUV1UV2;
+layout( location = 1 ) out vec3 fNorm;
+
+layout( push_constant ) uniform BakeParams {
+	mat4 view_proj;		//Object space into one tile
+	vec4 light_dir;		//Object space
+} bake;
+
+void main()
+{
+	gl_Position = bake.view_proj * vec4( vPos, 1.0f );
+	fUV1UV2 = vUV1UV2;
+	fNorm = vNorm;
+}
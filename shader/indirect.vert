@@ -0,0 +1,60 @@
+//glsl version 4.5
+#version 450
+
+layout( location = 0 ) out vec3 fragCol;
+layout( location = 1 ) out vec4 fUV1UV2;
+layout( location = 2 ) out vec3 fViewPos;
+layout( location = 3 ) out vec3 fViewNorm;
+
+layout( set = 0, binding = 0 ) uniform CameraBuffer {
+	mat4 view;
+	mat4 proj;
+	mat4 view_proj;
+} cam_data;
+
+//Mesh vertices in the geometry arena, pulled like in triangle.vert
+layout( std430, set = 0, binding = 4 ) readonly buffer Vertices {
+	float vertices[];
+};
+
+const uint VERTEX_FLOATS = 13;
+
+vec3 pull_vec3( uint at ){
+	return vec3( vertices[at], vertices[at + 1], vertices[at + 2] );
+}
+
+struct Instance {
+	mat4 transform;
+	vec4 bounds;
+	uint batch;
+	float scale;
+	uint pad0;
+	uint pad1;
+};
+
+layout( std430, set = 2, binding = 0 ) readonly buffer Instances {
+	Instance instances[];
+};
+
+//Written by indirect_cull.comp, gl_InstanceIndex includes the batch's first instance
+layout( std430, set = 2, binding = 2 ) readonly buffer Visible {
+	uint visible[];
+};
+
+void main()
+{
+	uint at = uint( gl_VertexIndex ) * VERTEX_FLOATS;
+	vec3 vPos = pull_vec3( at );
+	vec3 vNorm = pull_vec3( at + 3 );
+	vec3 vCol = pull_vec3( at + 6 );
+	vec4 vUV1UV2 = vec4( pull_vec3( at + 9 ), vertices[at + 12] );
+
+	mat4 model_view = cam_data.view * instances[visible[gl_InstanceIndex]].transform;
+	vec4 view_pos = model_view * vec4( vPos, 1.0f );
+
+	gl_Position = cam_data.proj * view_pos;
+	fragCol = vCol;
+	fUV1UV2 = vUV1UV2;
+	fViewPos = view_pos.xyz;
+	fViewNorm = mat3( model_view ) * vNorm;
+}
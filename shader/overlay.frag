@@ -0,0 +1,15 @@
+//glsl version 4.5
+#version 450
+
+layout( set = 0, binding = 0 ) uniform sampler2D tex1;
+
+layout( location = 0 ) in vec2 fragUV;
+layout( location = 1 ) in vec4 fragCol;
+
+layout( location = 0 ) out vec4 outFragColor;
+
+void main()
+{
+	//Glyphs and shapes sample the white atlas, so this is just the vertex colour with coverage
+	outFragColor = texture( tex1, fragUV ) * fragCol;
+}
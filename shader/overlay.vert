@@ -0,0 +1,21 @@
+//glsl version 4.5
+#version 450
+
+layout( location = 0 ) in vec2 vPos;
+layout( location = 1 ) in vec2 vUV;
+layout( location = 2 ) in vec4 vCol;
+
+layout( location = 0 ) out vec2 fragUV;
+layout( location = 1 ) out vec4 fragCol;
+
+layout( push_constant ) uniform OverlayParams {
+	vec2 screen;	//Framebuffer size in pixels
+} overlay;
+
+void main()
+{
+	//Pixels with the origin in the top left corner, like Vulkan's viewport
+	gl_Position = vec4( vPos / overlay.screen * 2.0f - 1.0f, 0.0f, 1.0f );
+	fragUV = vUV;
+	fragCol = vCol;
+}
@@ -0,0 +1,15 @@
+//glsl version 4.5
+#version 450
+
+layout( location = 0 ) in vec3 facePos;
+
+layout( push_constant ) uniform ShadowParams {
+	mat4 model_view;
+	vec4 params;		//x near, y far
+} shadow;
+
+void main()
+{
+	//Distance instead of depth, so any face can be looked up with the same compare
+	gl_FragDepth = length( facePos ) / shadow.params.y;
+}
@@ -0,0 +1,22 @@
+//glsl version 4.5
+#version 450
+
+layout( location = 0 ) in vec3 vPos;
+
+layout( location = 0 ) out vec3 facePos;
+
+layout( push_constant ) uniform ShadowParams {
+	mat4 model_view;	//z along the face direction
+	vec4 params;		//x near, y far
+} shadow;
+
+void main()
+{
+	vec4 p = shadow.model_view * vec4( vPos, 1.0f );
+	float near = shadow.params.x;
+	float far = shadow.params.y;
+
+	//90 degree frustum, z between near and far mapped to [0, 1]
+	gl_Position = vec4( p.x, p.y, ( p.z - near ) * far / ( far - near ), p.z );
+	facePos = p.xyz;
+}
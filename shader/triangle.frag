@@ -1,17 +1,149 @@
 //glsl version 4.5
 #version 450
 
+//Keep in sync with ClusteredLights::MAX_LIGHTS_PER_CLUSTER
+#define MAX_LIGHTS_PER_CLUSTER 128u
+
+//Material features, one pipeline per combination. Keep the ids in sync with MaterialFeatures in VkEngine.hpp
+layout( constant_id = 0 ) const bool USE_TEXTURE = true;
+layout( constant_id = 1 ) const bool USE_VERTEX_COLOR = false;
+layout( constant_id = 2 ) const bool USE_LIGHTING = true;
+
 layout( set = 1, binding = 0 ) uniform sampler2D tex1;
 
+layout( set = 0, binding = 0 ) uniform CameraBuffer {
+	mat4 view;
+	mat4 proj;
+	mat4 view_proj;
+} cam_data;
+
+struct PointLight {
+	vec3 pos;		//View space
+	float radius;
+	vec3 color;
+	float intensity;
+	int shadow_slot;
+	float pad[3];
+};
+
+layout( std430, set = 0, binding = 1 ) readonly buffer Lights {
+	vec4 screen;	//xy framebuffer size, z cluster near, w cluster far
+	uvec4 grid;		//xyz cluster counts, w light count
+	vec4 ambient;
+	vec4 shadow;	//x face size, y slots per row, zw atlas size
+	PointLight lights[];
+} light_data;
+
+layout( std430, set = 0, binding = 2 ) readonly buffer Clusters {
+	uint cluster_data[];
+};
+
+//Distance / radius, one slot of 3 x 2 cube faces per shadowed light
+layout( set = 0, binding = 3 ) uniform sampler2D shadow_atlas;
+
+//Keep in sync with FACES in VkShadows.cpp
+const vec3 FACE_FWD[6] = vec3[](
+	vec3( 1.0, 0.0, 0.0 ), vec3( -1.0, 0.0, 0.0 ), vec3( 0.0, 1.0, 0.0 ),
+	vec3( 0.0, -1.0, 0.0 ), vec3( 0.0, 0.0, 1.0 ), vec3( 0.0, 0.0, -1.0 )
+);
+
+const vec3 FACE_RIGHT[6] = vec3[](
+	vec3( 0.0, 0.0, -1.0 ), vec3( 0.0, 0.0, 1.0 ), vec3( 1.0, 0.0, 0.0 ),
+	vec3( 1.0, 0.0, 0.0 ), vec3( 1.0, 0.0, 0.0 ), vec3( -1.0, 0.0, 0.0 )
+);
+
+const vec3 FACE_UP[6] = vec3[](
+	vec3( 0.0, -1.0, 0.0 ), vec3( 0.0, -1.0, 0.0 ), vec3( 0.0, 0.0, 1.0 ),
+	vec3( 0.0, 0.0, -1.0 ), vec3( 0.0, -1.0, 0.0 ), vec3( 0.0, -1.0, 0.0 )
+);
+
 layout( location = 0 ) in vec3 fragCol;
 layout( location = 1 ) in vec4 UV1UV2;
+layout( location = 2 ) in vec3 viewPos;
+layout( location = 3 ) in vec3 viewNorm;
 
 layout (location = 0) out vec4 outFragColor;
 
+uint cluster_of( vec2 frag, float depth ){
+	uvec3 grid = light_data.grid.xyz;
+	float near = light_data.screen.z;
+	float far = light_data.screen.w;
+
+	uint slice = uint( max( log( depth / near ) / log( far / near ) * float( grid.z ), 0.0f ));
+	uvec2 tile = uvec2( frag / light_data.screen.xy * vec2( grid.xy ));
+
+	slice = min( slice, grid.z - 1u );
+	tile = min( tile, grid.xy - 1u );
+
+	return tile.x + grid.x * ( tile.y + grid.y * slice );
+}
+
+//1 if the light reaches the fragment. to_frag is in view space
+float shadow_factor( PointLight light, vec3 to_frag ){
+#ifdef NO_SHADOWS
+	return 1.0f;
+#else
+	if( light.shadow_slot < 0 )
+		return 1.0f;
+
+	//The atlas is laid out in world space
+	vec3 d = transpose( mat3( cam_data.view )) * to_frag;
+	vec3 a = abs( d );
+
+	uint face = a.x >= a.y && a.x >= a.z ? ( d.x > 0.0f ? 0u : 1u )
+		: a.y >= a.z ? ( d.y > 0.0f ? 2u : 3u )
+		: ( d.z > 0.0f ? 4u : 5u );
+
+	vec2 ndc = vec2( dot( d, FACE_RIGHT[face] ), dot( d, FACE_UP[face] )) / dot( d, FACE_FWD[face] );
+
+	float face_size = light_data.shadow.x;
+	uint per_row = uint( light_data.shadow.y );
+	uint slot = uint( light.shadow_slot );
+
+	vec2 tile = vec2(( slot % per_row ) * 3u + face % 3u, ( slot / per_row ) * 2u + face / 3u );
+	vec2 texel = tile * face_size + clamp(( ndc * 0.5f + 0.5f ) * face_size, vec2( 0.5f ), vec2( face_size - 0.5f ));
+
+	float stored = texture( shadow_atlas, texel / light_data.shadow.zw ).r;
+	return length( d ) / light.radius - 0.01f <= stored ? 1.0f : 0.0f;
+#endif
+}
+
 void main()
 {
-	//outFragColor = vec4( fragCol, 1.0f );
-	//outFragColor = vec4( UV1UV2.xy, 0.0f, 1.0f );
-	outFragColor = vec4( texture( tex1, UV1UV2.xy ).xyz, 1.0f );
-}
+	vec3 albedo = USE_TEXTURE ? texture( tex1, UV1UV2.xy ).xyz : vec3( 1.0f );
+	if( USE_VERTEX_COLOR )
+		albedo *= fragCol;
+
+	if( !USE_LIGHTING ){
+		outFragColor = vec4( albedo, 1.0f );
+		return;
+	}
 
+	//Tokens are two sided, light the side facing the camera
+	vec3 n = normalize( viewNorm );
+	if( dot( n, viewPos ) > 0.0f )
+		n = -n;
+
+	uvec3 grid = light_data.grid.xyz;
+	uint cluster = cluster_of( gl_FragCoord.xy, -viewPos.z );
+	uint count = cluster_data[cluster];
+	uint base = grid.x * grid.y * grid.z + cluster * MAX_LIGHTS_PER_CLUSTER;
+
+	vec3 lit = light_data.ambient.rgb;
+
+	for( uint i = 0; i < count; ++i ){
+		PointLight light = light_data.lights[cluster_data[base + i]];
+
+		vec3 l = light.pos - viewPos;
+		float dist = length( l );
+		float falloff = clamp( 1.0f - dist / light.radius, 0.0f, 1.0f );
+
+		float diffuse = max( dot( n, l / max( dist, 1e-4f )), 0.0f );
+		if( diffuse == 0.0f || falloff == 0.0f )
+			continue;
+
+		lit += light.color * light.intensity * falloff * falloff * diffuse * shadow_factor( light, -l );
+	}
+
+	outFragColor = vec4( albedo * lit, 1.0f );
+}
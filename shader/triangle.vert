@@ -1,13 +1,10 @@
 //we will be using glsl version 4.5 syntax
 #version 450
 
-layout( location = 0 ) in vec3 vPos;
-layout( location = 1 ) in vec3 vNorm;
-layout( location = 2 ) in vec3 vCol;
-layout( location = 3 ) in vec4 vUV1UV2;
-
 layout( location = 0 ) out vec3 fragCol;
 layout( location = 1 ) out vec4 fUV1UV2;
+layout( location = 2 ) out vec3 fViewPos;
+layout( location = 3 ) out vec3 fViewNorm;
 
 layout( set = 0, binding = 0 ) uniform CameraBuffer {
 	mat4 view;
@@ -15,6 +12,17 @@ layout( set = 0, binding = 0 ) uniform CameraBuffer {
 	mat4 view_proj;
 } cam_data;
 
+//Vertices of every mesh, packed like Vertex in VkMesh.hpp. The draw's first vertex is part of gl_VertexIndex
+layout( std430, set = 0, binding = 4 ) readonly buffer Vertices {
+	float vertices[];
+};
+
+const uint VERTEX_FLOATS = 13;
+
+vec3 pull_vec3( uint at ){
+	return vec3( vertices[at], vertices[at + 1], vertices[at + 2] );
+}
+
 layout( push_constant ) uniform constants
 {
 	vec4 data;
@@ -23,7 +31,18 @@ layout( push_constant ) uniform constants
 
 void main()
 {
-	gl_Position = cam_data.view_proj * PushConstants.model * vec4( vPos, 1.0f );
+	uint at = uint( gl_VertexIndex ) * VERTEX_FLOATS;
+	vec3 vPos = pull_vec3( at );
+	vec3 vNorm = pull_vec3( at + 3 );
+	vec3 vCol = pull_vec3( at + 6 );
+	vec4 vUV1UV2 = vec4( pull_vec3( at + 9 ), vertices[at + 12] );
+
+	mat4 model_view = cam_data.view * PushConstants.model;
+	vec4 view_pos = model_view * vec4( vPos, 1.0f );
+
+	gl_Position = cam_data.proj * view_pos;
 	fragCol = vCol;
 	fUV1UV2 = vUV1UV2;
+	fViewPos = view_pos.xyz;
+	fViewNorm = mat3( model_view ) * vNorm;
 }
@@ -1,6 +1,7 @@
 #include "StrategyCam.hpp"
 
 #include <glm/ext/matrix_transform.hpp>
+#include <cmath>
 #include <memory>
 
 #include <glm/gtc/matrix_transform.hpp>
@@ -41,3 +42,7 @@ const glm::mat4 StrategyCamera::get_view() const {
 const glm::mat4 StrategyCamera::get_proj() const {
 	return proj;
 }
+
+float StrategyCamera::focal_pixels( float viewport_height ) const {
+	return std::abs( proj[1][1] ) * 0.5f * viewport_height;
+}
@@ -14,6 +14,9 @@ struct StrategyCamera {
 		const glm::mat4 get_view() const;
 		const glm::mat4 get_proj() const;
 
+		//Pixels covered by one world unit at view depth 1, divide by the depth for the size on screen
+		float focal_pixels( float viewport_height ) const;
+
 		float min_height{ 1 };
 
 	private:
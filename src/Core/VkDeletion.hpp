@@ -0,0 +1,86 @@
+#pragma once
+
+#include "VkTypes.hpp"
+
+#include <vector>
+
+//Returned to its pool, which has to be created with VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT
+struct PooledDescriptorSet {
+	VkDescriptorPool pool;
+	VkDescriptorSet set;
+};
+
+// Typed handles waiting for destruction. No closures, pushing is a vector
+// append. flush() destroys dependents before the objects they were made from.
+struct DeletionQueue {
+	std::vector<VkFramebuffer> framebuffers;
+	std::vector<VkPipeline> pipelines;
+	std::vector<VkPipelineLayout> pipeline_layouts;
+	std::vector<VkRenderPass> render_passes;
+	std::vector<VkShaderModule> shader_modules;
+	std::vector<VkImageView> image_views;
+	std::vector<VkSampler> samplers;
+	std::vector<AllocatedImage> images;
+	std::vector<AllocatedBuffer> buffers;
+	std::vector<PooledDescriptorSet> descriptor_sets;
+	std::vector<VkDescriptorPool> descriptor_pools;
+	std::vector<VkDescriptorSetLayout> descriptor_set_layouts;
+	std::vector<VkCommandPool> command_pools;
+	std::vector<VkFence> fences;
+	std::vector<VkSemaphore> semaphores;
+	std::vector<VkSwapchainKHR> swapchains;
+
+	inline void push( VkFramebuffer h ){ framebuffers.push_back( h ); }
+	inline void push( VkPipeline h ){ pipelines.push_back( h ); }
+	inline void push( VkPipelineLayout h ){ pipeline_layouts.push_back( h ); }
+	inline void push( VkRenderPass h ){ render_passes.push_back( h ); }
+	inline void push( VkShaderModule h ){ shader_modules.push_back( h ); }
+	inline void push( VkImageView h ){ image_views.push_back( h ); }
+	inline void push( VkSampler h ){ samplers.push_back( h ); }
+	inline void push( AllocatedImage h ){ images.push_back( h ); }
+	inline void push( AllocatedBuffer h ){ buffers.push_back( h ); }
+	inline void push( PooledDescriptorSet h ){ descriptor_sets.push_back( h ); }
+	inline void push( VkDescriptorPool h ){ descriptor_pools.push_back( h ); }
+	inline void push( VkDescriptorSetLayout h ){ descriptor_set_layouts.push_back( h ); }
+	inline void push( VkCommandPool h ){ command_pools.push_back( h ); }
+	inline void push( VkFence h ){ fences.push_back( h ); }
+	inline void push( VkSemaphore h ){ semaphores.push_back( h ); }
+	inline void push( VkSwapchainKHR h ){ swapchains.push_back( h ); }
+
+	inline void flush( VkDevice dev, VmaAllocator alloc ){
+		for( auto h: framebuffers ) vkDestroyFramebuffer( dev, h, nullptr );
+		for( auto h: pipelines ) vkDestroyPipeline( dev, h, nullptr );
+		for( auto h: pipeline_layouts ) vkDestroyPipelineLayout( dev, h, nullptr );
+		for( auto h: render_passes ) vkDestroyRenderPass( dev, h, nullptr );
+		for( auto h: shader_modules ) vkDestroyShaderModule( dev, h, nullptr );
+		for( auto h: image_views ) vkDestroyImageView( dev, h, nullptr );
+		for( auto h: samplers ) vkDestroySampler( dev, h, nullptr );
+		for( auto& h: images ) vmaDestroyImage( alloc, h.image, h.allocation );
+		for( auto& h: buffers ) vmaDestroyBuffer( alloc, h.buffer, h.allocation );
+		for( auto& h: descriptor_sets ) vkFreeDescriptorSets( dev, h.pool, 1, &h.set );
+		for( auto h: descriptor_pools ) vkDestroyDescriptorPool( dev, h, nullptr );
+		for( auto h: descriptor_set_layouts ) vkDestroyDescriptorSetLayout( dev, h, nullptr );
+		for( auto h: command_pools ) vkDestroyCommandPool( dev, h, nullptr );
+		for( auto h: fences ) vkDestroyFence( dev, h, nullptr );
+		for( auto h: semaphores ) vkDestroySemaphore( dev, h, nullptr );
+		for( auto h: swapchains ) vkDestroySwapchainKHR( dev, h, nullptr );
+
+		//clear() keeps the capacity, steady state retiring does not allocate
+		framebuffers.clear();
+		pipelines.clear();
+		pipeline_layouts.clear();
+		render_passes.clear();
+		shader_modules.clear();
+		image_views.clear();
+		samplers.clear();
+		images.clear();
+		buffers.clear();
+		descriptor_sets.clear();
+		descriptor_pools.clear();
+		descriptor_set_layouts.clear();
+		command_pools.clear();
+		fences.clear();
+		semaphores.clear();
+		swapchains.clear();
+	}
+};
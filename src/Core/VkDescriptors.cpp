@@ -0,0 +1,165 @@
+#include "Core/VkDescriptors.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+//Descriptors per set a pool is sized for, by type
+static const std::pair<VkDescriptorType, uint32_t> POOL_RATIOS[]{
+	{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 },
+	{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1 },
+};
+
+void DescriptorAllocator::init( VkDevice device, VkDescriptorPoolCreateFlags create_flags ){
+	dev = device;
+	flags = create_flags;
+	next_pool_sets = FIRST_POOL_SETS;
+}
+
+VkDescriptorPool DescriptorAllocator::create_pool(){
+	if( !spare.empty() ){
+		VkDescriptorPool pool = spare.back();
+		spare.pop_back();
+		return pool;
+	}
+
+	std::vector<VkDescriptorPoolSize> sizes;
+	for( auto& [type, ratio]: POOL_RATIOS )
+		sizes.push_back( VkDescriptorPoolSize{ type, ratio * next_pool_sets });
+
+	VkDescriptorPoolCreateInfo pool_cr_inf{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = flags,
+		.maxSets = next_pool_sets,
+		.poolSizeCount = static_cast<uint32_t>( sizes.size() ),
+		.pPoolSizes = sizes.data(),
+	};
+
+	VkDescriptorPool pool;
+	VK_CHECK( vkCreateDescriptorPool( dev, &pool_cr_inf, nullptr, &pool ));
+
+	next_pool_sets = std::min( next_pool_sets * 2, MAX_POOL_SETS );
+	return pool;
+}
+
+bool DescriptorAllocator::try_allocate( VkDescriptorPool pool, VkDescriptorSetLayout layout, VkDescriptorSet& set ){
+	VkDescriptorSetAllocateInfo alloc_inf{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		.pNext = nullptr,
+		.descriptorPool = pool,
+		.descriptorSetCount = 1,
+		.pSetLayouts = &layout,
+	};
+
+	VkResult res = vkAllocateDescriptorSets( dev, &alloc_inf, &set );
+
+	if( res == VK_ERROR_OUT_OF_POOL_MEMORY || res == VK_ERROR_FRAGMENTED_POOL )
+		return false;
+
+	VK_CHECK( res );
+	return true;
+}
+
+PooledDescriptorSet DescriptorAllocator::allocate( VkDescriptorSetLayout layout ){
+	VkDescriptorSet set;
+
+	if( current && try_allocate( current, layout, set ))
+		return PooledDescriptorSet{ current, set };
+
+	//Sets freed since may have made room in an earlier pool
+	if( flags & VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT ){
+		for( size_t i = 0; i < full.size(); ++i ){
+			if( !try_allocate( full[i], layout, set ))
+				continue;
+
+			//Allocations continue from the pool that had room
+			VkDescriptorPool pool = full[i];
+			full.erase( full.begin() + i );
+			if( current )
+				full.push_back( current );
+			current = pool;
+
+			return PooledDescriptorSet{ current, set };
+		}
+	}
+
+	if( current )
+		full.push_back( current );
+	current = create_pool();
+
+	if( !try_allocate( current, layout, set ))
+		throw std::runtime_error( "Descriptor set layout does not fit an empty pool" );
+
+	return PooledDescriptorSet{ current, set };
+}
+
+void DescriptorAllocator::reset(){
+	if( current )
+		full.push_back( current );
+	current = VK_NULL_HANDLE;
+
+	for( auto pool: full ){
+		vkResetDescriptorPool( dev, pool, 0 );
+		spare.push_back( pool );
+	}
+	full.clear();
+}
+
+void DescriptorAllocator::destroy( DeletionQueue& deletions ){
+	if( current )
+		deletions.push( current );
+	for( auto pool: full )
+		deletions.push( pool );
+	for( auto pool: spare )
+		deletions.push( pool );
+
+	current = VK_NULL_HANDLE;
+	full.clear();
+	spare.clear();
+}
+
+void DescriptorLayoutCache::init( VkDevice device ){
+	dev = device;
+}
+
+VkDescriptorSetLayout DescriptorLayoutCache::get( const VkDescriptorSetLayoutBinding* bindings, uint32_t count ){
+	std::vector<VkDescriptorSetLayoutBinding> sorted( bindings, bindings + count );
+	std::sort( sorted.begin(), sorted.end(), []( const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b ){
+			return a.binding < b.binding;
+		});
+
+	std::vector<uint64_t> key;
+	key.reserve( sorted.size() * 4 );
+
+	for( auto& b: sorted ){
+		key.push_back( b.binding );
+		key.push_back( static_cast<uint64_t>( b.descriptorType ) << 32 | b.descriptorCount );
+		key.push_back( b.stageFlags );
+		key.push_back( reinterpret_cast<uintptr_t>( b.pImmutableSamplers ));
+	}
+
+	auto it = layouts.find( key );
+	if( it != layouts.end() )
+		return it->second;
+
+	VkDescriptorSetLayoutCreateInfo set_lay_cr_inf{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.pNext = nullptr,
+		.bindingCount = count,
+		.pBindings = sorted.data(),
+	};
+
+	VkDescriptorSetLayout layout;
+	VK_CHECK( vkCreateDescriptorSetLayout( dev, &set_lay_cr_inf, nullptr, &layout ));
+
+	layouts.emplace( std::move( key ), layout );
+	return layout;
+}
+
+void DescriptorLayoutCache::destroy( DeletionQueue& deletions ){
+	for( auto& [key, layout]: layouts )
+		deletions.push( layout );
+	layouts.clear();
+}
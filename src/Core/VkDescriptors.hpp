@@ -0,0 +1,63 @@
+#pragma once
+
+#include "VkTypes.hpp"
+#include "VkDeletion.hpp"
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+/*
+ * Hands out descriptor sets from a chain of pools. When the current pool runs
+ * out it is parked as full and the next one takes over, each new pool twice
+ * the size of the last, so callers never see VK_ERROR_OUT_OF_POOL_MEMORY.
+ *
+ * Long lived allocators are created with FREE_DESCRIPTOR_SET_BIT, sets are
+ * retired as PooledDescriptorSet and full pools are tried again before a new
+ * one is made. Transient allocators (one per frame) are reset() in bulk
+ * instead, which keeps their pools for the next use.
+ */
+struct DescriptorAllocator {
+	constexpr static uint32_t FIRST_POOL_SETS = 32;
+	constexpr static uint32_t MAX_POOL_SETS = 1024;
+
+	void init( VkDevice dev, VkDescriptorPoolCreateFlags flags );
+
+	PooledDescriptorSet allocate( VkDescriptorSetLayout layout );
+	//Every set handed out is invalid afterwards, only once the GPU is done with them
+	void reset();
+
+	//Shutdown, after the sets' PooledDescriptorSet handles were flushed
+	void destroy( DeletionQueue& deletions );
+
+	private:
+		VkDevice dev{ VK_NULL_HANDLE };
+		VkDescriptorPoolCreateFlags flags{ 0 };
+		uint32_t next_pool_sets{ FIRST_POOL_SETS };
+
+		VkDescriptorPool current{ VK_NULL_HANDLE };
+		std::vector<VkDescriptorPool> full;
+		//Empty again after reset()
+		std::vector<VkDescriptorPool> spare;
+
+		VkDescriptorPool create_pool();
+		bool try_allocate( VkDescriptorPool pool, VkDescriptorSetLayout layout, VkDescriptorSet& set );
+};
+
+/*
+ * Set layouts keyed by their bindings, so subsystems describing the same
+ * layout share one handle and pipelines built against either are compatible.
+ * The cache owns the layouts, callers must not destroy them.
+ */
+struct DescriptorLayoutCache {
+	void init( VkDevice dev );
+
+	VkDescriptorSetLayout get( const VkDescriptorSetLayoutBinding* bindings, uint32_t count );
+
+	void destroy( DeletionQueue& deletions );
+
+	private:
+		VkDevice dev{ VK_NULL_HANDLE };
+		//Bindings sorted by index, four words each
+		std::map<std::vector<uint64_t>, VkDescriptorSetLayout> layouts;
+};
@@ -19,8 +19,11 @@
 
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <iomanip>
 #include <ios>
 #include <stdexcept>
 #include <iostream>
@@ -29,28 +32,34 @@
 #include "Core/VkInit.hpp"
 #include "VkBootstrap.h"
 
-#define VK_CHECK( x ) 											\
-	do { 														\
-		VkResult err = x; 										\
-		if( err ){ 												\
-			std::cout << "Vulkan error: " << err << std::endl; 	\
-			throw std::runtime_error( "Vulkan error" ); 		\
-		} 														\
-	}while( 0 )
-
-
-#ifdef NO_FILE_PREFIX
-	#define FILE_PREFIX
-#else
-	#if _WIN32
-		#define FILE_PREFIX "../../../../"
-	#else
-		#define FILE_PREFIX "../../"
-	#endif
-#endif
-
+static float ms_since( std::chrono::steady_clock::time_point start ){
+	return std::chrono::duration<float, std::milli>( std::chrono::steady_clock::now() - start ).count();
+}
 
 void VkEngine::init(){
+	init_start = std::chrono::steady_clock::now();
+
+	//Jobs keep a pointer to their entry
+	startup_phases.clear();
+	startup_phases.reserve( 16 );
+
+	auto timed = [this]( const char* name, const std::function<void()>& fn ){
+		StartupPhase& p = startup_phases.emplace_back( StartupPhase{ .name = name, .start_ms = ms_since( init_start )});
+		fn();
+		p.duration_ms = ms_since( init_start ) - p.start_ms;
+	};
+
+	//Runs as a job once deps finished
+	auto phase = [this]( const char* name, std::initializer_list<JobHandle> deps, std::function<void()> fn ){
+		StartupPhase* p = &startup_phases.emplace_back( StartupPhase{ .name = name });
+
+		return jobs.submit( [this, p, fn = std::move( fn )]{
+				p->start_ms = ms_since( init_start );
+				fn();
+				p->duration_ms = ms_since( init_start ) - p->start_ms;
+			}, deps );
+	};
+
 	SDL_Init( SDL_INIT_VIDEO );
 
 	SDL_WindowFlags window_flags{ SDL_WINDOW_VULKAN };
@@ -64,21 +73,39 @@ void VkEngine::init(){
 			window_flags
 		);
 
-	init_vk();
-	init_vk_swapchain();
-	init_vk_cmd();
-	init_vk_default_renderpass();
-	init_vk_framebuffers();
-	init_vk_sync();
+	frame_overlap = std::clamp<uint32_t>( frame_overlap, 1, MAX_FRAME_OVERLAP );
+	frames.resize( frame_overlap );
 
-	init_descriptors();
+	jobs.init();
 
-	init_vk_pipelines();
+	//The surface belongs to the window, so the device is created on this thread
+	timed( "device", [this]{ init_vk(); });
+	timed( "swapchain", [this]{
+			init_vk_swapchain();
+			init_vk_cmd();
+			geometry.init( *this );
+		});
+
+	//These share the deletion queue and the render graph, so they form one chain
+	JobHandle render_graph = phase( "render graph", {}, [this]{ init_render_graph(); });
+	JobHandle sync = phase( "sync", { render_graph }, [this]{
+			init_vk_sync();
+			init_frame_staging();
+		});
+	JobHandle descriptors = phase( "descriptors", { sync }, [this]{ init_descriptors(); });
+	JobHandle pipelines = phase( "pipelines", { descriptors }, [this]{ init_vk_pipelines(); });
 
-	load_meshes();
-	load_images();
+	//Only touch the mesh and texture tables, next to shader loading and pipeline creation
+	JobHandle mesh_upload = phase( "meshes", {}, [this]{ load_meshes(); });
+	JobHandle images = phase( "images", { sync }, [this]{ load_images(); });
 
-	init_scene();
+	JobHandle scene_ready = phase( "scene", { pipelines, mesh_upload, images }, [this]{ init_scene(); });
+	jobs.wait( scene_ready );
+
+	std::cout << std::fixed << std::setprecision( 1 ) << "Startup took " << ms_since( init_start ) << " ms" << std::endl;
+	for( auto& p: startup_phases )
+		std::cout << "  " << p.name << ": " << p.duration_ms << " ms, started at " << p.start_ms << " ms" << std::endl;
+	std::cout << std::defaultfloat;
 
 	initialized = true;
 }
@@ -88,6 +115,10 @@ void VkEngine::deinit(){
 		//Vulkan
 		vkDeviceWaitIdle( vk_device );
 
+		//Loads still decoding finish as jobs, then the ones waiting for a copy continue and clean up
+		jobs.deinit();
+		uploads.cancel();
+
 		/*
 		vkDestroyFence( vk_device, vk_fence_render, nullptr );
 		vkDestroySemaphore( vk_device, vk_sema_render, nullptr );
@@ -105,7 +136,26 @@ void VkEngine::deinit(){
 		}
 		*/
 
-		deletion_queue.flush();
+		for( auto& frame: frames ){
+			frame.deletions.flush( vk_device, vma_alloc );
+			frame.descriptors.destroy( deletion_queue );
+		}
+
+		descriptors.destroy( deletion_queue );
+		layouts.destroy( deletion_queue );
+
+		for( auto& tex: textures ){
+			if( tex.borrowed )
+				continue;
+
+			deletion_queue.push( tex.view );
+			deletion_queue.push( tex.img );
+		}
+
+		static_layer.destroy( *this );
+		graph.destroy( *this );
+
+		deletion_queue.flush( vk_device, vma_alloc );
 
 		vmaDestroyAllocator( vma_alloc );
 
@@ -129,40 +179,69 @@ void VkEngine::draw(){
 	uint32_t render_img;
 	VK_CHECK( vkAcquireNextImageKHR( vk_device, vk_swapchain, 1000000000, get_curr_frame().present_sema, VK_NULL_HANDLE, &render_img ));
 
-	VK_CHECK( vkResetCommandBuffer( get_curr_frame().main_buf, 0 ));
-	auto beg_inf = vkinit::command_buffer_begin_info();
+	//The frame ring is independent of the swapchain length, so an older frame may still be drawing into this image
+	if( swapchain_img_fences[render_img] != VK_NULL_HANDLE && swapchain_img_fences[render_img] != get_curr_frame().render_fence ){
+		VK_CHECK( vkWaitForFences( vk_device, 1, &swapchain_img_fences[render_img], VK_TRUE, 1000000000 ));
+	}
+	swapchain_img_fences[render_img] = get_curr_frame().render_fence;
 
-	VK_CHECK( vkBeginCommandBuffer( get_curr_frame().main_buf, &beg_inf ));
+	//Everything retired while this slot was last in use is now idle on the GPU
+	get_curr_frame().deletions.flush( vk_device, vma_alloc );
+	get_curr_frame().descriptors.reset();
+	retire_frame = frameNumber;
+	geometry.collect( retire_frame );
 
-	VkClearValue clear_vals[2]{
-		{
-			.color = {{ 0.1, 0.1, 0.1, 1 }},
-		},
-		{
-			.depthStencil = {
-				.depth = 1.0f,
-			}
-		}
-	};
+	//Loads whose copy went out with an earlier frame swap their resources in before anything is recorded
+	uploads.resume_recorded();
+	residency.update( *this );
+	refresh_materials();
 
-	VkRenderPassBeginInfo render_beg_inf{
-		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-		.pNext = nullptr,
-		.renderPass = vk_render_pass,
-		.framebuffer = vk_framebuffers[render_img],
-		.renderArea = VkRect2D{
-			.offset = { 0, 0 },
-			.extent = windowExtent,
-		},
-		.clearValueCount = 2,
-		.pClearValues = clear_vals,
+	static_layer.update( *this );
+	scene.update_transforms();
+	shadows.update( *this );
+	indirect.update( *this );
+
+	glm::mat4 proj = cam.get_proj();
+	glm::mat4 view = cam.get_view();
+
+	//Read by the culling passes before the main pass as well
+	GpuCamData cam_data{
+		.view = view,
+		.proj = proj,
+		.view_proj = proj * view,
 	};
 
-	vkCmdBeginRenderPass( get_curr_frame().main_buf, &render_beg_inf, VK_SUBPASS_CONTENTS_INLINE );
+	void* data;
+	vmaMapMemory( vma_alloc, get_curr_frame().camera_buf.allocation, &data );
+	memcpy( data, &cam_data, sizeof( GpuCamData ));
+	vmaUnmapMemory( vma_alloc, get_curr_frame().camera_buf.allocation );
+
+	//Scene entities are culled on the GPU unless the indirect path is off
+	objects.clear();
+	if( !indirect.enabled ){
+		scene.cull( cam_data.view_proj, jobs );
+		scene.select_lods( meshes, view, cam.focal_pixels( windowExtent.height ), jobs );
+		scene.gather_visible( objects );
+	}
+
+	//Statistics of the previous frame
+	overlay.text(
+			glm::vec2{ 8.0f, 8.0f },
+			"entities " + std::to_string( scene.size() ) + "  shadow faces " + std::to_string( shadows.faces_rendered ) + "  overlay draws " + std::to_string( overlay.draw_count ) + "  streaming " + std::to_string( uploads.pending_count() ) + "  scene records " + std::to_string( scene_records )
+			+ "\nvram " + std::to_string( residency.usage >> 20 ) + " / " + std::to_string( residency.budget >> 20 ) + " MiB  evicted textures " + std::to_string( residency.evicted ),
+			glm::vec4{ 1.0f, 1.0f, 1.0f, 0.8f });
 
-	draw_objects( get_curr_frame().main_buf, objects.data(), objects.size() );
+	frame_staging.begin_frame( frameNumber % frames.size() );
+
+	VK_CHECK( vkResetCommandBuffer( get_curr_frame().main_buf, 0 ));
+	auto beg_inf = vkinit::command_buffer_begin_info();
+
+	VK_CHECK( vkBeginCommandBuffer( get_curr_frame().main_buf, &beg_inf ));
+
+	graph.set_image( rg_swapchain, vk_swapchain_imgs[render_img], vk_swapchain_img_views[render_img] );
+	graph.set_buffer( rg_hiz_draws, hiz.current_draws( *this ));
+	graph.execute( *this, get_curr_frame().main_buf );
 
-	vkCmdEndRenderPass( get_curr_frame().main_buf );
 	VK_CHECK( vkEndCommandBuffer( get_curr_frame().main_buf ));
 
 	VkPipelineStageFlags waitStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
@@ -193,6 +272,10 @@ void VkEngine::draw(){
 
 	VK_CHECK( vkQueuePresentKHR( vk_graphics_queue,  &pres_inf ));
 
+	//Time to first frame is what a player joining a session waits for
+	if( frameNumber == 0 )
+		std::cout << "First frame after " << ms_since( init_start ) << " ms" << std::endl;
+
 	++frameNumber;
 }
 
@@ -217,6 +300,27 @@ void VkEngine::run(){
 					cam.move_from_anchor({ 0.0f, e.wheel.y * dT * 100 });
 					break;
 				}
+				case SDL_KEYDOWN:
+				{
+					uint32_t i = scene.index_of( token );
+					if( i == UINT32_MAX )
+						break;
+
+					//Arrow keys move the token a cell, delete removes it with its marker
+					glm::vec3 step{};
+					switch( e.key.keysym.scancode ){
+						case SDL_SCANCODE_UP: step.x += 1.0f; break;
+						case SDL_SCANCODE_DOWN: step.x -= 1.0f; break;
+						case SDL_SCANCODE_RIGHT: step.z += 1.0f; break;
+						case SDL_SCANCODE_LEFT: step.z -= 1.0f; break;
+						case SDL_SCANCODE_DELETE: scene.destroy( token ); break;
+						default: break;
+					}
+
+					if( step != glm::vec3{} )
+						scene.set_transform( token, glm::translate( step ) * scene.local[i] );
+					break;
+				}
 			}
 		}
 		
@@ -254,6 +358,45 @@ void VkEngine::run(){
 	}
 }
 
+bool VkEngine::validate_fog(){
+	//A fog pass computes every rect dirty at its frame, the first frames also let the uploads settle
+	uint32_t drawn = 0;
+	while( drawn < frames.size() || ( !fog.dirty.empty() && drawn < 64 )){
+		draw();
+		++drawn;
+	}
+
+	return fog.validate( *this );
+}
+
+bool VkEngine::validate_scene(){
+	if( !scene.alive( token ) || !scene.alive( token_marker )){
+		std::cout << "Scene validation skipped, the token or its marker is missing" << std::endl;
+		return false;
+	}
+
+	uint32_t before = scene.size();
+
+	//The marker has to follow through the dirty propagation
+	scene.set_transform( token, glm::translate( glm::vec3{ 1.0f, 0.0f, 0.0f }) * scene.local[scene.index_of( token )] );
+	draw();
+	uint32_t moved_errors = scene.validate();
+
+	//Destroying the token takes the marker with it
+	scene.destroy( token );
+	draw();
+	uint32_t destroyed_errors = scene.validate();
+
+	bool subtree_gone = !scene.alive( token_marker ) && scene.size() == before - 2;
+	bool ok = moved_errors == 0 && destroyed_errors == 0 && subtree_gone;
+
+	std::cout << "Scene validation " << ( ok ? "passed" : "FAILED" )
+		<< ": " << moved_errors << " errors after moving, " << destroyed_errors << " after destroying, subtree "
+		<< ( subtree_gone ? "removed" : "left behind" ) << std::endl;
+
+	return ok;
+}
+
 void VkEngine::init_vk(){
 	//Instance
 	vkb::InstanceBuilder builder;
@@ -279,6 +422,17 @@ void VkEngine::init_vk(){
 		.set_minimum_version( 1, 2 )
 		.set_surface( vk_surface )
 		.prefer_gpu_device_type()
+		//Storage writes to the rg32f depth pyramid
+		.set_required_features( VkPhysicalDeviceFeatures{
+				.drawIndirectFirstInstance = VK_TRUE,
+				.shaderStorageImageExtendedFormats = VK_TRUE,
+			})
+		//One count per batch for the GPU driven path
+		.set_required_features_12( VkPhysicalDeviceVulkan12Features{
+				.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+				.drawIndirectCount = VK_TRUE,
+			})
+		.add_desired_extension( VK_EXT_MEMORY_BUDGET_EXTENSION_NAME )
 		.select()
 		.value();
 
@@ -295,10 +449,22 @@ void VkEngine::init_vk(){
 	vk_graphics_queue = vkb_device.get_queue( vkb::QueueType::graphics ).value();
 	vk_graphics_queue_family = vkb_device.get_queue_index( vkb::QueueType::graphics ).value();
 
+	//Real usage and budget per heap for texture residency, VMA estimates them otherwise
+	uint32_t ext_count = 0;
+	vkEnumerateDeviceExtensionProperties( vk_phys_dev, nullptr, &ext_count, nullptr );
+	std::vector<VkExtensionProperties> exts( ext_count );
+	vkEnumerateDeviceExtensionProperties( vk_phys_dev, nullptr, &ext_count, exts.data() );
+
+	bool memory_budget = std::any_of( exts.begin(), exts.end(), []( const VkExtensionProperties& e ){
+			return strcmp( e.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME ) == 0;
+		});
+
 	VmaAllocatorCreateInfo alloc_inf{
+		.flags = memory_budget ? VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT : 0u,
 		.physicalDevice = vk_phys_dev,
 		.device = vk_device,
 		.instance = vk_instance,
+		.vulkanApiVersion = VK_API_VERSION_1_2,
 	};
 
 	vmaCreateAllocator( &alloc_inf, &vma_alloc );
@@ -320,39 +486,14 @@ void VkEngine::init_vk_swapchain(){
 	vk_swapchain_imgs = vkb_swapchain.get_images().value();
 	vk_swapchain_img_views = vkb_swapchain.get_image_views().value();
 
-	deletion_queue.emplace_function( [this](){
-			for( size_t i = 0; i < vk_swapchain_img_views.size(); ++i ){
-				vkDestroyImageView( vk_device, vk_swapchain_img_views[i], nullptr );
-			}
-		});
+	swapchain_img_fences.assign( vk_swapchain_imgs.size(), VK_NULL_HANDLE );
 
-	deletion_queue.emplace_function( [this](){ vkDestroySwapchainKHR( vk_device, vk_swapchain, nullptr ); });
+	for( auto view: vk_swapchain_img_views )
+		deletion_queue.push( view );
 
-	VkExtent3D depth_img_size = {
-		.width = windowExtent.width,
-		.height = windowExtent.height,
-		.depth = 1,
-	};
+	deletion_queue.push( vk_swapchain );
 
 	depth_format = VK_FORMAT_D32_SFLOAT;
-
-	auto img_cr_inf = vkinit::image_create_info( depth_format, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, depth_img_size );
-
-	VmaAllocationCreateInfo img_alloc_inf = {
-		.usage = VMA_MEMORY_USAGE_GPU_ONLY,
-		.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-	};
-
-	vmaCreateImage( vma_alloc, &img_cr_inf, &img_alloc_inf, &depth_img.image, &depth_img.allocation, nullptr );
-
-	VkImageViewCreateInfo view_cr_inf = vkinit::image_view_create_info( depth_format, depth_img.image, VK_IMAGE_ASPECT_DEPTH_BIT );
-
-	VK_CHECK( vkCreateImageView( vk_device, &view_cr_inf, nullptr, &depth_view ));
-
-	deletion_queue.emplace_function( [this](){
-			vkDestroyImageView( vk_device, depth_view, nullptr );
-			vmaDestroyImage( vma_alloc, depth_img.image, depth_img.allocation );
-		});
 }
 
 void VkEngine::init_vk_cmd(){
@@ -362,10 +503,10 @@ void VkEngine::init_vk_cmd(){
 			VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT
 		);
 
-	for( size_t i = 0; i < FRAME_OVERLAP; ++i ){
+	for( size_t i = 0; i < frames.size(); ++i ){
 		VK_CHECK( vkCreateCommandPool( vk_device, &cmd_pool_cr_inf, nullptr, &frames[i].cmd_pool ));
 
-		deletion_queue.emplace_function( [this, i](){ vkDestroyCommandPool( vk_device, frames[i].cmd_pool, nullptr ); });
+		deletion_queue.push( frames[i].cmd_pool );
 
 		auto cmd_alloc_inf =
 			vkinit::command_buffer_allocate_info(
@@ -373,123 +514,340 @@ void VkEngine::init_vk_cmd(){
 			);
 
 		VK_CHECK( vkAllocateCommandBuffers( vk_device, &cmd_alloc_inf, &frames[i].main_buf ));
+
+		auto secondary_alloc_inf = vkinit::command_buffer_allocate_info( frames[i].cmd_pool, 1, VK_COMMAND_BUFFER_LEVEL_SECONDARY );
+
+		VK_CHECK( vkAllocateCommandBuffers( vk_device, &secondary_alloc_inf, &frames[i].scene_buf ));
+		VK_CHECK( vkAllocateCommandBuffers( vk_device, &secondary_alloc_inf, &frames[i].dynamic_buf ));
 	}
 
 	auto up_cmd_pl_inf = vkinit::command_pool_create_info( vk_graphics_queue_family );
 	VK_CHECK( vkCreateCommandPool( vk_device, &up_cmd_pl_inf, nullptr, &upload_context.cmd_pool ));
 
-	deletion_queue.emplace_function( [this](){
-			vkDestroyCommandPool( vk_device, upload_context.cmd_pool, nullptr );
-		});
+	deletion_queue.push( upload_context.cmd_pool );
+
+	//Mesh uploads start before the sync phase, immediate_submit needs the fence from here on
+	auto fence_cr_inf = vkinit::fence_create_info( 0 );
+	VK_CHECK( vkCreateFence( vk_device, &fence_cr_inf, nullptr, &upload_context.fence ));
+
+	deletion_queue.push( upload_context.fence );
 }
 
-void VkEngine::init_vk_default_renderpass(){
-	VkAttachmentDescription color_attachment{
-		.format = vk_swapchain_format,
-		.samples = VK_SAMPLE_COUNT_1_BIT,
-		.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-		.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-		.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-		.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-		.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+void VkEngine::init_render_graph(){
+	rg_swapchain = graph.import_image(
+			"swapchain",
+			vk_swapchain_format,
+			windowExtent,
+			RGResourceState{
+				.layout = VK_IMAGE_LAYOUT_UNDEFINED,
+				.stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				.access = 0,
+			},
+			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR );
+
+	rg_depth = graph.create_image( "depth", depth_format, windowExtent );
+
+	//Copies of assets streaming in, first so nothing else in the frame has to wait for them
+	RGPass& upload_pass = graph.add_pass( "uploads", VK_PIPELINE_BIND_POINT_COMPUTE );
+
+	upload_pass.record = [this]( VkCommandBuffer cmd ){
+		uploads.record( *this, cmd );
+		geometry.record_copies( cmd );
 	};
 
-	VkAttachmentReference color_attach_ref {
-		.attachment = 0,
-		.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+	//Persistent, so it enters and leaves every frame in the state the overlay samples it in
+	rg_fog = graph.import_image(
+			"fog",
+			VK_FORMAT_R8G8B8A8_UNORM,
+			VkExtent2D{ fog.resolution, fog.resolution },
+			RGResourceState{
+				.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				.stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				.access = 0,
+			},
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL );
+
+	RGPass& fog_pass = graph.add_pass( "fog", VK_PIPELINE_BIND_POINT_COMPUTE )
+		.write( rg_fog, RGUsage::Storage );
+
+	fog_pass.record = [this]( VkCommandBuffer cmd ){
+		fog.record_update( *this, cmd );
 	};
 
-	VkAttachmentDescription depth_attachment {
-		.format = depth_format,
-		.samples = VK_SAMPLE_COUNT_1_BIT,
-		.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-		.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-		.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-		.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-		.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+	//Last read by the previous frame's shading, the culling pass has to wait for it
+	rg_clusters = graph.import_buffer(
+			"clusters",
+			RGResourceState{
+				.layout = VK_IMAGE_LAYOUT_UNDEFINED,
+				.stages = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				.access = 0,
+			});
+
+	RGPass& light_pass = graph.add_pass( "light_cull", VK_PIPELINE_BIND_POINT_COMPUTE )
+		.write( rg_clusters, RGUsage::Storage );
+
+	light_pass.record = [this]( VkCommandBuffer cmd ){
+		lights.record_cull( *this, cmd );
 	};
 
-	VkAttachmentReference depth_attach_ref {
-		.attachment = 1,
-		.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+	//Shadow maps persist across frames and are only partially redrawn
+	rg_shadow_cache = graph.import_image(
+			"shadow_cache",
+			ShadowAtlas::FORMAT,
+			VkExtent2D{ ShadowAtlas::WIDTH, ShadowAtlas::HEIGHT },
+			RGResourceState{
+				.layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				.stages = VK_PIPELINE_STAGE_TRANSFER_BIT,
+				.access = 0,
+			},
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL );
+
+	rg_shadow_atlas = graph.import_image(
+			"shadow_atlas",
+			ShadowAtlas::FORMAT,
+			VkExtent2D{ ShadowAtlas::WIDTH, ShadowAtlas::HEIGHT },
+			RGResourceState{
+				.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				.stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				.access = 0,
+			},
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL );
+
+	RGPass& shadow_static_pass = graph.add_pass( "shadow_static", VK_PIPELINE_BIND_POINT_GRAPHICS )
+		.write( rg_shadow_cache, RGUsage::DepthAttachment );
+
+	shadow_static_pass.record = [this]( VkCommandBuffer cmd ){
+		shadows.record_static( *this, cmd );
 	};
+	shadow_static_pass.active = [this]{
+		return shadows.static_pending();
+	};
+
+	//Copies only, no render pass
+	RGPass& shadow_copy_pass = graph.add_pass( "shadow_copy", VK_PIPELINE_BIND_POINT_COMPUTE )
+		.read( rg_shadow_cache, RGUsage::Transfer )
+		.write( rg_shadow_atlas, RGUsage::Transfer );
 
-	VkSubpassDescription subpass {
-		.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
-		.colorAttachmentCount = 1,
-		.pColorAttachments = &color_attach_ref,
-		.pDepthStencilAttachment = &depth_attach_ref,
+	shadow_copy_pass.record = [this]( VkCommandBuffer cmd ){
+		shadows.record_copy( *this, cmd );
+	};
+	shadow_copy_pass.active = [this]{
+		return shadows.copy_pending();
 	};
 
-	VkAttachmentDescription attachments[2] = { color_attachment, depth_attachment };
+	RGPass& shadow_dynamic_pass = graph.add_pass( "shadow_dynamic", VK_PIPELINE_BIND_POINT_GRAPHICS )
+		.write( rg_shadow_atlas, RGUsage::DepthAttachment );
 
-	VkRenderPassCreateInfo render_pass_cr_inf {
-		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
-		.pNext = nullptr,
-		.attachmentCount = 2,
-		.pAttachments = attachments,
-		.subpassCount = 1,
-		.pSubpasses = &subpass,
+	shadow_dynamic_pass.record = [this]( VkCommandBuffer cmd ){
+		shadows.record_dynamic( *this, cmd );
+	};
+	shadow_dynamic_pass.active = [this]{
+		return shadows.dynamic_pending();
 	};
 
-	VK_CHECK( vkCreateRenderPass( vk_device, &render_pass_cr_inf, nullptr, &vk_render_pass ));
+	//Baked views persist, only slots in the bake queue are cleared and redrawn
+	rg_impostor_atlas = graph.import_image(
+			"impostor_atlas",
+			ImpostorAtlas::FORMAT,
+			VkExtent2D{ ImpostorAtlas::WIDTH, ImpostorAtlas::HEIGHT },
+			RGResourceState{
+				.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				.stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				.access = 0,
+			},
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL );
+
+	rg_impostor_depth = graph.create_image( "impostor_depth", depth_format, VkExtent2D{ ImpostorAtlas::WIDTH, ImpostorAtlas::HEIGHT });
+
+	//Before the culling pass, which picks up slots baked this frame
+	RGPass& impostor_bake_pass = graph.add_pass( "impostor_bake", VK_PIPELINE_BIND_POINT_GRAPHICS )
+		.write( rg_impostor_atlas, RGUsage::ColorAttachment )
+		.write( rg_impostor_depth, RGUsage::DepthAttachment );
+
+	impostor_bake_pass.record = [this]( VkCommandBuffer cmd ){
+		impostors.record_bake( *this, cmd );
+	};
+	impostor_bake_pass.active = [this]{
+		return impostors.bake_pending();
+	};
 
-	deletion_queue.emplace_function( [this](){ vkDestroyRenderPass( vk_device, vk_render_pass, nullptr ); });
-}
+	//Built from the previous frame's depth at the end of every frame
+	rg_hiz = graph.import_image(
+			"hiz",
+			HiZCuller::FORMAT,
+			VkExtent2D{ std::max( windowExtent.width / 2, 1u ), std::max( windowExtent.height / 2, 1u )},
+			RGResourceState{
+				.layout = VK_IMAGE_LAYOUT_GENERAL,
+				.stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				.access = VK_ACCESS_SHADER_WRITE_BIT,
+			},
+			VK_IMAGE_LAYOUT_GENERAL );
+
+	rg_hiz_draws = graph.import_buffer( "hiz_draws" );
+
+	RGPass& hiz_cull_pass = graph.add_pass( "hiz_cull", VK_PIPELINE_BIND_POINT_COMPUTE )
+		.read( rg_hiz, RGUsage::Storage )
+		.write( rg_hiz_draws, RGUsage::Storage );
+
+	hiz_cull_pass.record = [this]( VkCommandBuffer cmd ){
+		hiz.record_cull( *this, cmd, objects );
+	};
 
-void VkEngine::init_vk_framebuffers(){
-	VkFramebufferCreateInfo frame_cr_inf{
-		.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
-		.pNext = nullptr,
-		.renderPass = vk_render_pass,
-		.attachmentCount = 2,
-		.width = windowExtent.width,
-		.height = windowExtent.height,
-		.layers = 1,
+	//Last read by the previous frame's main pass
+	rg_gpu_draws = graph.import_buffer(
+			"gpu_draws",
+			RGResourceState{
+				.layout = VK_IMAGE_LAYOUT_UNDEFINED,
+				.stages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+				.access = 0,
+			});
+
+	rg_gpu_visible = graph.import_buffer(
+			"gpu_visible",
+			RGResourceState{
+				.layout = VK_IMAGE_LAYOUT_UNDEFINED,
+				.stages = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+				.access = 0,
+			});
+
+	rg_impostor_list = graph.import_buffer(
+			"impostor_list",
+			RGResourceState{
+				.layout = VK_IMAGE_LAYOUT_UNDEFINED,
+				.stages = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+				.access = 0,
+			});
+
+	rg_impostor_draw = graph.import_buffer(
+			"impostor_draw",
+			RGResourceState{
+				.layout = VK_IMAGE_LAYOUT_UNDEFINED,
+				.stages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+				.access = 0,
+			});
+
+	RGPass& gpu_cull_pass = graph.add_pass( "gpu_cull", VK_PIPELINE_BIND_POINT_COMPUTE )
+		.read( rg_hiz, RGUsage::Storage )
+		.write( rg_gpu_draws, RGUsage::Storage )
+		.write( rg_gpu_visible, RGUsage::Storage )
+		.write( rg_impostor_list, RGUsage::Storage )
+		.write( rg_impostor_draw, RGUsage::Storage );
+
+	gpu_cull_pass.record = [this]( VkCommandBuffer cmd ){
+		indirect.record_cull( *this, cmd );
 	};
 
-	const uint32_t swap_size = vk_swapchain_imgs.size();
-	vk_framebuffers.resize( swap_size );
+	RGPass& main_pass = graph.add_pass( "main", VK_PIPELINE_BIND_POINT_GRAPHICS )
+		.write( rg_swapchain, RGUsage::ColorAttachment )
+		.clear( rg_swapchain, VkClearValue{ .color = {{ 0.1, 0.1, 0.1, 1 }}})
+		.write( rg_depth, RGUsage::DepthAttachment )
+		.clear( rg_depth, VkClearValue{ .depthStencil = { .depth = 1.0f }})
+		.read( rg_fog, RGUsage::Sampled )
+		.read( rg_clusters, RGUsage::Storage )
+		.read( rg_shadow_atlas, RGUsage::Sampled )
+		.read( rg_hiz_draws, RGUsage::Indirect )
+		.read( rg_gpu_draws, RGUsage::Indirect )
+		.read( rg_gpu_visible, RGUsage::Storage )
+		.read( rg_impostor_atlas, RGUsage::Sampled )
+		.read( rg_impostor_list, RGUsage::Storage )
+		.read( rg_impostor_draw, RGUsage::Indirect );
+
+	main_pass.secondary = true;
+	main_pass.record = [this]( VkCommandBuffer cmd ){
+		FrameData& frame = get_curr_frame();
+
+		VkCommandBufferInheritanceInfo inherit_inf{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+			.pNext = nullptr,
+			.renderPass = vk_render_pass,
+			.subpass = 0,
+			.framebuffer = VK_NULL_HANDLE,
+		};
 
-	for( size_t i = 0; i < swap_size; ++i ){
-		VkImageView attachments[2];
-		attachments[0] = vk_swapchain_img_views[i];
-		attachments[1] = depth_view;
+		//GPU culled, so only the scene changes them. The camera is read from this slot's uniform buffer
+		if( !cache_scene_draws || frame.scene_version != draw_version ){
+			auto scene_beg = vkinit::command_buffer_begin_info( VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &inherit_inf );
+			VK_CHECK( vkBeginCommandBuffer( frame.scene_buf, &scene_beg ));
 
-		frame_cr_inf.pAttachments = attachments;
-		VK_CHECK( vkCreateFramebuffer( vk_device, &frame_cr_inf, nullptr, &vk_framebuffers[i] ));
+			indirect.draw( *this, frame.scene_buf );
+			impostors.draw( *this, frame.scene_buf );
 
-		deletion_queue.emplace_function( [this, i](){ vkDestroyFramebuffer( vk_device, vk_framebuffers[i], nullptr); });
-	}
+			VK_CHECK( vkEndCommandBuffer( frame.scene_buf ));
+			frame.scene_version = draw_version;
+			++scene_records;
+		}
+
+		auto dynamic_beg = vkinit::command_buffer_begin_info( VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &inherit_inf );
+		VK_CHECK( vkBeginCommandBuffer( frame.dynamic_buf, &dynamic_beg ));
+
+		glm::mat4 view_proj = cam.get_proj() * cam.get_view();
+
+		static_layer.draw( *this, frame.dynamic_buf, view_proj );
+		draw_objects( frame.dynamic_buf, objects.data(), objects.size() );
+		grid.draw( *this, frame.dynamic_buf );
+		fog.draw_overlay( *this, frame.dynamic_buf );
+		overlay.draw( *this, frame.dynamic_buf );
+
+		VK_CHECK( vkEndCommandBuffer( frame.dynamic_buf ));
+
+		VkCommandBuffer secondaries[2] = { frame.scene_buf, frame.dynamic_buf };
+		vkCmdExecuteCommands( cmd, 2, secondaries );
+	};
+
+	RGPass& hiz_build_pass = graph.add_pass( "hiz_build", VK_PIPELINE_BIND_POINT_COMPUTE )
+		.read( rg_depth, RGUsage::Sampled )
+		.write( rg_hiz, RGUsage::Storage );
+
+	hiz_build_pass.record = [this]( VkCommandBuffer cmd ){
+		hiz.record_build( *this, cmd, cam.get_proj() * cam.get_view() );
+	};
+
+	graph.compile( *this );
+
+	vk_render_pass = main_pass.render_pass;
 }
 
 void VkEngine::init_vk_sync(){
-	auto fence_cr_inf = vkinit::fence_create_info( 0 );
+	auto fence_cr_inf = vkinit::fence_create_info( VK_FENCE_CREATE_SIGNALED_BIT );
 	auto sem_cr_inf = vkinit::semaphore_create_info();
 
-	VK_CHECK( vkCreateFence( vk_device, &fence_cr_inf, nullptr, &upload_context.fence ));
-	deletion_queue.emplace_function( [this](){
-			vkDestroyFence( vk_device, upload_context.fence, nullptr );
-		});
-
-	fence_cr_inf.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-	for( size_t i = 0; i < FRAME_OVERLAP; ++i ){
+	for( size_t i = 0; i < frames.size(); ++i ){
 		VK_CHECK( vkCreateFence( vk_device, &fence_cr_inf, nullptr, &frames[i].render_fence ));
 
-		deletion_queue.emplace_function( [this, i](){ vkDestroyFence( vk_device, frames[i].render_fence, nullptr ); });
+		deletion_queue.push( frames[i].render_fence );
 
 		VK_CHECK( vkCreateSemaphore( vk_device, &sem_cr_inf, nullptr, &frames[i].render_sema ));
 		VK_CHECK( vkCreateSemaphore( vk_device, &sem_cr_inf, nullptr, &frames[i].present_sema ));
 
-		deletion_queue.emplace_function( [this, i](){ vkDestroySemaphore( vk_device, frames[i].render_sema, nullptr ); });
-		deletion_queue.emplace_function( [this, i](){ vkDestroySemaphore( vk_device, frames[i].present_sema, nullptr ); });
+		deletion_queue.push( frames[i].render_sema );
+		deletion_queue.push( frames[i].present_sema );
 	}
 
 }
 
+void VkEngine::init_frame_staging(){
+	frame_staging.slice_size = STAGING_SLICE_SIZE;
+
+	VkBufferCreateInfo buf_inf{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.pNext = nullptr,
+		.size = STAGING_SLICE_SIZE * frames.size(),
+		.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+	};
+
+	//Persistently mapped by VMA, so destroying it needs no unmap
+	VmaAllocationCreateInfo vma_alloc_inf{
+		.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT,
+		.usage = VMA_MEMORY_USAGE_CPU_TO_GPU,
+	};
+
+	VmaAllocationInfo alloc_inf;
+	VK_CHECK( vmaCreateBuffer( vma_alloc, &buf_inf, &vma_alloc_inf, &frame_staging.buffer.buffer, &frame_staging.buffer.allocation, &alloc_inf ));
+	frame_staging.mapped = static_cast<uint8_t*>( alloc_inf.pMappedData );
+
+	deletion_queue.push( frame_staging.buffer );
+}
+
 bool VkEngine::vk_load_shader( const char* path, VkShaderModule* shader ){
 	std::ifstream file( path, std::ios::ate | std::ios::binary );
 
@@ -520,17 +878,17 @@ bool VkEngine::vk_load_shader( const char* path, VkShaderModule* shader ){
 }
 
 void VkEngine::init_vk_pipelines(){
-	VkShaderModule triVert{}, triFrag{};
-
-
-	if (!vk_load_shader(FILE_PREFIX "shader/triangle.vert.spv", &triVert)) {
+	if (!vk_load_shader(FILE_PREFIX "shader/triangle.vert.spv", &scene_vert)) {
 		std::cout << "Failed to load vert shader" << std::endl;
 	}
 
-	if (!vk_load_shader(FILE_PREFIX "shader/triangle.frag.spv", &triFrag)) {
-		std::cout << "Failed to load vert shader" << std::endl;
+	if (!vk_load_shader(FILE_PREFIX "shader/triangle.frag.spv", &scene_frag)) {
+		std::cout << "Failed to load frag shader" << std::endl;
 	}
 
+	deletion_queue.push( scene_vert );
+	deletion_queue.push( scene_frag );
+
 	auto pipe_lay_cr_inf = vkinit::pipeline_layout();
 
 	VkPushConstantRange push_constant{
@@ -546,60 +904,34 @@ void VkEngine::init_vk_pipelines(){
 	pipe_lay_cr_inf.setLayoutCount = 2;
 	pipe_lay_cr_inf.pSetLayouts = layouts;
 
-	VkPipelineLayout triangle_layout;
-
-	VK_CHECK( vkCreatePipelineLayout( vk_device, &pipe_lay_cr_inf, nullptr, &triangle_layout ));
-
-	deletion_queue.emplace_function( [this, triangle_layout](){ vkDestroyPipelineLayout( vk_device, triangle_layout, nullptr ); });
-
-	PipelineBuilder pipe_builder;
-
+	VK_CHECK( vkCreatePipelineLayout( vk_device, &pipe_lay_cr_inf, nullptr, &scene_layout ));
 
-	VertexInputDescription vertex_desc{ Vertex::get_vk_description() };
+	deletion_queue.push( scene_layout );
 
-	pipe_builder.vertex_in_info = vkinit::vertex_input_state_create_info();
-	pipe_builder.vertex_in_info.vertexAttributeDescriptionCount = vertex_desc.attributes.size();
-	pipe_builder.vertex_in_info.pVertexAttributeDescriptions = vertex_desc.attributes.data();
-
-	pipe_builder.vertex_in_info.vertexBindingDescriptionCount = vertex_desc.bindings.size();
-	pipe_builder.vertex_in_info.pVertexBindingDescriptions = vertex_desc.bindings.data();
-
-
-	pipe_builder.shader_stages.push_back(
-			vkinit::shader_stage_create_info( VK_SHADER_STAGE_VERTEX_BIT, triVert ));
-
-	pipe_builder.shader_stages.push_back(
-			vkinit::shader_stage_create_info( VK_SHADER_STAGE_FRAGMENT_BIT, triFrag ));
-
-
-	pipe_builder.input_assembly = vkinit::input_assembly_state_create_info( VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST );
-
-	pipe_builder.viewport.x = 0;
-	pipe_builder.viewport.y = 0;
-	pipe_builder.viewport.width = windowExtent.width;
-	pipe_builder.viewport.height = windowExtent.height;
-	pipe_builder.viewport.minDepth = 0;
-	pipe_builder.viewport.maxDepth = 1;
+	create_material( MATERIAL_DEFAULT, "default" );
 
-	pipe_builder.scissor.offset = { 0, 0 };
-	pipe_builder.scissor.extent = windowExtent;
+	grid.init( *this, vk_render_pass );
 
-	pipe_builder.rasterizer = vkinit::rasterization_state_create_info( VK_POLYGON_MODE_FILL );
-	pipe_builder.multisample_state = vkinit::multisample_state_create_info();
-	pipe_builder.color_blend = vkinit::color_blend_attachment_state();
-	pipe_builder.depth_stencil_state = vkinit::depth_stencil_state_create_info( VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL );
-	pipe_builder.pipeline_layout = triangle_layout;
+	fog.init( *this, vk_render_pass );
+	graph.set_image( rg_fog, fog.image.image, fog.view );
 
-	VkPipeline triangle_pipeline;
+	overlay.init( *this, vk_render_pass );
 
-	triangle_pipeline = pipe_builder.build_pipeline( vk_device, vk_render_pass );
+	shadows.init( *this, graph.get_pass( "shadow_static" )->render_pass );
+	graph.set_image( rg_shadow_cache, shadows.cache.image, shadows.cache_view );
+	graph.set_image( rg_shadow_atlas, shadows.atlas.image, shadows.atlas_view );
 
-	vkDestroyShaderModule( vk_device, triVert, nullptr );
-	vkDestroyShaderModule( vk_device, triFrag, nullptr );
+	hiz.init( *this, windowExtent, graph.resources[rg_depth].view );
+	graph.set_image( rg_hiz, hiz.pyramid.image, hiz.view );
 
-	deletion_queue.emplace_function( [this, triangle_pipeline](){ vkDestroyPipeline( vk_device, triangle_pipeline, nullptr); });
+	impostors.init( *this, graph.get_pass( "impostor_bake" )->render_pass, vk_render_pass );
+	graph.set_image( rg_impostor_atlas, impostors.atlas.image, impostors.atlas_view );
+	graph.set_buffer( rg_impostor_list, impostors.list.buffer );
+	graph.set_buffer( rg_impostor_draw, impostors.draw_cmd.buffer );
 
-	create_material( triangle_pipeline, triangle_layout, "default" );
+	indirect.init( *this, vk_render_pass );
+	graph.set_buffer( rg_gpu_draws, indirect.draws.buffer );
+	graph.set_buffer( rg_gpu_visible, indirect.visible.buffer );
 }
 
 VkPipeline PipelineBuilder::build_pipeline( VkDevice dev, VkRenderPass pass ){
@@ -617,10 +949,18 @@ VkPipeline PipelineBuilder::build_pipeline( VkDevice dev, VkRenderPass pass ){
 		.pNext = nullptr,
 		.logicOpEnable = VK_FALSE,
 		.logicOp = VK_LOGIC_OP_COPY,
-		.attachmentCount = 1,
+		.attachmentCount = color_attachment_count,
 		.pAttachments = &color_blend,
 	};
 
+	VkPipelineDynamicStateCreateInfo dynamic_cr_inf{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.dynamicStateCount = static_cast<uint32_t>( dynamic_states.size() ),
+		.pDynamicStates = dynamic_states.data(),
+	};
+
 	VkGraphicsPipelineCreateInfo pipe_cr_inf{
 		.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
 		.pNext = nullptr,
@@ -633,6 +973,7 @@ VkPipeline PipelineBuilder::build_pipeline( VkDevice dev, VkRenderPass pass ){
 		.pMultisampleState = &multisample_state,
 		.pDepthStencilState = &depth_stencil_state,
 		.pColorBlendState = &color_blend_cr_inf,
+		.pDynamicState = dynamic_states.empty() ? nullptr : &dynamic_cr_inf,
 		.layout = pipeline_layout,
 		.renderPass = pass,
 		.subpass = 0,
@@ -666,10 +1007,6 @@ void VkEngine::load_meshes(){
 
 	//we don't care about the vertex normals
 
-	upload_mesh(triangle_mesh);
-
-	meshes["triangle"] = triangle_mesh;
-
 	Mesh plate;
 	plate.vertices.resize( 6 );
 
@@ -710,108 +1047,376 @@ void VkEngine::load_meshes(){
 		.uv1_uv2 = { 1.0f, 1.0f, 0.0f, 0.0f },
 	};
 
+	//LOD chains are built as jobs, only the uploads need this thread
+	JobHandle triangle_lods = jobs.submit( [&]{ generate_lods( triangle_mesh ); });
+	JobHandle plate_lods = jobs.submit( [&]{ generate_lods( plate ); });
+	jobs.wait( triangle_lods );
+	jobs.wait( plate_lods );
+
+	upload_mesh(triangle_mesh);
+
+	add_mesh( std::move( triangle_mesh ), "triangle" );
+
 	upload_mesh( plate );
 
-	meshes["plane"] = plate;
+	add_mesh( std::move( plate ), "plane" );
+}
+
+PipelineHandle VkEngine::create_pipeline( VkPipeline pipeline, VkPipelineLayout layout, const std::string& name ){
+	PipelineHandle h = pipelines.insert( Pipeline{
+			.pipeline = pipeline,
+			.layout = layout,
+		});
+	pipeline_names.set( name, h );
+	return h;
+}
+
+MaterialHandle VkEngine::create_material( PipelineHandle pipeline, const std::string& name ){
+	MaterialHandle h = materials.insert( Material{
+			.pipeline = pipeline,
+		});
+	material_names.set( name, h );
+	return h;
 }
 
-Material* VkEngine::create_material( VkPipeline pipeline, VkPipelineLayout layout, const std::string& name ){
-	Material mat{
-		.pipeline = pipeline,
-		.layout = layout,
+MaterialHandle VkEngine::create_material( uint32_t features, const std::string& name ){
+	MaterialHandle h = create_material( scene_pipeline( features ), name );
+	materials.get( h )->features = features;
+	return h;
+}
+
+PipelineHandle VkEngine::scene_pipeline( uint32_t features ){
+	auto it = scene_permutations.find( features );
+	if( it != scene_permutations.end() )
+		return it->second;
+
+	MaterialSpecialization spec( features );
+
+	PipelineBuilder pipe_builder;
+
+	//Vertices are pulled from the geometry arena in set 0
+	pipe_builder.vertex_in_info = vkinit::vertex_input_state_create_info();
+
+	pipe_builder.shader_stages.push_back(
+			vkinit::shader_stage_create_info( VK_SHADER_STAGE_VERTEX_BIT, scene_vert ));
+
+	pipe_builder.shader_stages.push_back(
+			vkinit::shader_stage_create_info( VK_SHADER_STAGE_FRAGMENT_BIT, scene_frag ));
+	pipe_builder.shader_stages.back().pSpecializationInfo = &spec.info;
+
+	pipe_builder.input_assembly = vkinit::input_assembly_state_create_info( VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST );
+
+	pipe_builder.viewport.x = 0;
+	pipe_builder.viewport.y = 0;
+	pipe_builder.viewport.width = windowExtent.width;
+	pipe_builder.viewport.height = windowExtent.height;
+	pipe_builder.viewport.minDepth = 0;
+	pipe_builder.viewport.maxDepth = 1;
+
+	pipe_builder.scissor.offset = { 0, 0 };
+	pipe_builder.scissor.extent = windowExtent;
+
+	pipe_builder.rasterizer = vkinit::rasterization_state_create_info( VK_POLYGON_MODE_FILL );
+	pipe_builder.multisample_state = vkinit::multisample_state_create_info();
+	pipe_builder.color_blend = vkinit::color_blend_attachment_state();
+	pipe_builder.depth_stencil_state = vkinit::depth_stencil_state_create_info( VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL );
+	pipe_builder.pipeline_layout = scene_layout;
+
+	VkPipeline pipeline = pipe_builder.build_pipeline( vk_device, vk_render_pass );
+
+	deletion_queue.push( pipeline );
+
+	PipelineHandle h = create_pipeline( pipeline, scene_layout, "scene_" + std::to_string( features ));
+	scene_permutations.emplace( features, h );
+	return h;
+}
+
+MaterialSpecialization::MaterialSpecialization( uint32_t features ){
+	for( uint32_t i = 0; i < MATERIAL_FEATURE_COUNT; ++i ){
+		values[i] = ( features >> i ) & 1u ? VK_TRUE : VK_FALSE;
+		entries[i] = VkSpecializationMapEntry{
+			.constantID = i,
+			.offset = static_cast<uint32_t>( i * sizeof( VkBool32 )),
+			.size = sizeof( VkBool32 ),
+		};
+	}
+
+	info = VkSpecializationInfo{
+		.mapEntryCount = MATERIAL_FEATURE_COUNT,
+		.pMapEntries = entries,
+		.dataSize = sizeof( values ),
+		.pData = values,
 	};
-	materials[name] = mat;
-	return &materials[name];
 }
 
-Material* VkEngine::get_material( const std::string& name ){
-	auto it = materials.find( name );
-	if( it == materials.end() )
-		return nullptr;
-	else
-		return &it->second;
+MeshHandle VkEngine::add_mesh( Mesh&& mesh, const std::string& name ){
+	MeshHandle h = meshes.insert( std::move( mesh ));
+	mesh_names.set( name, h );
+	return h;
 }
 
-Mesh* VkEngine::get_mesh( const std::string& name ){
-	auto it = meshes.find( name );
-	if( it == meshes.end() )
-		return nullptr;
-	else
-		return &it->second;
+TextureHandle VkEngine::add_texture( const Texture& tex, const std::string& name ){
+	TextureHandle h = textures.insert( tex );
+	texture_names.set( name, h );
+	return h;
 }
 
-void VkEngine::draw_objects( VkCommandBuffer cmd, RenderableObject* first, int count ){
+PipelineHandle VkEngine::find_pipeline( const std::string& name ){
+	return pipeline_names.find( name );
+}
 
-	//cam.rotate_around_origin( 0.02 );
+MaterialHandle VkEngine::find_material( const std::string& name ){
+	return material_names.find( name );
+}
 
-	glm::mat4 proj = cam.get_proj();
-	glm::mat4 view = cam.get_view();
+MeshHandle VkEngine::find_mesh( const std::string& name ){
+	return mesh_names.find( name );
+}
 
-	GpuCamData cam_data{
-		.view = view,
-		.proj = proj,
-		.view_proj = proj * view,
+TextureLoad VkEngine::load_texture( const std::string& path, const std::string& name ){
+	Texture* placeholder = textures.get( placeholder_texture );
+
+	TextureHandle h = add_texture( Texture{
+			.img = placeholder->img,
+			.view = placeholder->view,
+			.borrowed = true,
+			.path = path,
+			.loading = true,
+		}, name );
+
+	return TextureLoad{
+		.handle = h,
+		.loaded = stream_texture( h, path ),
 	};
+}
 
-	void* data;
-	vmaMapMemory( vma_alloc, get_curr_frame().camera_buf.allocation, &data );
-	memcpy( data, &cam_data, sizeof( GpuCamData ));
-	vmaUnmapMemory( vma_alloc, get_curr_frame().camera_buf.allocation );
+Task<bool> VkEngine::stream_texture( TextureHandle handle, std::string path ){
+	//Reading and decoding run as jobs
+	co_await resume_on( jobs );
+
+	std::vector<uint8_t> data;
+	AllocatedBuffer staging;
+	AllocatedImage img;
+	VkExtent3D extent;
+
+	if( !vkutil::read_file( path.c_str(), data ) || !vkutil::decode_image( *this, data, staging, img, extent )){
+		std::cout << "Failed to load texture " << path << std::endl;
+		co_return false;
+	}
+
+	data = {};
+
+	//Continues on the render thread at the start of a frame after the one that copied it
+	bool copied = co_await uploads.upload_image( staging, img, extent );
+
+	//Shutting down, the device is idle
+	if( !copied ){
+		vmaDestroyBuffer( vma_alloc, staging.buffer, staging.allocation );
+		vmaDestroyImage( vma_alloc, img.image, img.allocation );
+		co_return false;
+	}
+
+	VkImageView view;
+	auto view_cr = vkinit::image_view_create_info( VK_FORMAT_R8G8B8A8_SRGB, img.image, VK_IMAGE_ASPECT_COLOR_BIT );
+	VK_CHECK( vkCreateImageView( vk_device, &view_cr, nullptr, &view ));
+
+	Texture* tex = textures.get( handle );
+
+	//Unloaded while it was streaming
+	if( !tex ){
+		retire( view );
+		retire( img );
+		co_return false;
+	}
+
+	if( !tex->borrowed ){
+		retire( tex->view );
+		retire( tex->img );
+	}
+
+	VmaAllocationInfo alloc_info;
+	vmaGetAllocationInfo( vma_alloc, img.allocation, &alloc_info );
+
+	tex->img = img;
+	tex->view = view;
+	tex->borrowed = false;
+	tex->bytes = alloc_info.size;
+	tex->loading = false;
+	++tex->version;
+
+	std::cout << "Loaded image " << path << std::endl;
+
+	co_return true;
+}
+
+void VkEngine::evict_texture( TextureHandle h ){
+	Texture* tex = textures.get( h );
+	Texture* placeholder = textures.get( placeholder_texture );
+
+	if( !tex || !placeholder || tex->borrowed )
+		return;
+
+	retire( tex->view );
+	retire( tex->img );
+
+	tex->img = placeholder->img;
+	tex->view = placeholder->view;
+	tex->borrowed = true;
+	tex->bytes = 0;
+	++tex->version;
+}
+
+void VkEngine::reload_texture( TextureHandle h ){
+	Texture* tex = textures.get( h );
+
+	//A failed load keeps loading set, so a missing file is not read again every frame
+	if( !tex || !tex->borrowed || tex->loading || tex->path.empty() )
+		return;
+
+	tex->loading = true;
+	stream_texture( h, tex->path );
+}
+
+void VkEngine::set_material_texture( MaterialHandle h, TextureHandle texture, VkSampler sampler ){
+	Material* mat = materials.get( h );
+	Texture* tex = textures.get( texture );
+
+	if( !mat || !tex )
+		return;
+
+	//Frames in flight may still bind the old set
+	if( mat->tex_set )
+		retire( PooledDescriptorSet{ mat->tex_pool, mat->tex_set });
+	++draw_version;
+
+	PooledDescriptorSet pooled = descriptors.allocate( single_tex_layout );
+	mat->tex_set = pooled.set;
+	mat->tex_pool = pooled.pool;
+
+	VkDescriptorImageInfo img_inf{
+		.sampler = sampler,
+		.imageView = tex->view,
+		.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+	};
+
+	auto write = vkinit::write_descriptor_set_image( VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, mat->tex_set, &img_inf, 0 );
+	vkUpdateDescriptorSets( vk_device, 1, &write, 0, nullptr );
+
+	mat->texture = texture;
+	mat->sampler = sampler;
+	mat->texture_version = tex->version;
+}
+
+void VkEngine::refresh_materials(){
+	for( uint32_t i = 0; i < materials.size(); ++i ){
+		Material& mat = materials.data[i];
+		Texture* tex = textures.get( mat.texture );
+
+		if( !tex || tex->version == mat.texture_version )
+			continue;
 
-	Mesh* last_mesh = nullptr;
-	Material* last_mat = nullptr;
+		MaterialHandle h = materials.handle_of( i );
+		set_material_texture( h, mat.texture, mat.sampler );
+
+		//Impostors of the material were baked with the old image
+		impostors.rebake( h );
+	}
+}
+
+TextureHandle VkEngine::find_texture( const std::string& name ){
+	return texture_names.find( name );
+}
+
+void VkEngine::unload_mesh( MeshHandle h ){
+	Mesh* mesh = meshes.get( h );
+	if( !mesh )
+		return;
+
+	geometry.release( *this, *mesh );
+	meshes.remove( h );
+	++draw_version;
+	mesh_names.erase( h );
+}
+
+void VkEngine::unload_texture( TextureHandle h ){
+	Texture* tex = textures.get( h );
+	if( !tex )
+		return;
+
+	if( !tex->borrowed ){
+		retire( tex->view );
+		retire( tex->img );
+	}
+	textures.remove( h );
+	texture_names.erase( h );
+}
+
+void VkEngine::draw_objects( VkCommandBuffer cmd, RenderableObject* first, int count ){
+
+	//cam.rotate_around_origin( 0.02 );
+
+	MeshHandle last_mesh{};
+	MaterialHandle last_mat{};
+
+	Mesh* mesh = nullptr;
+	Pipeline* pipe = nullptr;
+
+	//Indirect commands are indexed like this frame's visible objects
+	size_t indirect_count = first == objects.data() ? hiz.draw_count : 0;
 
 	for( size_t i = 0; i < count; ++i ){
 		RenderableObject& curr = first[i];
 
 		if( curr.mat != last_mat ){
-			vkCmdBindPipeline( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, curr.mat->pipeline );
+			Material* mat = materials.get( curr.mat );
+			pipe = mat ? pipelines.get( mat->pipeline ) : nullptr;
 			last_mat = curr.mat;
 
-			vkCmdBindDescriptorSets( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, curr.mat->layout, 0, 1, &get_curr_frame().global_desc, 0, nullptr );
+			//Stale handle, the asset was unloaded
+			if( !pipe )
+				continue;
 
-			if( curr.mat->tex_set ){
-				vkCmdBindDescriptorSets( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, curr.mat->layout, 1, 1, &curr.mat->tex_set, 0, nullptr );
+			vkCmdBindPipeline( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipe->pipeline );
+
+			vkCmdBindDescriptorSets( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipe->layout, 0, 1, &get_curr_frame().global_desc, 0, nullptr );
+
+			touch_texture( mat->texture );
+
+			if( mat->tex_set ){
+				vkCmdBindDescriptorSets( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipe->layout, 1, 1, &mat->tex_set, 0, nullptr );
 			}
 		}
 
+		if( curr.mesh != last_mesh ){
+			mesh = meshes.get( curr.mesh );
+			last_mesh = curr.mesh;
+		}
+
+		if( !pipe || !mesh )
+			continue;
+
 		PushConstants consts{
 			.camera = curr.transform /* * glm::rotate( frameNumber * 0.04f, glm::vec3{ 0.0f, 1.0f, 0.0f }) */,
 		};
 
-		vkCmdPushConstants( cmd, curr.mat->layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof( PushConstants ), &consts );
+		vkCmdPushConstants( cmd, pipe->layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof( PushConstants ), &consts );
 
-		if( curr.mesh != last_mesh ){
-			VkDeviceSize off = 0;
-			vkCmdBindVertexBuffers( cmd, 0, 1, &curr.mesh->buffer.buffer, &off );
-			last_mesh = curr.mesh;
+		//Instance count is 0 if the Hi-Z pass found the object occluded
+		if( i < indirect_count ){
+			vkCmdDrawIndirect( cmd, hiz.current_draws( *this ), i * sizeof( VkDrawIndirectCommand ), 1, sizeof( VkDrawIndirectCommand ));
+		} else {
+			const MeshLod& lod = mesh->lods[std::min<size_t>( curr.lod, mesh->lods.size() - 1 )];
+			vkCmdDraw( cmd, lod.vertex_count, 1, mesh->base_vertex + lod.first_vertex, 0 );
 		}
-
-		vkCmdDraw( cmd, curr.mesh->vertices.size(), 1, 0, 0 );
 	}
 }
 
 void VkEngine::upload_mesh( Mesh& mesh ){
-	VkBufferCreateInfo buf_cr_inf{
-		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-		.pNext = nullptr,
-		.size = mesh.vertices.size() * sizeof( Vertex ),
-		.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-	};
-
-	VmaAllocationCreateInfo vma_alloc_inf {
-		.usage = VMA_MEMORY_USAGE_CPU_TO_GPU,
-	};
-
-	VK_CHECK( vmaCreateBuffer( vma_alloc, &buf_cr_inf, &vma_alloc_inf, &mesh.buffer.buffer, &mesh.buffer.allocation, nullptr ));
+	//Import time, every level lives in the same range
+	if( mesh.lods.empty() )
+		generate_lods( mesh );
 
-	deletion_queue.emplace_function( [this, mesh](){ vmaDestroyBuffer( vma_alloc, mesh.buffer.buffer, mesh.buffer.allocation ); });
-
-	void* data;
-
-	vmaMapMemory( vma_alloc, mesh.buffer.allocation, &data );
-	memcpy( data, mesh.vertices.data(), mesh.vertices.size() * sizeof( Vertex ));
-	vmaUnmapMemory( vma_alloc, mesh.buffer.allocation );
+	geometry.upload( *this, mesh );
 }
 
 void VkEngine::init_scene(){
@@ -821,8 +1426,8 @@ void VkEngine::init_scene(){
 
 
 	RenderableObject tri{
-		.mesh = get_mesh( "plane" ),
-		.mat = get_material( "default" ),
+		.mesh = find_mesh( "plane" ),
+		.mat = find_material( "default" ),
 		.transform = glm::mat4( 1.0f ),
 	};
 
@@ -831,40 +1436,49 @@ void VkEngine::init_scene(){
 	VkSampler block_sampler;
 	vkCreateSampler( vk_device, &sampler_inf, nullptr, &block_sampler );
 
-	deletion_queue.emplace_function( [this, block_sampler](){
-			vkDestroySampler( vk_device, block_sampler, nullptr );
-		});
+	deletion_queue.push( block_sampler );
 
-	VkDescriptorSetAllocateInfo alloc_inf{
-		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-		.pNext = nullptr,
-		.descriptorPool = desc_pool,
-		.descriptorSetCount = 1,
-		.pSetLayouts = &single_tex_layout,
-	};
+	//Still the placeholder while the file streams in, refresh_materials() picks up the swap
+	set_material_texture( tri.mat, find_texture( "outline" ), block_sampler );
 
-	vkAllocateDescriptorSets( vk_device, &alloc_inf, &tri.mat->tex_set );
+	//Unit plate in the xy plane
+	glm::vec4 plane_bounds{ 0.0f, 0.0f, 0.0f, 0.7072f };
 
-	VkDescriptorImageInfo img_inf{
-		.sampler = block_sampler,
-		.imageView = textures["outline"].view,
-		.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-	};
+	//The board lines come from the grid renderer, this is a single token on the centre cell
+	tri.transform = glm::translate( glm::vec3{ 0.0f, 0.01f, 0.0f }) * glm::rotate<float>( 0.5 * M_PI, glm::vec3{ 1.0f, 0.0f, 0.0f });
 
-	auto tex1_write = vkinit::write_descriptor_set_image( VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, tri.mat->tex_set, &img_inf, 0 );
+	//Markers are dropped on the board and attached to the token they land on, which puts the token before them
+	token_marker = scene.create( glm::translate( glm::vec3{ 0.0f, 0.8f, 0.0f }) * glm::scale( glm::vec3{ 0.3f }), tri.mesh, tri.mat, plane_bounds );
+	token = scene.create( tri.transform, tri.mesh, tri.mat, plane_bounds );
 
-	vkUpdateDescriptorSets( vk_device, 1, &tex1_write, 0, nullptr );
+	//Relative to the token, which lies in its xy plane facing down
+	scene.set_parent( token_marker, token );
+	scene.set_transform( token_marker, glm::translate( glm::vec3{ 0.0f, 0.0f, -0.8f }) * glm::scale( glm::vec3{ 0.3f }));
 
-	for( int y = 0; y < 21; ++y ){
-		for( int x = 0; x < 21; ++x ){
-			tri.transform = glm::translate( glm::vec3{ x - 10.0f, 0, y - 10.0f }) * glm::rotate<float>( 0.5 * M_PI, glm::vec3{ 1.0f, 0.0f, 0.0f });
-			objects.push_back( tri );
-		}
+	//Far away the token is a billboard of its baked views
+	impostors.enable( *this, tri.mesh, tri.mat );
+
+	//The token sees 6 cells around it, a short wall to its east casts a shadow
+	fog.add_source( glm::vec2{ 0.0f, 0.0f }, 6.0f );
+	fog.add_wall( glm::vec2{ 2.0f, -2.0f }, glm::vec2{ 2.0f, 2.0f });
+
+	//One upright plate per cell along the wall, baked into the static layer and the torch's cached shadow
+	for( int32_t cell = -2; cell < 2; ++cell ){
+		static_layer.add( StaticInstance{
+				.mesh = tri.mesh,
+				.mat = tri.mat,
+				.transform = glm::translate( glm::vec3{ 2.0f, 0.5f, cell + 0.5f }) * glm::rotate<float>( 0.5 * M_PI, glm::vec3{ 0.0f, 1.0f, 0.0f }),
+			});
 	}
+
+	//A torch next to the token and a dimmer, cold light across the wall
+	auto torch = lights.add_light( PointLight{ .pos = { 1.0f, 1.5f, 1.0f }, .radius = 8.0f, .color = { 1.0f, 0.7f, 0.4f }, .intensity = 1.5f });
+	shadows.enable( lights, torch );
+	lights.add_light( PointLight{ .pos = { 4.0f, 1.5f, 0.0f }, .radius = 6.0f, .color = { 0.4f, 0.5f, 1.0f }, .intensity = 1.0f });
 }
 
 FrameData& VkEngine::get_curr_frame(){
-	return frames[frameNumber % FRAME_OVERLAP];
+	return frames.get( frameNumber );
 }
 
 AllocatedBuffer VkEngine::create_buffer( size_t size, VkBufferUsageFlags usage, VmaMemoryUsage memory_usage ){
@@ -888,18 +1502,38 @@ AllocatedBuffer VkEngine::create_buffer( size_t size, VkBufferUsageFlags usage,
 
 void VkEngine::init_descriptors(){
 
-	VkDescriptorSetLayoutBinding binding{
-		.binding = 0,
-		.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-		.descriptorCount = 1,
-		.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
-	};
-
-	VkDescriptorSetLayoutCreateInfo desc_set_lay_cr_inf{
-		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-		.pNext = nullptr,
-		.bindingCount = 1,
-		.pBindings = &binding,
+	//Camera, the light list, light clusters, the shadow atlas and the geometry arena's vertices
+	VkDescriptorSetLayoutBinding bindings[5]{
+		{
+			.binding = 0,
+			.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT,
+		},
+		{
+			.binding = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT,
+		},
+		{
+			.binding = 2,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT,
+		},
+		{
+			.binding = 3,
+			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+		},
+		{
+			.binding = 4,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+		},
 	};
 
 	VkDescriptorSetLayoutBinding binding_tex {
@@ -909,57 +1543,23 @@ void VkEngine::init_descriptors(){
 		.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
 	};
 
-	VkDescriptorSetLayoutCreateInfo desc_set_tex_cr_inf {
-		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-		.pNext = nullptr,
-		.bindingCount = 1,
-		.pBindings = &binding_tex,
-	};
-
-	vkCreateDescriptorSetLayout( vk_device, &desc_set_lay_cr_inf, nullptr, &global_desc_layout );
-	vkCreateDescriptorSetLayout( vk_device, &desc_set_tex_cr_inf, nullptr, &single_tex_layout );
-
-	deletion_queue.emplace_function( [this](){
-			vkDestroyDescriptorSetLayout( vk_device, single_tex_layout, nullptr );
-			vkDestroyDescriptorSetLayout( vk_device, global_desc_layout, nullptr );
-		});
-
-	std::vector<VkDescriptorPoolSize> sizes =
-	{
-		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 10 },
-		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 10 },
-	};
-
-	VkDescriptorPoolCreateInfo desc_pool_cr_inf{
-		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-		.pNext = nullptr,
-		.flags = 0,
-		.maxSets = 10,
-		.poolSizeCount = static_cast<uint32_t>( sizes.size() ),
-		.pPoolSizes = sizes.data(),
-	};
+	layouts.init( vk_device );
+	global_desc_layout = layouts.get( bindings, 5 );
+	single_tex_layout = layouts.get( &binding_tex, 1 );
 
-	vkCreateDescriptorPool( vk_device, &desc_pool_cr_inf, nullptr, &desc_pool );
+	//Material sets are replaced when their texture finished streaming
+	descriptors.init( vk_device, VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT );
 
-	deletion_queue.emplace_function( [this](){ vkDestroyDescriptorPool( vk_device, desc_pool, nullptr ); });
+	for( size_t i = 0; i < frames.size(); ++i )
+		frames[i].descriptors.init( vk_device, 0 );
 
 
-	for( size_t i = 0; i < FRAME_OVERLAP; ++i ){
+	for( size_t i = 0; i < frames.size(); ++i ){
 		frames[i].camera_buf = create_buffer( sizeof( GpuCamData ), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU );
 
-		deletion_queue.emplace_function( [this, i](){
-				vmaDestroyBuffer( vma_alloc, frames[i].camera_buf.buffer, frames[i].camera_buf.allocation );
-			});
-
-		VkDescriptorSetAllocateInfo alloc_inf{
-			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-			.pNext = nullptr,
-			.descriptorPool = desc_pool,
-			.descriptorSetCount = 1,
-			.pSetLayouts = &global_desc_layout,
-		};
+		deletion_queue.push( frames[i].camera_buf );
 
-		vkAllocateDescriptorSets( vk_device, &alloc_inf, &frames[i].global_desc );
+		frames[i].global_desc = descriptors.allocate( global_desc_layout ).set;
 
 		VkDescriptorBufferInfo buf_inf{
 			.buffer = frames[i].camera_buf.buffer,
@@ -967,21 +1567,43 @@ void VkEngine::init_descriptors(){
 			.range = sizeof( GpuCamData ),
 		};
 
-		VkWriteDescriptorSet set_write{
-			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-			.pNext = nullptr,
-			.dstSet = frames[i].global_desc,
-			.dstBinding = 0,
-			.descriptorCount = 1,
-			.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-			.pBufferInfo = &buf_inf,
+		VkDescriptorBufferInfo vertex_inf{
+			.buffer = geometry.vertices.buffer,
+			.offset = 0,
+			.range = VK_WHOLE_SIZE,
+		};
+
+		VkWriteDescriptorSet set_writes[2]{
+			{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.pNext = nullptr,
+				.dstSet = frames[i].global_desc,
+				.dstBinding = 0,
+				.descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+				.pBufferInfo = &buf_inf,
+			},
+			{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.pNext = nullptr,
+				.dstSet = frames[i].global_desc,
+				.dstBinding = 4,
+				.descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.pBufferInfo = &vertex_inf,
+			},
 		};
 
-		vkUpdateDescriptorSets( vk_device, 1, &set_write, 0, nullptr );
+		vkUpdateDescriptorSets( vk_device, 2, set_writes, 0, nullptr );
 	}
+
+	lights.init( *this );
+	graph.set_buffer( rg_clusters, lights.clusters.buffer );
 }
 
 void VkEngine::immediate_submit( std::function<void( VkCommandBuffer )>&& func ){
+	std::lock_guard<std::mutex> guard( upload_context.lock );
+
 	VkCommandBufferAllocateInfo cmd_alloc = vkinit::command_buffer_allocate_info( upload_context.cmd_pool );
 
 	VkCommandBuffer buf;
@@ -1016,15 +1638,15 @@ void VkEngine::immediate_submit( std::function<void( VkCommandBuffer )>&& func )
 }
 
 void VkEngine::load_images(){
-	Texture outline;
+	//Mid grey, created up front so every loading texture has something to show
+	uint32_t grey = 0xff808080;
 
-	vkutil::load_image_file( *this, FILE_PREFIX "assets/outline.png", outline.img );
+	Texture placeholder;
+	vkutil::create_image( *this, &grey, VkExtent3D{ 1, 1, 1 }, placeholder.img );
 
-	auto view_cr = vkinit::image_view_create_info( VK_FORMAT_R8G8B8A8_SRGB, outline.img.image, VK_IMAGE_ASPECT_COLOR_BIT );
-	VK_CHECK( vkCreateImageView( vk_device, &view_cr, nullptr, &outline.view ));
-	deletion_queue.emplace_function( [this, outline](){
-			vkDestroyImageView( vk_device, outline.view, nullptr );
-		});
+	auto view_cr = vkinit::image_view_create_info( VK_FORMAT_R8G8B8A8_SRGB, placeholder.img.image, VK_IMAGE_ASPECT_COLOR_BIT );
+	VK_CHECK( vkCreateImageView( vk_device, &view_cr, nullptr, &placeholder.view ));
+	placeholder_texture = add_texture( placeholder, "placeholder" );
 
-	textures["outline"] = outline;
+	load_texture( FILE_PREFIX "assets/outline.png", "outline" );
 }
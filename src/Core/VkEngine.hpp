@@ -2,48 +2,121 @@
 
 #include "VkTypes.hpp"
 #include "VkMesh.hpp"
+#include "VkFrameRing.hpp"
+#include "VkDeletion.hpp"
+#include "VkDescriptors.hpp"
+#include "VkSlotMap.hpp"
+#include "VkGrid.hpp"
+#include "VkFog.hpp"
+#include "VkGeometry.hpp"
+#include "VkLights.hpp"
+#include "VkShadows.hpp"
+#include "VkHiZ.hpp"
+#include "VkIndirect.hpp"
+#include "VkImpostors.hpp"
+#include "VkOverlay.hpp"
+#include "VkResidency.hpp"
+#include "VkUploads.hpp"
+#include "VkRenderGraph.hpp"
 #include "Camera/StrategyCam.hpp"
+#include "Jobs/JobSystem.hpp"
+#include "Jobs/Task.hpp"
+#include "Scene/SceneStore.hpp"
+#include "Scene/StaticLayer.hpp"
 
 #include <vk_mem_alloc.h>
 
+#include <chrono>
 #include <vector>
-#include <deque>
 #include <functional>
-#include <unordered_map>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vulkan/vulkan_core.h>
 
-struct DelQueue {
-	std::deque<std::function<void()>> deleters;
+struct Pipeline {
+	VkPipeline pipeline;
+	VkPipelineLayout layout;
+};
 
-	inline void emplace_function( std::function<void()>&& func ){
-		deleters.emplace_back( std::move( func ));
-	}
+struct Texture {
+	AllocatedImage img;
+	VkImageView view;
+	//Bumped when img and view are swapped, e.g. once a streamed texture replaced its placeholder
+	uint32_t version{ 0 };
+	//Shows the image of another texture (the placeholder) and does not own it
+	bool borrowed{ false };
+
+	//Streamed textures can be evicted and loaded again from their file
+	std::string path;
+	VkDeviceSize bytes{ 0 };
+	uint64_t last_used{ 0 };
+	bool loading{ false };
+};
 
-	inline void flush(){
-		for( auto it = deleters.rbegin(); it != deleters.rend(); ++it ){
-			(*it)();
-		}
+struct Material;
 
-		deleters.clear();
-	}
+using MeshHandle = Handle<Mesh>;
+using MaterialHandle = Handle<Material>;
+using TextureHandle = Handle<Texture>;
+using PipelineHandle = Handle<Pipeline>;
+
+//Permutations of triangle.frag, bit n is its specialization constant n
+enum MaterialFeatures : uint32_t {
+	MATERIAL_TEXTURE = 1 << 0,			//Albedo from tex_set, white otherwise
+	MATERIAL_VERTEX_COLOR = 1 << 1,		//Albedo times the vertex color
+	MATERIAL_LIGHTING = 1 << 2,			//Clustered lights and shadows, unlit albedo otherwise
+};
+
+constexpr uint32_t MATERIAL_FEATURE_COUNT = 3;
+constexpr uint32_t MATERIAL_DEFAULT = MATERIAL_TEXTURE | MATERIAL_LIGHTING;
+
+//Specialization info for one permutation, points into itself so it is not copied
+struct MaterialSpecialization {
+	VkBool32 values[MATERIAL_FEATURE_COUNT];
+	VkSpecializationMapEntry entries[MATERIAL_FEATURE_COUNT];
+	VkSpecializationInfo info;
+
+	explicit MaterialSpecialization( uint32_t features );
+	MaterialSpecialization( const MaterialSpecialization& ) = delete;
+	MaterialSpecialization& operator=( const MaterialSpecialization& ) = delete;
 };
 
 struct Material {
 	VkDescriptorSet tex_set{ VK_NULL_HANDLE };
-	VkPipeline pipeline;
-	VkPipelineLayout layout;
+	//Pool tex_set came from, to retire it
+	VkDescriptorPool tex_pool{ VK_NULL_HANDLE };
+	PipelineHandle pipeline;
+	//MaterialFeatures the pipeline was specialized for
+	uint32_t features{ MATERIAL_DEFAULT };
+
+	//What tex_set was written with, it is rewritten once the texture's version moves on
+	TextureHandle texture;
+	VkSampler sampler{ VK_NULL_HANDLE };
+	uint32_t texture_version{ 0 };
 };
 
-struct Texture {
-	AllocatedImage img;
-	VkImageView view;
+//Returned by VkEngine::load_texture. co_await yields the handle once the file replaced the placeholder
+struct TextureLoad {
+	//Usable at once, shows the placeholder until the load finished
+	TextureHandle handle;
+	//False if the file could not be loaded, the placeholder then stays
+	Task<bool> loaded;
+
+	inline bool await_ready() const noexcept { return loaded.await_ready(); }
+	inline bool await_suspend( std::coroutine_handle<> h ) noexcept { return loaded.await_suspend( h ); }
+	inline TextureHandle await_resume(){
+		loaded.await_resume();
+		return handle;
+	}
 };
 
 struct RenderableObject {
-	Mesh* mesh;
-	Material* mat;
+	MeshHandle mesh;
+	MaterialHandle mat;
 	glm::mat4 transform;
+	glm::vec4 bounds{};		//World space bounding sphere
+	uint32_t lod{ 0 };
 };
 
 struct FrameData {
@@ -52,9 +125,18 @@ struct FrameData {
 
 	VkCommandPool cmd_pool;
 	VkCommandBuffer main_buf;
+	//Secondaries of the main pass. scene_buf is kept while draw_version stays at scene_version
+	VkCommandBuffer scene_buf, dynamic_buf;
+	uint64_t scene_version{ UINT64_MAX };
 
 	AllocatedBuffer camera_buf;
 	VkDescriptorSet global_desc;
+
+	//Sets used by this frame only, reset after render_fence
+	DescriptorAllocator descriptors;
+
+	//Retired while this slot was current, destroyed after its render_fence
+	DeletionQueue deletions;
 };
 
 struct GpuCamData {
@@ -66,6 +148,15 @@ struct GpuCamData {
 struct UploadContext {
 	VkFence fence;
 	VkCommandPool cmd_pool;
+
+	//Startup phases running concurrently may all submit
+	std::mutex lock;
+};
+
+struct StartupPhase {
+	const char* name;
+	float start_ms{ 0.0f };		//Since init() was called
+	float duration_ms{ 0.0f };
 };
 
 struct VkEngine {
@@ -74,30 +165,114 @@ struct VkEngine {
 		bool initialized{ false };
 		int frameNumber{ 0 };
 
+		//Frames the CPU may record ahead of the GPU, set before init()
+		constexpr static uint32_t DEFAULT_FRAME_OVERLAP = 2;
+		constexpr static uint32_t MAX_FRAME_OVERLAP = 4;
+		uint32_t frame_overlap{ DEFAULT_FRAME_OVERLAP };
+
 		VkExtent2D windowExtent{ 1700, 900 };
 
+		//Worker pool shared by loading, culling and upload preparation
+		JobSystem jobs;
+
+		//Keeps the GPU culled scene draws recorded until draw_version moves, off records them every frame
+		bool cache_scene_draws{ true };
+		//Bumped by anything that changes what the scene draws record: batches, material sets, meshes
+		uint64_t draw_version{ 0 };
+		//Times the scene draws were recorded
+		uint32_t scene_records{ 0 };
+
 		struct SDL_Window* sdl_window{};
 
 		void init();
 		void deinit();
 
+		//Filled by init(), printed once it finished
+		std::vector<StartupPhase> startup_phases;
+		std::chrono::steady_clock::time_point init_start;
+
 		void draw();
 		void run();
+		//Draws until the fog has no dirty regions left, then FogOfWar::validate()
+		bool validate_fog();
+		//Moves and then destroys the token, SceneStore::validate() after each frame
+		bool validate_scene();
 
 	public:
 		//Scene
 		StrategyCamera cam;
 
+		SceneStore scene;
+		//Moved with the arrow keys, its status marker follows
+		Entity token{};
+		Entity token_marker{};
+		//Map geometry that rarely changes, baked into chunks
+		StaticLayer static_layer;
+		GridRenderer grid;
+		FogOfWar fog;
+		ClusteredLights lights;
+		ShadowAtlas shadows;
+		HiZCuller hiz;
+		IndirectRenderer indirect;
+		ImpostorAtlas impostors;
+		//Labels, bars and rulers in screen space, submitted every frame
+		OverlayRenderer overlay;
+		//GPU copies of assets loading in the background
+		UploadQueue uploads;
+		//Vertices of all meshes, bound once per pass
+		GeometryArena geometry;
+		//Budget for streamed textures, set before init()
+		TextureResidency residency;
+
+		//Visible part of the scene, rebuilt every frame. Empty while indirect draws the scene
 		std::vector<RenderableObject> objects;
 
-		std::unordered_map<std::string, Material> materials;
-		std::unordered_map<std::string, Mesh> meshes;
-		std::unordered_map<std::string, Texture> textures;
+		SlotMap<Pipeline> pipelines;
+		SlotMap<Material> materials;
+		SlotMap<Mesh> meshes;
+		SlotMap<Texture> textures;
+
+		NameTable<Pipeline> pipeline_names;
+		NameTable<Material> material_names;
+		NameTable<Mesh> mesh_names;
+		NameTable<Texture> texture_names;
+
+		PipelineHandle create_pipeline( VkPipeline pipeline, VkPipelineLayout layout, const std::string& name );
+		MaterialHandle create_material( PipelineHandle pipeline, const std::string& name );
+		//Material on the scene pipeline specialized for features
+		MaterialHandle create_material( uint32_t features, const std::string& name );
+		//Built the first time a permutation is asked for, equal masks share one pipeline
+		PipelineHandle scene_pipeline( uint32_t features );
+		MeshHandle add_mesh( Mesh&& mesh, const std::string& name );
+		TextureHandle add_texture( const Texture& tex, const std::string& name );
+
+		//Returns at once, the file is read and decoded as jobs and copied by the first pass of a later frame
+		TextureLoad load_texture( const std::string& path, const std::string& name );
+		//Shown by textures that are still loading
+		TextureHandle placeholder_texture;
+
+		//Falls back to the placeholder, the image is retired
+		void evict_texture( TextureHandle tex );
+		//Streams an evicted texture in again
+		void reload_texture( TextureHandle tex );
+		//Called wherever a texture is bound, residency keeps recently used ones
+		inline void touch_texture( TextureHandle h ){
+			if( Texture* tex = textures.get( h ))
+				tex->last_used = frameNumber;
+		}
+
+		//Writes a new tex_set, the old one is retired
+		void set_material_texture( MaterialHandle mat, TextureHandle tex, VkSampler sampler );
 
-		Material* create_material( VkPipeline pipeline, VkPipelineLayout layout, const std::string& name );
-		Material* get_material( const std::string& name );
+		//Name lookups are meant for load time, keep the handle afterwards
+		PipelineHandle find_pipeline( const std::string& name );
+		MaterialHandle find_material( const std::string& name );
+		MeshHandle find_mesh( const std::string& name );
+		TextureHandle find_texture( const std::string& name );
 
-		Mesh* get_mesh( const std::string& name );
+		//Safe mid frame, the GPU resources live until no frame in flight can use them
+		void unload_mesh( MeshHandle mesh );
+		void unload_texture( TextureHandle tex );
 
 		void draw_objects( VkCommandBuffer cmd, RenderableObject* first, int count );
 
@@ -109,7 +284,8 @@ struct VkEngine {
 		VkDevice vk_device;
 		VkSurfaceKHR vk_surface;
 
-		DelQueue deletion_queue;
+		//Destroyed at deinit
+		DeletionQueue deletion_queue;
 		VmaAllocator vma_alloc;
 
 		UploadContext upload_context;
@@ -120,26 +296,42 @@ struct VkEngine {
 		std::vector<VkImage> vk_swapchain_imgs;
 		std::vector<VkImageView> vk_swapchain_img_views;
 
-		VkImageView depth_view;
-		AllocatedImage depth_img;
-
 		VkFormat depth_format;
 
 		//Rendering
 		VkQueue vk_graphics_queue;
 		uint32_t vk_graphics_queue_family;
 
-		constexpr static unsigned FRAME_OVERLAP = 2;
-		FrameData frames[FRAME_OVERLAP];
+		FrameRing<FrameData> frames;
+
+		//Fence of the frame currently rendering to each swapchain image
+		std::vector<VkFence> swapchain_img_fences;
+
+		//Per frame transient upload memory
+		constexpr static VkDeviceSize STAGING_SLICE_SIZE = 4 * 1024 * 1024;
+		StagingRing frame_staging;
 
 		FrameData& get_curr_frame();
 
+		//Frame whose deletion queue receives retired handles, advanced in draw() after the fence wait
+		uint64_t retire_frame{ 0 };
+
+		template<typename T>
+		inline void retire( T handle ){
+			frames.get( retire_frame ).deletions.push( handle );
+		}
+
+		//Frame structure, barriers and attachments are derived from the passes
+		RenderGraph graph;
+		uint32_t rg_swapchain, rg_depth, rg_fog, rg_clusters, rg_shadow_cache, rg_shadow_atlas, rg_hiz, rg_hiz_draws, rg_gpu_draws, rg_gpu_visible, rg_impostor_atlas, rg_impostor_depth, rg_impostor_list, rg_impostor_draw;
+
 		VkRenderPass vk_render_pass;
-		std::vector<VkFramebuffer> vk_framebuffers;
 
 		VkDescriptorSetLayout global_desc_layout;
 		VkDescriptorSetLayout single_tex_layout;
-		VkDescriptorPool desc_pool;
+		//Sets that outlive a frame, retired as PooledDescriptorSet
+		DescriptorAllocator descriptors;
+		DescriptorLayoutCache layouts;
 
 
 	private:
@@ -148,13 +340,19 @@ struct VkEngine {
 		void init_vk_swapchain();
 		void init_vk_cmd();
 
-		void init_vk_default_renderpass();
-		void init_vk_framebuffers();
+		void init_render_graph();
 
 		void init_vk_sync();
+		void init_frame_staging();
 
 		void init_vk_pipelines();
 
+		//Kept for the permutations built after init
+		VkShaderModule scene_vert{ VK_NULL_HANDLE };
+		VkShaderModule scene_frag{ VK_NULL_HANDLE };
+		VkPipelineLayout scene_layout{ VK_NULL_HANDLE };
+		std::unordered_map<uint32_t, PipelineHandle> scene_permutations;
+
 		void load_meshes();
 		void load_images();
 
@@ -162,6 +360,10 @@ struct VkEngine {
 
 		void init_descriptors();
 
+		Task<bool> stream_texture( TextureHandle handle, std::string path );
+		//Rewrites the sets of materials whose texture was swapped since
+		void refresh_materials();
+
 	public:
 		//Vulkan helpers
 		bool vk_load_shader( const char* path, VkShaderModule* shader );
@@ -185,4 +387,9 @@ struct PipelineBuilder {
 	VkPipelineMultisampleStateCreateInfo multisample_state;
 	VkPipelineDepthStencilStateCreateInfo depth_stencil_state;
 	VkPipelineLayout pipeline_layout;
+
+	//0 for depth only passes
+	uint32_t color_attachment_count{ 1 };
+	//E.g. viewport and scissor for pipelines drawing into atlas tiles
+	std::vector<VkDynamicState> dynamic_states;
 };
@@ -0,0 +1,613 @@
+#include "Core/VkFog.hpp"
+
+#include "Core/VkEngine.hpp"
+#include "Core/VkInit.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+static float cross2( glm::vec2 a, glm::vec2 b ){
+	return a.x * b.y - a.y * b.x;
+}
+
+//Keep in sync with blocked() in fog.comp
+static bool blocked( glm::vec2 from, glm::vec2 to, const FogWall& w ){
+	glm::vec2 r = to - from;
+	glm::vec2 s = w.b - w.a;
+	float denom = cross2( r, s );
+
+	if( std::abs( denom ) < 1e-8f )
+		return false;
+
+	glm::vec2 d = w.a - from;
+	float t = cross2( d, s ) / denom;
+	float u = cross2( d, r ) / denom;
+
+	return t > 0.0f && t < 1.0f && u >= 0.0f && u <= 1.0f;
+}
+
+Handle<FogWall> FogOfWar::add_wall( glm::vec2 a, glm::vec2 b ){
+	FogWall wall{ a, b };
+	mark_wall( wall );
+	return walls.insert( wall );
+}
+
+void FogOfWar::remove_wall( Handle<FogWall> h ){
+	FogWall* wall = walls.get( h );
+	if( !wall )
+		return;
+
+	mark_wall( *wall );
+	walls.remove( h );
+}
+
+Handle<VisionSource> FogOfWar::add_source( glm::vec2 pos, float radius ){
+	mark_circle( pos, radius );
+	return sources.insert( VisionSource{ pos, radius });
+}
+
+void FogOfWar::move_source( Handle<VisionSource> h, glm::vec2 pos, float radius ){
+	VisionSource* src = sources.get( h );
+	if( !src )
+		return;
+
+	mark_circle( src->pos, src->radius );
+	mark_circle( pos, radius );
+
+	src->pos = pos;
+	src->radius = radius;
+}
+
+void FogOfWar::remove_source( Handle<VisionSource> h ){
+	VisionSource* src = sources.get( h );
+	if( !src )
+		return;
+
+	mark_circle( src->pos, src->radius );
+	sources.remove( h );
+}
+
+void FogOfWar::mark_circle( glm::vec2 pos, float radius ){
+	glm::vec2 lo = ( pos - radius - origin ) / texel_size;
+	glm::vec2 hi = ( pos + radius - origin ) / texel_size;
+
+	FogRect rect{
+		.min = glm::ivec2{
+			std::clamp( static_cast<int>( std::floor( lo.x )), 0, static_cast<int>( resolution )),
+			std::clamp( static_cast<int>( std::floor( lo.y )), 0, static_cast<int>( resolution )),
+		},
+		.max = glm::ivec2{
+			std::clamp( static_cast<int>( std::ceil( hi.x )) + 1, 0, static_cast<int>( resolution )),
+			std::clamp( static_cast<int>( std::ceil( hi.y )) + 1, 0, static_cast<int>( resolution )),
+		},
+	};
+
+	if( rect.min.x < rect.max.x && rect.min.y < rect.max.y )
+		dirty.push_back( rect );
+}
+
+//A wall can only change what sources within reach of it see
+void FogOfWar::mark_wall( const FogWall& wall ){
+	for( auto& src: sources ){
+		glm::vec2 ab = wall.b - wall.a;
+		float len2 = glm::dot( ab, ab );
+		float t = len2 > 0.0f ? std::clamp( glm::dot( src.pos - wall.a, ab ) / len2, 0.0f, 1.0f ) : 0.0f;
+		glm::vec2 closest = wall.a + t * ab;
+
+		if( glm::length( src.pos - closest ) <= src.radius )
+			mark_circle( src.pos, src.radius );
+	}
+}
+
+void FogOfWar::merge_dirty(){
+	auto overlaps = []( const FogRect& a, const FogRect& b ){
+		return a.min.x < b.max.x && b.min.x < a.max.x && a.min.y < b.max.y && b.min.y < a.max.y;
+	};
+
+	//Overlapping rects are merged so no texel is written by two dispatches
+	bool merged = true;
+	while( merged ){
+		merged = false;
+
+		for( size_t i = 0; i < dirty.size() && !merged; ++i ){
+			for( size_t j = i + 1; j < dirty.size(); ++j ){
+				if( !overlaps( dirty[i], dirty[j] ))
+					continue;
+
+				dirty[i].min = glm::min( dirty[i].min, dirty[j].min );
+				dirty[i].max = glm::max( dirty[i].max, dirty[j].max );
+				dirty.erase( dirty.begin() + j );
+				merged = true;
+				break;
+			}
+		}
+	}
+
+	if( dirty.size() > MAX_DIRTY_RECTS ){
+		FogRect all = dirty[0];
+		for( auto& r: dirty ){
+			all.min = glm::min( all.min, r.min );
+			all.max = glm::max( all.max, r.max );
+		}
+
+		dirty.assign( 1, all );
+	}
+}
+
+void FogOfWar::init( VkEngine& engine, VkRenderPass pass ){
+	VkDevice dev = engine.vk_device;
+
+	//Fog texture, cleared to unexplored
+	auto img_cr_inf = vkinit::image_create_info(
+			VK_FORMAT_R8G8B8A8_UNORM,
+			VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+			VkExtent3D{ resolution, resolution, 1 });
+
+	VmaAllocationCreateInfo img_alloc{
+		.usage = VMA_MEMORY_USAGE_GPU_ONLY,
+	};
+
+	VK_CHECK( vmaCreateImage( engine.vma_alloc, &img_cr_inf, &img_alloc, &image.image, &image.allocation, nullptr ));
+
+	auto view_cr_inf = vkinit::image_view_create_info( VK_FORMAT_R8G8B8A8_UNORM, image.image, VK_IMAGE_ASPECT_COLOR_BIT );
+	VK_CHECK( vkCreateImageView( dev, &view_cr_inf, nullptr, &view ));
+
+	engine.immediate_submit( [&]( VkCommandBuffer cmd ){
+			VkImageSubresourceRange range{
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.baseMipLevel = 0,
+				.levelCount = 1,
+				.baseArrayLayer = 0,
+				.layerCount = 1,
+			};
+
+			VkImageMemoryBarrier to_transfer{
+				.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+				.pNext = nullptr,
+				.srcAccessMask = 0,
+				.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+				.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+				.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.image = image.image,
+				.subresourceRange = range,
+			};
+
+			vkCmdPipelineBarrier(
+					cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+					0, nullptr,
+					0, nullptr,
+					1, &to_transfer );
+
+			VkClearColorValue black{};
+			vkCmdClearColorImage( cmd, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &black, 1, &range );
+
+			//The render graph expects the fog in this state at the start of every frame
+			VkImageMemoryBarrier to_shader{
+				.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+				.pNext = nullptr,
+				.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+				.dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+				.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.image = image.image,
+				.subresourceRange = range,
+			};
+
+			vkCmdPipelineBarrier(
+					cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+					0, nullptr,
+					0, nullptr,
+					1, &to_shader );
+		});
+
+	auto sampler_inf = vkinit::sampler_create_info( VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE );
+	VK_CHECK( vkCreateSampler( dev, &sampler_inf, nullptr, &sampler ));
+
+	//Descriptors
+	uint32_t frame_count = engine.frames.size();
+
+	VkDescriptorSetLayoutBinding bindings[3]{
+		{
+			.binding = 0,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		},
+		{
+			.binding = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		},
+		{
+			.binding = 2,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		},
+	};
+
+	compute_set_layout = engine.layouts.get( bindings, 3 );
+
+	//Wall and source lists are re-uploaded by the frame that dispatches, one copy per frame in flight
+	frames.resize( frame_count );
+	for( auto& fr: frames ){
+		VmaAllocationCreateInfo mapped_alloc{
+			.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT,
+			.usage = VMA_MEMORY_USAGE_CPU_TO_GPU,
+		};
+
+		VkBufferCreateInfo buf_cr_inf{
+			.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+			.pNext = nullptr,
+			.size = MAX_WALLS * sizeof( FogWall ),
+			.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		};
+
+		VmaAllocationInfo alloc_inf;
+		VK_CHECK( vmaCreateBuffer( engine.vma_alloc, &buf_cr_inf, &mapped_alloc, &fr.walls.buffer, &fr.walls.allocation, &alloc_inf ));
+		fr.walls_mapped = alloc_inf.pMappedData;
+
+		buf_cr_inf.size = MAX_SOURCES * sizeof( VisionSource );
+		VK_CHECK( vmaCreateBuffer( engine.vma_alloc, &buf_cr_inf, &mapped_alloc, &fr.sources.buffer, &fr.sources.allocation, &alloc_inf ));
+		fr.sources_mapped = alloc_inf.pMappedData;
+
+		fr.compute_set = engine.descriptors.allocate( compute_set_layout ).set;
+
+		VkDescriptorImageInfo img_inf{
+			.sampler = VK_NULL_HANDLE,
+			.imageView = view,
+			.imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+		};
+
+		VkDescriptorBufferInfo walls_inf{
+			.buffer = fr.walls.buffer,
+			.offset = 0,
+			.range = VK_WHOLE_SIZE,
+		};
+
+		VkDescriptorBufferInfo sources_inf{
+			.buffer = fr.sources.buffer,
+			.offset = 0,
+			.range = VK_WHOLE_SIZE,
+		};
+
+		VkWriteDescriptorSet writes[3]{
+			vkinit::write_descriptor_set_image( VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, fr.compute_set, &img_inf, 0 ),
+			{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.pNext = nullptr,
+				.dstSet = fr.compute_set,
+				.dstBinding = 1,
+				.descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.pBufferInfo = &walls_inf,
+			},
+			{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.pNext = nullptr,
+				.dstSet = fr.compute_set,
+				.dstBinding = 2,
+				.descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.pBufferInfo = &sources_inf,
+			},
+		};
+
+		vkUpdateDescriptorSets( dev, 3, writes, 0, nullptr );
+
+		engine.deletion_queue.push( fr.walls );
+		engine.deletion_queue.push( fr.sources );
+	}
+
+	overlay_set = engine.descriptors.allocate( engine.single_tex_layout ).set;
+
+	VkDescriptorImageInfo overlay_img_inf{
+		.sampler = sampler,
+		.imageView = view,
+		.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+	};
+
+	auto overlay_write = vkinit::write_descriptor_set_image( VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, overlay_set, &overlay_img_inf, 0 );
+	vkUpdateDescriptorSets( dev, 1, &overlay_write, 0, nullptr );
+
+	//Compute pipeline
+	VkShaderModule fog_comp{};
+	if( !engine.vk_load_shader( FILE_PREFIX "shader/fog.comp.spv", &fog_comp )){
+		std::cout << "Failed to load fog compute shader" << std::endl;
+	}
+
+	VkPushConstantRange compute_push{
+		.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		.offset = 0,
+		.size = sizeof( FogParams ),
+	};
+
+	auto compute_lay_cr_inf = vkinit::pipeline_layout();
+	compute_lay_cr_inf.setLayoutCount = 1;
+	compute_lay_cr_inf.pSetLayouts = &compute_set_layout;
+	compute_lay_cr_inf.pushConstantRangeCount = 1;
+	compute_lay_cr_inf.pPushConstantRanges = &compute_push;
+
+	VK_CHECK( vkCreatePipelineLayout( dev, &compute_lay_cr_inf, nullptr, &compute_layout ));
+
+	VkComputePipelineCreateInfo compute_cr_inf{
+		.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+		.pNext = nullptr,
+		.stage = vkinit::shader_stage_create_info( VK_SHADER_STAGE_COMPUTE_BIT, fog_comp ),
+		.layout = compute_layout,
+	};
+
+	if( vkCreateComputePipelines( dev, VK_NULL_HANDLE, 1, &compute_cr_inf, nullptr, &compute_pipeline ) != VK_SUCCESS ){
+		std::cout << "Could not create fog compute pipeline" << std::endl;
+		compute_pipeline = VK_NULL_HANDLE;
+	}
+
+	vkDestroyShaderModule( dev, fog_comp, nullptr );
+
+	//Overlay pipeline
+	VkShaderModule fog_vert{}, fog_frag{};
+
+	if( !engine.vk_load_shader( FILE_PREFIX "shader/fog.vert.spv", &fog_vert )){
+		std::cout << "Failed to load fog vert shader" << std::endl;
+	}
+
+	if( !engine.vk_load_shader( FILE_PREFIX "shader/fog.frag.spv", &fog_frag )){
+		std::cout << "Failed to load fog frag shader" << std::endl;
+	}
+
+	VkPushConstantRange overlay_push{
+		.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+		.offset = 0,
+		.size = sizeof( FogOverlayParams ),
+	};
+
+	VkDescriptorSetLayout overlay_set_layouts[2] = { engine.global_desc_layout, engine.single_tex_layout };
+
+	auto overlay_lay_cr_inf = vkinit::pipeline_layout();
+	overlay_lay_cr_inf.setLayoutCount = 2;
+	overlay_lay_cr_inf.pSetLayouts = overlay_set_layouts;
+	overlay_lay_cr_inf.pushConstantRangeCount = 1;
+	overlay_lay_cr_inf.pPushConstantRanges = &overlay_push;
+
+	VK_CHECK( vkCreatePipelineLayout( dev, &overlay_lay_cr_inf, nullptr, &overlay_layout ));
+
+	PipelineBuilder pipe_builder;
+
+	pipe_builder.vertex_in_info = vkinit::vertex_input_state_create_info();
+
+	pipe_builder.shader_stages.push_back(
+			vkinit::shader_stage_create_info( VK_SHADER_STAGE_VERTEX_BIT, fog_vert ));
+
+	pipe_builder.shader_stages.push_back(
+			vkinit::shader_stage_create_info( VK_SHADER_STAGE_FRAGMENT_BIT, fog_frag ));
+
+	pipe_builder.input_assembly = vkinit::input_assembly_state_create_info( VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST );
+
+	pipe_builder.viewport.x = 0;
+	pipe_builder.viewport.y = 0;
+	pipe_builder.viewport.width = engine.windowExtent.width;
+	pipe_builder.viewport.height = engine.windowExtent.height;
+	pipe_builder.viewport.minDepth = 0;
+	pipe_builder.viewport.maxDepth = 1;
+
+	pipe_builder.scissor.offset = { 0, 0 };
+	pipe_builder.scissor.extent = engine.windowExtent;
+
+	pipe_builder.rasterizer = vkinit::rasterization_state_create_info( VK_POLYGON_MODE_FILL );
+	pipe_builder.multisample_state = vkinit::multisample_state_create_info();
+
+	pipe_builder.color_blend = vkinit::color_blend_attachment_state();
+	pipe_builder.color_blend.blendEnable = VK_TRUE;
+	pipe_builder.color_blend.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	pipe_builder.color_blend.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	pipe_builder.color_blend.colorBlendOp = VK_BLEND_OP_ADD;
+	pipe_builder.color_blend.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	pipe_builder.color_blend.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	pipe_builder.color_blend.alphaBlendOp = VK_BLEND_OP_ADD;
+
+	//Covers tokens standing in the fog as well
+	pipe_builder.depth_stencil_state = vkinit::depth_stencil_state_create_info( VK_FALSE, VK_FALSE, VK_COMPARE_OP_ALWAYS );
+	pipe_builder.pipeline_layout = overlay_layout;
+
+	overlay_pipeline = pipe_builder.build_pipeline( dev, pass );
+
+	vkDestroyShaderModule( dev, fog_vert, nullptr );
+	vkDestroyShaderModule( dev, fog_frag, nullptr );
+
+	engine.deletion_queue.push( compute_pipeline );
+	engine.deletion_queue.push( overlay_pipeline );
+	engine.deletion_queue.push( compute_layout );
+	engine.deletion_queue.push( overlay_layout );
+	engine.deletion_queue.push( sampler );
+	engine.deletion_queue.push( view );
+	engine.deletion_queue.push( image );
+}
+
+void FogOfWar::record_update( VkEngine& engine, VkCommandBuffer cmd ){
+	if( dirty.empty() || !compute_pipeline )
+		return;
+
+	merge_dirty();
+
+	FrameResources& fr = frames.get( engine.frameNumber );
+
+	uint32_t wall_count = std::min<size_t>( walls.size(), MAX_WALLS );
+	uint32_t source_count = std::min<size_t>( sources.size(), MAX_SOURCES );
+
+	memcpy( fr.walls_mapped, walls.data.data(), wall_count * sizeof( FogWall ));
+	memcpy( fr.sources_mapped, sources.data.data(), source_count * sizeof( VisionSource ));
+
+	vkCmdBindPipeline( cmd, VK_PIPELINE_BIND_POINT_COMPUTE, compute_pipeline );
+	vkCmdBindDescriptorSets( cmd, VK_PIPELINE_BIND_POINT_COMPUTE, compute_layout, 0, 1, &fr.compute_set, 0, nullptr );
+
+	for( auto& rect: dirty ){
+		FogParams params{
+			.region_min = rect.min,
+			.region_size = rect.max - rect.min,
+			.origin = origin,
+			.texel_size = texel_size,
+			.wall_count = wall_count,
+			.source_count = source_count,
+		};
+
+		vkCmdPushConstants( cmd, compute_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( FogParams ), &params );
+		vkCmdDispatch( cmd, ( params.region_size.x + 7 ) / 8, ( params.region_size.y + 7 ) / 8, 1 );
+	}
+
+	dirty.clear();
+}
+
+void FogOfWar::draw_overlay( VkEngine& engine, VkCommandBuffer cmd ){
+	if( !overlay_pipeline )
+		return;
+
+	FogOverlayParams params{
+		.origin = origin,
+		.size = resolution * texel_size,
+		.height = 0.02f,
+	};
+
+	vkCmdBindPipeline( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, overlay_pipeline );
+	vkCmdBindDescriptorSets( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, overlay_layout, 0, 1, &engine.get_curr_frame().global_desc, 0, nullptr );
+	vkCmdBindDescriptorSets( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, overlay_layout, 1, 1, &overlay_set, 0, nullptr );
+	vkCmdPushConstants( cmd, overlay_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof( FogOverlayParams ), &params );
+
+	vkCmdDraw( cmd, 6, 1, 0, 0 );
+}
+
+bool FogOfWar::is_visible( glm::vec2 pos ) const {
+	for( auto& src: sources.data ){
+		glm::vec2 d = pos - src.pos;
+
+		if( glm::dot( d, d ) > src.radius * src.radius )
+			continue;
+
+		bool hidden = false;
+		for( size_t w = 0; w < walls.data.size() && !hidden; ++w )
+			hidden = blocked( src.pos, pos, walls.data[w] );
+
+		if( !hidden )
+			return true;
+	}
+
+	return false;
+}
+
+uint8_t FogOfWar::reference_visibility( uint32_t x, uint32_t y ) const {
+	glm::vec2 pos = origin + ( glm::vec2{ static_cast<float>( x ), static_cast<float>( y )} + 0.5f ) * texel_size;
+	return is_visible( pos ) ? 255 : 0;
+}
+
+bool FogOfWar::validate( VkEngine& engine ){
+	if( !dirty.empty() ){
+		std::cout << "Fog validation skipped, " << dirty.size() << " regions not computed yet" << std::endl;
+		return false;
+	}
+
+	vkDeviceWaitIdle( engine.vk_device );
+
+	VkDeviceSize size = resolution * resolution * 4;
+	AllocatedBuffer readback = engine.create_buffer( size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU );
+
+	engine.immediate_submit( [&]( VkCommandBuffer cmd ){
+			VkImageSubresourceRange range{
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.baseMipLevel = 0,
+				.levelCount = 1,
+				.baseArrayLayer = 0,
+				.layerCount = 1,
+			};
+
+			VkImageMemoryBarrier to_transfer{
+				.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+				.pNext = nullptr,
+				.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+				.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+				.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.image = image.image,
+				.subresourceRange = range,
+			};
+
+			vkCmdPipelineBarrier(
+					cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+					0, nullptr,
+					0, nullptr,
+					1, &to_transfer );
+
+			VkBufferImageCopy copy{
+				.bufferOffset = 0,
+				.bufferRowLength = 0,
+				.bufferImageHeight = 0,
+				.imageSubresource = VkImageSubresourceLayers{
+					.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+					.mipLevel = 0,
+					.baseArrayLayer = 0,
+					.layerCount = 1,
+				},
+				.imageExtent = VkExtent3D{ resolution, resolution, 1 },
+			};
+
+			vkCmdCopyImageToBuffer( cmd, image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback.buffer, 1, &copy );
+
+			VkImageMemoryBarrier to_shader{
+				.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+				.pNext = nullptr,
+				.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+				.dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+				.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.image = image.image,
+				.subresourceRange = range,
+			};
+
+			vkCmdPipelineBarrier(
+					cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+					0, nullptr,
+					0, nullptr,
+					1, &to_shader );
+		});
+
+	void* data;
+	VK_CHECK( vmaMapMemory( engine.vma_alloc, readback.allocation, &data ));
+	const uint8_t* texels = static_cast<const uint8_t*>( data );
+
+	//Texels whose centre lies exactly on a wall or circle edge may round differently on the GPU
+	uint32_t mismatches = 0, explored_errors = 0;
+
+	for( uint32_t y = 0; y < resolution; ++y ){
+		for( uint32_t x = 0; x < resolution; ++x ){
+			const uint8_t* t = texels + 4 * ( y * resolution + x );
+
+			if(( t[0] > 127 ) != ( reference_visibility( x, y ) > 127 ))
+				++mismatches;
+			if( t[1] < t[0] )
+				++explored_errors;
+		}
+	}
+
+	vmaUnmapMemory( engine.vma_alloc, readback.allocation );
+	vmaDestroyBuffer( engine.vma_alloc, readback.buffer, readback.allocation );
+
+	uint32_t tolerance = std::max( 1u, resolution * resolution / 1000 );
+	bool ok = mismatches <= tolerance && explored_errors == 0;
+
+	std::cout << "Fog validation " << ( ok ? "passed" : "FAILED" )
+		<< ": " << mismatches << " visibility mismatches (tolerance " << tolerance << "), "
+		<< explored_errors << " explored < visible" << std::endl;
+
+	return ok;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "VkTypes.hpp"
+#include "VkFrameRing.hpp"
+#include "VkSlotMap.hpp"
+
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <vector>
+
+struct VkEngine;
+
+//Layouts match the storage buffers in fog.comp
+struct FogWall {
+	glm::vec2 a;
+	glm::vec2 b;
+};
+
+struct VisionSource {
+	glm::vec2 pos;
+	float radius;
+	float pad{ 0.0f };
+};
+
+struct FogRect {
+	glm::ivec2 min;
+	glm::ivec2 max;		//Exclusive
+};
+
+struct FogParams {
+	glm::ivec2 region_min;
+	glm::ivec2 region_size;
+	glm::vec2 origin;
+	float texel_size;
+	uint32_t wall_count;
+	uint32_t source_count;
+};
+
+struct FogOverlayParams {
+	glm::vec2 origin;
+	float size;
+	float height;
+};
+
+/*
+ * Fog texture (r: visible, g: explored) covering a square of the board.
+ * Edits only queue the texel rectangles whose visibility can change, the
+ * compute pass then re-evaluates just those. reference_visibility() is the
+ * same test on the CPU, validate() compares both on any Vulkan device
+ * (including software ones). Run with --validate-fog to check it and exit.
+ */
+struct FogOfWar {
+	constexpr static uint32_t MAX_WALLS = 4096;
+	constexpr static uint32_t MAX_SOURCES = 256;
+	constexpr static uint32_t MAX_DIRTY_RECTS = 8;
+
+	uint32_t resolution{ 512 };
+	float texel_size{ 0.25f };
+	glm::vec2 origin{ -64.0f, -64.0f };
+
+	SlotMap<FogWall> walls;
+	SlotMap<VisionSource> sources;
+
+	Handle<FogWall> add_wall( glm::vec2 a, glm::vec2 b );
+	void remove_wall( Handle<FogWall> wall );
+
+	Handle<VisionSource> add_source( glm::vec2 pos, float radius );
+	void move_source( Handle<VisionSource> source, glm::vec2 pos, float radius );
+	void remove_source( Handle<VisionSource> source );
+
+	//Texels that may change, merged to at most MAX_DIRTY_RECTS before dispatch
+	std::vector<FogRect> dirty;
+
+	AllocatedImage image{};
+	VkImageView view{ VK_NULL_HANDLE };
+
+	void init( VkEngine& engine, VkRenderPass pass );
+	//Compute pass in the render graph, no-op without dirty rects
+	void record_update( VkEngine& engine, VkCommandBuffer cmd );
+	//Inside the main render pass
+	void draw_overlay( VkEngine& engine, VkCommandBuffer cmd );
+
+	uint8_t reference_visibility( uint32_t x, uint32_t y ) const;
+	bool is_visible( glm::vec2 pos ) const;
+
+	//Waits for the device, reads the fog texture back and compares the visible channel with the CPU reference
+	bool validate( VkEngine& engine );
+
+	private:
+		struct FrameResources {
+			AllocatedBuffer walls;
+			AllocatedBuffer sources;
+			void* walls_mapped;
+			void* sources_mapped;
+			VkDescriptorSet compute_set;
+		};
+
+		FrameRing<FrameResources> frames;
+
+		VkDescriptorSetLayout compute_set_layout{ VK_NULL_HANDLE };
+		VkDescriptorSet overlay_set{ VK_NULL_HANDLE };
+		VkSampler sampler{ VK_NULL_HANDLE };
+
+		VkPipelineLayout compute_layout{ VK_NULL_HANDLE };
+		VkPipeline compute_pipeline{ VK_NULL_HANDLE };
+		VkPipelineLayout overlay_layout{ VK_NULL_HANDLE };
+		VkPipeline overlay_pipeline{ VK_NULL_HANDLE };
+
+		void mark_circle( glm::vec2 pos, float radius );
+		void mark_wall( const FogWall& wall );
+		void merge_dirty();
+};
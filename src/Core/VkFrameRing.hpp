@@ -0,0 +1,73 @@
+#pragma once
+
+#include "VkTypes.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Fixed ring of per-frame resources, indexed by frame number. A slot is only
+// reused once the frame that last used it has been waited on.
+template<typename T>
+struct FrameRing {
+	std::vector<T> slots;
+
+	inline void resize( size_t count ){
+		slots.resize( count );
+	}
+
+	inline size_t size() const {
+		return slots.size();
+	}
+
+	inline T& get( uint64_t frame ){
+		return slots[frame % slots.size()];
+	}
+
+	inline T& operator[]( size_t i ){
+		return slots[i];
+	}
+
+	inline typename std::vector<T>::iterator begin(){ return slots.begin(); }
+	inline typename std::vector<T>::iterator end(){ return slots.end(); }
+};
+
+// One persistently mapped host visible buffer, split into one slice per frame
+// in flight. Each frame bump allocates transient data from its own slice.
+struct StagingRing {
+	AllocatedBuffer buffer{};
+	uint8_t* mapped{ nullptr };
+
+	VkDeviceSize slice_size{ 0 };
+	VkDeviceSize slice_begin{ 0 };
+	VkDeviceSize head{ 0 };
+
+	inline void begin_frame( size_t slot ){
+		slice_begin = slot * slice_size;
+		head = 0;
+	}
+
+	//Returns nullptr if the slice is exhausted, offset is relative to buffer
+	inline void* alloc( VkDeviceSize size, VkDeviceSize align, VkDeviceSize& offset ){
+		VkDeviceSize aligned = ( head + align - 1 ) & ~( align - 1 );
+
+		if( aligned + size > slice_size )
+			return nullptr;
+
+		head = aligned + size;
+		offset = slice_begin + aligned;
+
+		return mapped + offset;
+	}
+
+	inline VkDeviceSize push( const void* data, VkDeviceSize size, VkDeviceSize align = 16 ){
+		VkDeviceSize offset;
+		void* dst = alloc( size, align, offset );
+
+		if( !dst )
+			return VK_WHOLE_SIZE;
+
+		memcpy( dst, data, size );
+		return offset;
+	}
+};
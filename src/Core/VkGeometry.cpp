@@ -0,0 +1,201 @@
+#include "Core/VkGeometry.hpp"
+
+#include "Core/VkEngine.hpp"
+#include "Core/VkMesh.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+void RangeAllocator::init( uint32_t cap ){
+	capacity = cap;
+	used = 0;
+	free_ranges.assign( 1, Range{ .first = 0, .count = cap });
+}
+
+uint32_t RangeAllocator::alloc( uint32_t count ){
+	if( count == 0 )
+		return INVALID;
+
+	for( size_t i = 0; i < free_ranges.size(); ++i ){
+		Range& r = free_ranges[i];
+
+		if( r.count < count )
+			continue;
+
+		uint32_t first = r.first;
+		r.first += count;
+		r.count -= count;
+
+		if( r.count == 0 )
+			free_ranges.erase( free_ranges.begin() + i );
+
+		used += count;
+		return first;
+	}
+
+	return INVALID;
+}
+
+void RangeAllocator::free( uint32_t first, uint32_t count ){
+	if( count == 0 )
+		return;
+
+	auto next = std::lower_bound( free_ranges.begin(), free_ranges.end(), first, []( const Range& r, uint32_t f ){
+			return r.first < f;
+		});
+
+	used -= count;
+
+	//Merge with the range before and after, if they touch
+	bool joins_prev = next != free_ranges.begin() && ( next - 1 )->first + ( next - 1 )->count == first;
+	bool joins_next = next != free_ranges.end() && first + count == next->first;
+
+	if( joins_prev && joins_next ){
+		( next - 1 )->count += count + next->count;
+		free_ranges.erase( next );
+	} else if( joins_prev ){
+		( next - 1 )->count += count;
+	} else if( joins_next ){
+		next->first = first;
+		next->count += count;
+	} else {
+		free_ranges.insert( next, Range{ .first = first, .count = count });
+	}
+}
+
+void GeometryArena::init( VkEngine& engine ){
+	vertices = engine.create_buffer(
+			static_cast<size_t>( VERTEX_CAPACITY ) * sizeof( Vertex ),
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VMA_MEMORY_USAGE_GPU_ONLY );
+	engine.deletion_queue.push( vertices );
+
+	vertex_ranges.init( VERTEX_CAPACITY );
+}
+
+void GeometryArena::upload( VkEngine& engine, Mesh& mesh ){
+	uint32_t count = static_cast<uint32_t>( mesh.vertices.size() );
+	uint32_t first;
+
+	{
+		std::lock_guard<std::mutex> guard( lock );
+		first = vertex_ranges.alloc( count );
+	}
+
+	if( first == RangeAllocator::INVALID ){
+		std::cout << "Geometry arena is full, " << count << " vertices do not fit" << std::endl;
+		mesh.vertex_count = 0;
+		return;
+	}
+
+	mesh.base_vertex = first;
+	mesh.vertex_count = count;
+
+	VkDeviceSize size = static_cast<VkDeviceSize>( count ) * sizeof( Vertex );
+
+	AllocatedBuffer staging = engine.create_buffer( size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY );
+
+	void* data;
+	vmaMapMemory( engine.vma_alloc, staging.allocation, &data );
+	memcpy( data, mesh.vertices.data(), size );
+	vmaUnmapMemory( engine.vma_alloc, staging.allocation );
+
+	engine.immediate_submit( [&]( VkCommandBuffer cmd ){
+			VkBufferCopy region{
+				.srcOffset = 0,
+				.dstOffset = static_cast<VkDeviceSize>( first ) * sizeof( Vertex ),
+				.size = size,
+			};
+
+			vkCmdCopyBuffer( cmd, staging.buffer, vertices.buffer, 1, &region );
+		});
+
+	vmaDestroyBuffer( engine.vma_alloc, staging.buffer, staging.allocation );
+}
+
+uint32_t GeometryArena::upload( VkEngine& engine, AllocatedBuffer staging, uint32_t count ){
+	//Freed once this frame's fence signalled, after the copy recorded below
+	engine.retire( staging );
+
+	uint32_t first;
+
+	{
+		std::lock_guard<std::mutex> guard( lock );
+		first = vertex_ranges.alloc( count );
+	}
+
+	if( first == RangeAllocator::INVALID ){
+		std::cout << "Geometry arena is full, " << count << " vertices do not fit" << std::endl;
+		return RangeAllocator::INVALID;
+	}
+
+	copies.push_back( Copy{ .staging = staging.buffer, .first = first, .count = count });
+	return first;
+}
+
+void GeometryArena::release( VkEngine& engine, const Mesh& mesh ){
+	release( engine, mesh.base_vertex, mesh.vertex_count );
+}
+
+void GeometryArena::release( VkEngine& engine, uint32_t first, uint32_t count ){
+	if( count == 0 )
+		return;
+
+	//Same point in time as engine.retire(), the frame slot is waited on again after frames.size() frames
+	std::lock_guard<std::mutex> guard( lock );
+	retired.push_back( Retired{
+			.free_frame = engine.retire_frame + engine.frames.size(),
+			.first = first,
+			.count = count,
+		});
+}
+
+void GeometryArena::collect( uint64_t frame ){
+	std::lock_guard<std::mutex> guard( lock );
+
+	auto idle = std::partition( retired.begin(), retired.end(), [frame]( const Retired& r ){
+			return r.free_frame > frame;
+		});
+
+	for( auto it = idle; it != retired.end(); ++it )
+		vertex_ranges.free( it->first, it->count );
+
+	retired.erase( idle, retired.end() );
+}
+
+void GeometryArena::record_copies( VkCommandBuffer cmd ){
+	if( copies.empty() )
+		return;
+
+	for( auto& c: copies ){
+		VkBufferCopy region{
+			.srcOffset = 0,
+			.dstOffset = static_cast<VkDeviceSize>( c.first ) * sizeof( Vertex ),
+			.size = static_cast<VkDeviceSize>( c.count ) * sizeof( Vertex ),
+		};
+
+		vkCmdCopyBuffer( cmd, c.staging, vertices.buffer, 1, &region );
+	}
+
+	copies.clear();
+
+	//Fetched as vertex attributes by the depth passes and pulled from the storage buffer by the scene shaders
+	VkMemoryBarrier barrier{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.pNext = nullptr,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+	};
+
+	vkCmdPipelineBarrier(
+			cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0,
+			1, &barrier,
+			0, nullptr,
+			0, nullptr );
+}
+
+void GeometryArena::bind( VkCommandBuffer cmd ) const {
+	VkDeviceSize off = 0;
+	vkCmdBindVertexBuffers( cmd, 0, 1, &vertices.buffer, &off );
+}
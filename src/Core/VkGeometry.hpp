@@ -0,0 +1,89 @@
+#pragma once
+
+#include "VkTypes.hpp"
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+struct VkEngine;
+struct Mesh;
+
+/*
+ * First fit allocator for ranges of a fixed size pool, in elements. Free
+ * ranges are kept sorted by offset and merged with their neighbours on
+ * release, so a pool that is loaded and unloaded in any order does not
+ * fragment into slivers.
+ */
+struct RangeAllocator {
+	constexpr static uint32_t INVALID = UINT32_MAX;
+
+	void init( uint32_t capacity );
+
+	//INVALID if no free range is large enough
+	uint32_t alloc( uint32_t count );
+	void free( uint32_t first, uint32_t count );
+
+	uint32_t capacity{ 0 };
+	uint32_t used{ 0 };
+
+	private:
+		struct Range {
+			uint32_t first;
+			uint32_t count;
+		};
+
+		std::vector<Range> free_ranges;
+};
+
+/*
+ * Vertices of every mesh in one device local buffer. A mesh is a range of it,
+ * so the buffer is bound once per pass and draws only differ in their first
+ * vertex. Ranges of unloaded meshes are reused once the frames that may still
+ * read them finished.
+ */
+struct GeometryArena {
+	constexpr static uint32_t VERTEX_CAPACITY = 1024 * 1024;
+
+	AllocatedBuffer vertices{};
+	RangeAllocator vertex_ranges;
+
+	void init( VkEngine& engine );
+
+	//Copies mesh.vertices into a new range and sets mesh.base_vertex, load time
+	void upload( VkEngine& engine, Mesh& mesh );
+	//Render thread. New range for the count vertices in staging, copied by record_copies() this frame.
+	//INVALID if the arena is full, staging is retired either way
+	uint32_t upload( VkEngine& engine, AllocatedBuffer staging, uint32_t count );
+	//The range is freed frame_overlap frames from now
+	void release( VkEngine& engine, const Mesh& mesh );
+	void release( VkEngine& engine, uint32_t first, uint32_t count );
+	//Start of the frame, after this frame slot's fence was waited on
+	void collect( uint64_t frame );
+
+	//First pass of the frame, the ranges can be drawn from by the passes after it
+	void record_copies( VkCommandBuffer cmd );
+
+	void bind( VkCommandBuffer cmd ) const;
+
+	private:
+		//Meshes load on job threads
+		std::mutex lock;
+
+		struct Retired {
+			uint64_t free_frame;
+			uint32_t first;
+			uint32_t count;
+		};
+
+		std::vector<Retired> retired;
+
+		//Render thread only
+		struct Copy {
+			VkBuffer staging;
+			uint32_t first;
+			uint32_t count;
+		};
+
+		std::vector<Copy> copies;
+};
@@ -0,0 +1,95 @@
+#include "Core/VkGrid.hpp"
+
+#include "Core/VkEngine.hpp"
+#include "Core/VkInit.hpp"
+
+#include <glm/glm.hpp>
+
+#include <iostream>
+
+void GridRenderer::init( VkEngine& engine, VkRenderPass pass ){
+	VkShaderModule grid_vert{}, grid_frag{};
+
+	if( !engine.vk_load_shader( FILE_PREFIX "shader/grid.vert.spv", &grid_vert )){
+		std::cout << "Failed to load grid vert shader" << std::endl;
+	}
+
+	if( !engine.vk_load_shader( FILE_PREFIX "shader/grid.frag.spv", &grid_frag )){
+		std::cout << "Failed to load grid frag shader" << std::endl;
+	}
+
+	VkPushConstantRange push_constant{
+		.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+		.offset = 0,
+		.size = sizeof( GridParams ),
+	};
+
+	auto pipe_lay_cr_inf = vkinit::pipeline_layout();
+	pipe_lay_cr_inf.setLayoutCount = 1;
+	pipe_lay_cr_inf.pSetLayouts = &engine.global_desc_layout;
+	pipe_lay_cr_inf.pushConstantRangeCount = 1;
+	pipe_lay_cr_inf.pPushConstantRanges = &push_constant;
+
+	VK_CHECK( vkCreatePipelineLayout( engine.vk_device, &pipe_lay_cr_inf, nullptr, &layout ));
+
+	PipelineBuilder pipe_builder;
+
+	//Vertices come from gl_VertexIndex
+	pipe_builder.vertex_in_info = vkinit::vertex_input_state_create_info();
+
+	pipe_builder.shader_stages.push_back(
+			vkinit::shader_stage_create_info( VK_SHADER_STAGE_VERTEX_BIT, grid_vert ));
+
+	pipe_builder.shader_stages.push_back(
+			vkinit::shader_stage_create_info( VK_SHADER_STAGE_FRAGMENT_BIT, grid_frag ));
+
+	pipe_builder.input_assembly = vkinit::input_assembly_state_create_info( VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST );
+
+	pipe_builder.viewport.x = 0;
+	pipe_builder.viewport.y = 0;
+	pipe_builder.viewport.width = engine.windowExtent.width;
+	pipe_builder.viewport.height = engine.windowExtent.height;
+	pipe_builder.viewport.minDepth = 0;
+	pipe_builder.viewport.maxDepth = 1;
+
+	pipe_builder.scissor.offset = { 0, 0 };
+	pipe_builder.scissor.extent = engine.windowExtent;
+
+	pipe_builder.rasterizer = vkinit::rasterization_state_create_info( VK_POLYGON_MODE_FILL );
+	pipe_builder.multisample_state = vkinit::multisample_state_create_info();
+
+	pipe_builder.color_blend = vkinit::color_blend_attachment_state();
+	pipe_builder.color_blend.blendEnable = VK_TRUE;
+	pipe_builder.color_blend.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	pipe_builder.color_blend.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	pipe_builder.color_blend.colorBlendOp = VK_BLEND_OP_ADD;
+	pipe_builder.color_blend.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	pipe_builder.color_blend.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	pipe_builder.color_blend.alphaBlendOp = VK_BLEND_OP_ADD;
+
+	//Tested against the board, but never occludes anything
+	pipe_builder.depth_stencil_state = vkinit::depth_stencil_state_create_info( VK_TRUE, VK_FALSE, VK_COMPARE_OP_LESS_OR_EQUAL );
+	pipe_builder.pipeline_layout = layout;
+
+	pipeline = pipe_builder.build_pipeline( engine.vk_device, pass );
+
+	vkDestroyShaderModule( engine.vk_device, grid_vert, nullptr );
+	vkDestroyShaderModule( engine.vk_device, grid_frag, nullptr );
+
+	engine.deletion_queue.push( pipeline );
+	engine.deletion_queue.push( layout );
+}
+
+void GridRenderer::draw( VkEngine& engine, VkCommandBuffer cmd ){
+	if( !pipeline )
+		return;
+
+	glm::mat4 inv_view = glm::inverse( engine.cam.get_view() );
+	params.cam_pos = glm::vec4{ inv_view[3].x, inv_view[3].y, inv_view[3].z, params.cam_pos.w };
+
+	vkCmdBindPipeline( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline );
+	vkCmdBindDescriptorSets( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &engine.get_curr_frame().global_desc, 0, nullptr );
+	vkCmdPushConstants( cmd, layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof( GridParams ), &params );
+
+	vkCmdDraw( cmd, 6, 1, 0, 0 );
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "VkTypes.hpp"
+
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+
+struct VkEngine;
+
+enum class GridType : uint32_t {
+	Square = 0,
+	Hex = 1,
+};
+
+//Matches the push constant block in grid.vert/grid.frag
+struct GridParams {
+	glm::vec4 color{ 0.0f, 0.0f, 0.0f, 0.8f };
+	glm::vec4 cam_pos{ 0.0f, 0.0f, 0.0f, 150.0f };	//w: distance at which the grid has faded out
+	glm::vec2 cell_size{ 1.0f, 1.0f };
+	glm::vec2 offset{ -0.5f, -0.5f };
+	glm::vec2 half_extent{ 500.0f, 500.0f };
+	float line_width{ 1.5f };							//Pixels
+	GridType type{ GridType::Square };
+};
+
+/*
+ * Board grid as one quad, the lines are computed in the fragment shader.
+ * Cost depends on covered pixels only, not on the number of cells.
+ */
+struct GridRenderer {
+	GridParams params;
+
+	VkPipeline pipeline{ VK_NULL_HANDLE };
+	VkPipelineLayout layout{ VK_NULL_HANDLE };
+
+	void init( VkEngine& engine, VkRenderPass pass );
+
+	//Expects to be recorded inside the main render pass, after opaque geometry
+	void draw( VkEngine& engine, VkCommandBuffer cmd );
+};
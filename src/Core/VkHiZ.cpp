@@ -0,0 +1,358 @@
+#include "Core/VkHiZ.hpp"
+
+#include "Core/VkEngine.hpp"
+#include "Core/VkInit.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+static void create_compute( VkEngine& engine, const char* path, VkDescriptorSetLayout set_layout, uint32_t push_size, VkPipelineLayout& layout, VkPipeline& pipeline ){
+	VkShaderModule module{};
+	if( !engine.vk_load_shader( path, &module )){
+		std::cout << "Failed to load " << path << std::endl;
+	}
+
+	VkPushConstantRange push_constant{
+		.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		.offset = 0,
+		.size = push_size,
+	};
+
+	auto pipe_lay_cr_inf = vkinit::pipeline_layout();
+	pipe_lay_cr_inf.setLayoutCount = 1;
+	pipe_lay_cr_inf.pSetLayouts = &set_layout;
+	pipe_lay_cr_inf.pushConstantRangeCount = 1;
+	pipe_lay_cr_inf.pPushConstantRanges = &push_constant;
+
+	VK_CHECK( vkCreatePipelineLayout( engine.vk_device, &pipe_lay_cr_inf, nullptr, &layout ));
+
+	VkComputePipelineCreateInfo pipe_cr_inf{
+		.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+		.pNext = nullptr,
+		.stage = vkinit::shader_stage_create_info( VK_SHADER_STAGE_COMPUTE_BIT, module ),
+		.layout = layout,
+	};
+
+	if( vkCreateComputePipelines( engine.vk_device, VK_NULL_HANDLE, 1, &pipe_cr_inf, nullptr, &pipeline ) != VK_SUCCESS ){
+		std::cout << "Could not create pipeline for " << path << std::endl;
+		pipeline = VK_NULL_HANDLE;
+	}
+
+	vkDestroyShaderModule( engine.vk_device, module, nullptr );
+
+	engine.deletion_queue.push( pipeline );
+	engine.deletion_queue.push( layout );
+}
+
+void HiZCuller::init( VkEngine& engine, VkExtent2D depth_extent, VkImageView depth_view ){
+	VkDevice dev = engine.vk_device;
+
+	extent = VkExtent2D{ std::max( depth_extent.width / 2, 1u ), std::max( depth_extent.height / 2, 1u )};
+
+	mip_levels = 1;
+	for( uint32_t size = std::max( extent.width, extent.height ); size > 1; size /= 2 )
+		++mip_levels;
+
+	auto img_cr_inf = vkinit::image_create_info( FORMAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VkExtent3D{ extent.width, extent.height, 1 });
+	img_cr_inf.mipLevels = mip_levels;
+
+	VmaAllocationCreateInfo img_alloc{
+		.usage = VMA_MEMORY_USAGE_GPU_ONLY,
+	};
+
+	VK_CHECK( vmaCreateImage( engine.vma_alloc, &img_cr_inf, &img_alloc, &pyramid.image, &pyramid.allocation, nullptr ));
+
+	auto view_cr_inf = vkinit::image_view_create_info( FORMAT, pyramid.image, VK_IMAGE_ASPECT_COLOR_BIT );
+	view_cr_inf.subresourceRange.levelCount = mip_levels;
+	VK_CHECK( vkCreateImageView( dev, &view_cr_inf, nullptr, &view ));
+
+	mip_views.resize( mip_levels );
+	for( uint32_t m = 0; m < mip_levels; ++m ){
+		auto mip_cr_inf = vkinit::image_view_create_info( FORMAT, pyramid.image, VK_IMAGE_ASPECT_COLOR_BIT );
+		mip_cr_inf.subresourceRange.baseMipLevel = m;
+		VK_CHECK( vkCreateImageView( dev, &mip_cr_inf, nullptr, &mip_views[m] ));
+	}
+
+	//Contents are undefined until the first build, pyramid_valid keeps the cull from reading them
+	engine.immediate_submit( [&]( VkCommandBuffer cmd ){
+			VkImageMemoryBarrier to_general{
+				.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+				.pNext = nullptr,
+				.srcAccessMask = 0,
+				.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+				.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+				.newLayout = VK_IMAGE_LAYOUT_GENERAL,
+				.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.image = pyramid.image,
+				.subresourceRange = {
+					.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+					.baseMipLevel = 0,
+					.levelCount = mip_levels,
+					.baseArrayLayer = 0,
+					.layerCount = 1,
+				},
+			};
+
+			vkCmdPipelineBarrier(
+					cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+					0, nullptr,
+					0, nullptr,
+					1, &to_general );
+		});
+
+	auto sampler_inf = vkinit::sampler_create_info( VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE );
+	VK_CHECK( vkCreateSampler( dev, &sampler_inf, nullptr, &sampler ));
+
+	//Descriptors: one build set per mip, one cull set per frame
+	uint32_t frame_count = engine.frames.size();
+
+	VkDescriptorSetLayoutBinding build_bindings[2]{
+		{
+			.binding = 0,
+			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		},
+		{
+			.binding = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		},
+	};
+
+	VkDescriptorSetLayoutBinding cull_bindings[3]{
+		{
+			.binding = 0,
+			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		},
+		{
+			.binding = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		},
+		{
+			.binding = 2,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		},
+	};
+
+	build_set_layout = engine.layouts.get( build_bindings, 2 );
+	cull_set_layout = engine.layouts.get( cull_bindings, 3 );
+
+	//Mip 0 reduces depth, every other mip the one above it
+	build_sets.resize( mip_levels );
+	for( uint32_t m = 0; m < mip_levels; ++m ){
+		build_sets[m] = engine.descriptors.allocate( build_set_layout ).set;
+
+		VkDescriptorImageInfo src_inf{
+			.sampler = sampler,
+			.imageView = m == 0 ? depth_view : mip_views[m - 1],
+			.imageLayout = m == 0 ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL,
+		};
+
+		VkDescriptorImageInfo dst_inf{
+			.sampler = VK_NULL_HANDLE,
+			.imageView = mip_views[m],
+			.imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+		};
+
+		VkWriteDescriptorSet writes[2]{
+			vkinit::write_descriptor_set_image( VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, build_sets[m], &src_inf, 0 ),
+			vkinit::write_descriptor_set_image( VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, build_sets[m], &dst_inf, 1 ),
+		};
+
+		vkUpdateDescriptorSets( dev, 2, writes, 0, nullptr );
+	}
+
+	frames.resize( frame_count );
+	for( auto& fr: frames ){
+		VkBufferCreateInfo obj_cr_inf{
+			.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+			.pNext = nullptr,
+			.size = MAX_OBJECTS * sizeof( HiZObject ),
+			.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		};
+
+		VmaAllocationCreateInfo mapped_alloc{
+			.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT,
+			.usage = VMA_MEMORY_USAGE_CPU_TO_GPU,
+		};
+
+		VmaAllocationInfo alloc_inf;
+		VK_CHECK( vmaCreateBuffer( engine.vma_alloc, &obj_cr_inf, &mapped_alloc, &fr.objects.buffer, &fr.objects.allocation, &alloc_inf ));
+		fr.objects_mapped = alloc_inf.pMappedData;
+
+		fr.draws = engine.create_buffer(
+				MAX_OBJECTS * sizeof( VkDrawIndirectCommand ),
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+				VMA_MEMORY_USAGE_GPU_ONLY );
+
+		engine.deletion_queue.push( fr.objects );
+		engine.deletion_queue.push( fr.draws );
+
+		fr.cull_set = engine.descriptors.allocate( cull_set_layout ).set;
+
+		VkDescriptorImageInfo pyramid_inf{
+			.sampler = sampler,
+			.imageView = view,
+			.imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+		};
+
+		VkDescriptorBufferInfo objects_inf{
+			.buffer = fr.objects.buffer,
+			.offset = 0,
+			.range = VK_WHOLE_SIZE,
+		};
+
+		VkDescriptorBufferInfo draws_inf{
+			.buffer = fr.draws.buffer,
+			.offset = 0,
+			.range = VK_WHOLE_SIZE,
+		};
+
+		VkWriteDescriptorSet writes[3]{
+			vkinit::write_descriptor_set_image( VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, fr.cull_set, &pyramid_inf, 0 ),
+			{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.pNext = nullptr,
+				.dstSet = fr.cull_set,
+				.dstBinding = 1,
+				.descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.pBufferInfo = &objects_inf,
+			},
+			{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.pNext = nullptr,
+				.dstSet = fr.cull_set,
+				.dstBinding = 2,
+				.descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.pBufferInfo = &draws_inf,
+			},
+		};
+
+		vkUpdateDescriptorSets( dev, 3, writes, 0, nullptr );
+	}
+
+	create_compute( engine, FILE_PREFIX "shader/hiz_build.comp.spv", build_set_layout, sizeof( HiZBuildParams ), build_layout, build_pipeline );
+	create_compute( engine, FILE_PREFIX "shader/hiz_cull.comp.spv", cull_set_layout, sizeof( HiZCullParams ), cull_layout, cull_pipeline );
+
+	for( auto v: mip_views )
+		engine.deletion_queue.push( v );
+
+	engine.deletion_queue.push( sampler );
+	engine.deletion_queue.push( view );
+	engine.deletion_queue.push( pyramid );
+}
+
+VkBuffer HiZCuller::current_draws( VkEngine& engine ){
+	return frames.get( engine.frameNumber ).draws.buffer;
+}
+
+void HiZCuller::record_cull( VkEngine& engine, VkCommandBuffer cmd, const std::vector<RenderableObject>& objects ){
+	draw_count = 0;
+
+	if( !enabled || !cull_pipeline || objects.empty() )
+		return;
+
+	FrameResources& fr = frames.get( engine.frameNumber );
+	HiZObject* dst = static_cast<HiZObject*>( fr.objects_mapped );
+
+	draw_count = std::min<size_t>( objects.size(), MAX_OBJECTS );
+
+	for( uint32_t i = 0; i < draw_count; ++i ){
+		Mesh* mesh = engine.meshes.get( objects[i].mesh );
+
+		if( !mesh ){
+			dst[i] = HiZObject{ .bounds = objects[i].bounds };
+			continue;
+		}
+
+		const MeshLod& lod = mesh->lods[std::min<size_t>( objects[i].lod, mesh->lods.size() - 1 )];
+
+		dst[i] = HiZObject{
+			.bounds = objects[i].bounds,
+			.vertex_count = lod.vertex_count,
+			.first_vertex = mesh->base_vertex + lod.first_vertex,
+		};
+	}
+
+	HiZCullParams params{
+		.view_proj = pyramid_view_proj,
+		.pyramid_size = glm::vec2{ static_cast<float>( extent.width ), static_cast<float>( extent.height )},
+		.object_count = draw_count,
+		.pyramid_valid = pyramid_valid ? 1u : 0u,
+	};
+
+	vkCmdBindPipeline( cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cull_pipeline );
+	vkCmdBindDescriptorSets( cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cull_layout, 0, 1, &fr.cull_set, 0, nullptr );
+	vkCmdPushConstants( cmd, cull_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( HiZCullParams ), &params );
+	vkCmdDispatch( cmd, ( draw_count + 63 ) / 64, 1, 1 );
+}
+
+void HiZCuller::record_build( VkEngine& engine, VkCommandBuffer cmd, const glm::mat4& view_proj ){
+	if( !enabled || !build_pipeline )
+		return;
+
+	vkCmdBindPipeline( cmd, VK_PIPELINE_BIND_POINT_COMPUTE, build_pipeline );
+
+	glm::ivec2 src_size{ static_cast<int>( engine.windowExtent.width ), static_cast<int>( engine.windowExtent.height )};
+	glm::ivec2 dst_size{ static_cast<int>( extent.width ), static_cast<int>( extent.height )};
+
+	for( uint32_t m = 0; m < mip_levels; ++m ){
+		//Each mip reads the one written right before it
+		if( m > 0 ){
+			VkImageMemoryBarrier mip_barrier{
+				.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+				.pNext = nullptr,
+				.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+				.dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+				.oldLayout = VK_IMAGE_LAYOUT_GENERAL,
+				.newLayout = VK_IMAGE_LAYOUT_GENERAL,
+				.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.image = pyramid.image,
+				.subresourceRange = {
+					.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+					.baseMipLevel = m - 1,
+					.levelCount = 1,
+					.baseArrayLayer = 0,
+					.layerCount = 1,
+				},
+			};
+
+			vkCmdPipelineBarrier(
+					cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+					0, nullptr,
+					0, nullptr,
+					1, &mip_barrier );
+		}
+
+		HiZBuildParams params{
+			.src_size = src_size,
+			.dst_size = dst_size,
+			.from_depth = m == 0 ? 1u : 0u,
+		};
+
+		vkCmdBindDescriptorSets( cmd, VK_PIPELINE_BIND_POINT_COMPUTE, build_layout, 0, 1, &build_sets[m], 0, nullptr );
+		vkCmdPushConstants( cmd, build_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( HiZBuildParams ), &params );
+		vkCmdDispatch( cmd, ( dst_size.x + 7 ) / 8, ( dst_size.y + 7 ) / 8, 1 );
+
+		src_size = dst_size;
+		dst_size = glm::max( dst_size / 2, glm::ivec2{ 1 });
+	}
+
+	pyramid_view_proj = view_proj;
+	pyramid_valid = true;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "VkTypes.hpp"
+#include "VkFrameRing.hpp"
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <vector>
+
+struct VkEngine;
+struct RenderableObject;
+
+//Layout matches the Objects buffer in hiz_cull.comp
+struct HiZObject {
+	glm::vec4 bounds;		//World space, xyz center, w radius
+	uint32_t vertex_count;
+	uint32_t first_vertex;
+	uint32_t pad[2];
+};
+
+struct HiZBuildParams {
+	glm::ivec2 src_size;
+	glm::ivec2 dst_size;
+	uint32_t from_depth;
+};
+
+struct HiZCullParams {
+	glm::mat4 view_proj;	//Camera the pyramid was built with
+	glm::vec2 pyramid_size;
+	uint32_t object_count;
+	uint32_t pyramid_valid;
+};
+
+/*
+ * Occlusion culling against a depth pyramid (min in r, max in g) built from
+ * the previous frame's depth buffer. Before the main pass every object drawn by
+ * draw_objects is tested against it, the compute pass writes one indirect draw
+ * per object with an instance count of 0 for occluded ones.
+ *
+ * Objects outside the previous view or crossing its near plane count as visible.
+ *
+ * The per-object cull pass only serves the fallback with indirect drawing off,
+ * while it is on draw_objects gets no objects and record_cull returns early.
+ * indirect_cull.comp tests instances against the same pyramid, both shaders
+ * share the test in hiz_occlusion.glsl.
+ */
+struct HiZCuller {
+	constexpr static uint32_t MAX_OBJECTS = 16384;
+	constexpr static VkFormat FORMAT = VK_FORMAT_R32G32_SFLOAT;
+
+	bool enabled{ true };
+
+	VkExtent2D extent{};
+	uint32_t mip_levels{ 1 };
+
+	AllocatedImage pyramid{};
+	VkImageView view{ VK_NULL_HANDLE };
+
+	VkSampler sampler{ VK_NULL_HANDLE };
+
+	//Camera the pyramid was built with, other culling passes test against it too
+	glm::mat4 pyramid_view_proj{ 1.0f };
+	bool pyramid_valid{ false };
+
+	//Objects covered by this frame's indirect commands, the rest is drawn directly
+	uint32_t draw_count{ 0 };
+
+	//Half the size of depth, depth_view has to stay valid (the render graph keeps it)
+	void init( VkEngine& engine, VkExtent2D depth_extent, VkImageView depth_view );
+
+	VkBuffer current_draws( VkEngine& engine );
+
+	//Compute pass before the main pass
+	void record_cull( VkEngine& engine, VkCommandBuffer cmd, const std::vector<RenderableObject>& objects );
+	//Compute pass after the main pass, view_proj is what depth was rendered with
+	void record_build( VkEngine& engine, VkCommandBuffer cmd, const glm::mat4& view_proj );
+
+	private:
+		struct FrameResources {
+			AllocatedBuffer objects;
+			AllocatedBuffer draws;
+			void* objects_mapped;
+			VkDescriptorSet cull_set;
+		};
+
+		FrameRing<FrameResources> frames;
+		std::vector<VkImageView> mip_views;
+		std::vector<VkDescriptorSet> build_sets;
+
+		VkDescriptorSetLayout build_set_layout{ VK_NULL_HANDLE };
+		VkDescriptorSetLayout cull_set_layout{ VK_NULL_HANDLE };
+
+		VkPipelineLayout build_layout{ VK_NULL_HANDLE };
+		VkPipeline build_pipeline{ VK_NULL_HANDLE };
+		VkPipelineLayout cull_layout{ VK_NULL_HANDLE };
+		VkPipeline cull_pipeline{ VK_NULL_HANDLE };
+};
@@ -0,0 +1,483 @@
+#include "Core/VkImpostors.hpp"
+
+#include "Core/VkEngine.hpp"
+#include "Core/VkInit.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <iostream>
+
+//Keep in sync with octahedral_encode() in impostor.vert, y is the centre of the map
+static glm::vec3 octahedral_decode( glm::vec2 uv ){
+	glm::vec2 e = uv * 2.0f - 1.0f;
+	glm::vec3 d{ e.x, 1.0f - std::abs( e.x ) - std::abs( e.y ), e.y };
+
+	if( d.y < 0.0f ){
+		float x = ( 1.0f - std::abs( d.z )) * ( d.x >= 0.0f ? 1.0f : -1.0f );
+		float z = ( 1.0f - std::abs( d.x )) * ( d.z >= 0.0f ? 1.0f : -1.0f );
+		d.x = x;
+		d.z = z;
+	}
+
+	return glm::normalize( d );
+}
+
+//Orthographic view from dir (towards the viewer) onto the sphere, depth 0..1. Same basis as impostor.vert
+static glm::mat4 bake_view_proj( glm::vec3 dir, glm::vec4 sphere ){
+	glm::vec3 hint = std::abs( dir.y ) > 0.99f ? glm::vec3{ 0.0f, 0.0f, 1.0f } : glm::vec3{ 0.0f, 1.0f, 0.0f };
+	glm::vec3 right = glm::normalize( glm::cross( hint, dir ));
+	glm::vec3 up = glm::cross( dir, right );
+
+	float r = std::max( sphere.w, 1e-4f );
+	glm::vec3 eye = glm::vec3{ sphere } + dir * 2.0f * r;
+
+	glm::mat4 view{ 1.0f };
+	for( int i = 0; i < 3; ++i ){
+		view[i][0] = right[i];
+		view[i][1] = up[i];
+		view[i][2] = dir[i];
+	}
+
+	view[3] = glm::vec4{ -glm::dot( right, eye ), -glm::dot( up, eye ), -glm::dot( dir, eye ), 1.0f };
+
+	float near = 0.5f * r;
+	float far = 3.5f * r;
+
+	glm::mat4 proj{ 0.0f };
+	proj[0][0] = 1.0f / r;
+	proj[1][1] = -1.0f / r;
+	proj[2][2] = -1.0f / ( far - near );
+	proj[3][2] = -near / ( far - near );
+	proj[3][3] = 1.0f;
+
+	return proj * view;
+}
+
+bool ImpostorAtlas::enable( VkEngine& engine, Handle<Mesh> mesh, Handle<Material> mat ){
+	Mesh* m = engine.meshes.get( mesh );
+	if( !m || m->lods.empty() || !engine.materials.get( mat ))
+		return false;
+
+	for( auto& slot: slots ){
+		if( slot.mesh == mesh && slot.mat == mat )
+			return true;
+	}
+
+	//Bounding sphere of the full detail level, around the centre of its box
+	const MeshLod& lod = m->lods[0];
+	glm::vec3 lo{ INFINITY }, hi{ -INFINITY };
+
+	for( uint32_t v = lod.first_vertex; v < lod.first_vertex + lod.vertex_count; ++v ){
+		lo = glm::min( lo, m->vertices[v].pos );
+		hi = glm::max( hi, m->vertices[v].pos );
+	}
+
+	glm::vec3 center = ( lo + hi ) * 0.5f;
+	float radius = 0.0f;
+
+	for( uint32_t v = lod.first_vertex; v < lod.first_vertex + lod.vertex_count; ++v )
+		radius = std::max( radius, glm::length( m->vertices[v].pos - center ));
+
+	for( uint32_t s = 0; s < slots.size(); ++s ){
+		if( slots[s].mesh )
+			continue;
+
+		slots[s] = ImpostorSlot{ .mesh = mesh, .mat = mat, .sphere = glm::vec4{ center, radius }};
+		bake_queue.push_back( s );
+		return true;
+	}
+
+	return false;
+}
+
+void ImpostorAtlas::disable( Handle<Mesh> mesh, Handle<Material> mat ){
+	for( auto& slot: slots ){
+		if( slot.mesh == mesh && slot.mat == mat ){
+			slot = ImpostorSlot{};
+			++version;
+		}
+	}
+}
+
+void ImpostorAtlas::rebake( Handle<Material> mat ){
+	for( uint32_t s = 0; s < slots.size(); ++s ){
+		if( !slots[s].mesh || slots[s].mat != mat || !slots[s].baked )
+			continue;
+
+		//Drawn as meshes until the new bake is in
+		slots[s].baked = false;
+		bake_queue.push_back( s );
+		++version;
+	}
+}
+
+uint32_t ImpostorAtlas::find( Handle<Mesh> mesh, Handle<Material> mat ) const {
+	for( uint32_t s = 0; s < slots.size(); ++s ){
+		if( slots[s].baked && slots[s].mesh == mesh && slots[s].mat == mat )
+			return s;
+	}
+
+	return NO_SLOT;
+}
+
+VkRect2D ImpostorAtlas::slot_rect( uint32_t slot ) const {
+	return VkRect2D{
+		.offset = {
+			static_cast<int32_t>(( slot % SLOTS_X ) * SLOT_SIZE ),
+			static_cast<int32_t>(( slot / SLOTS_X ) * SLOT_SIZE ),
+		},
+		.extent = { SLOT_SIZE, SLOT_SIZE },
+	};
+}
+
+VkRect2D ImpostorAtlas::tile_rect( uint32_t slot, uint32_t x, uint32_t y ) const {
+	VkRect2D rect = slot_rect( slot );
+
+	rect.offset.x += x * TILE_SIZE;
+	rect.offset.y += y * TILE_SIZE;
+	rect.extent = { TILE_SIZE, TILE_SIZE };
+
+	return rect;
+}
+
+void ImpostorAtlas::init( VkEngine& engine, VkRenderPass bake_pass, VkRenderPass pass ){
+	VkDevice dev = engine.vk_device;
+
+	VmaAllocationCreateInfo img_alloc{
+		.usage = VMA_MEMORY_USAGE_GPU_ONLY,
+	};
+
+	auto atlas_cr_inf = vkinit::image_create_info( FORMAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VkExtent3D{ WIDTH, HEIGHT, 1 });
+	VK_CHECK( vmaCreateImage( engine.vma_alloc, &atlas_cr_inf, &img_alloc, &atlas.image, &atlas.allocation, nullptr ));
+
+	auto atlas_view_inf = vkinit::image_view_create_info( FORMAT, atlas.image, VK_IMAGE_ASPECT_COLOR_BIT );
+	VK_CHECK( vkCreateImageView( dev, &atlas_view_inf, nullptr, &atlas_view ));
+
+	list = engine.create_buffer(
+			MAX_IMPOSTORS * sizeof( GpuImpostor ),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VMA_MEMORY_USAGE_GPU_ONLY );
+
+	draw_cmd = engine.create_buffer(
+			sizeof( VkDrawIndirectCommand ),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VMA_MEMORY_USAGE_GPU_ONLY );
+
+	//Transparent atlas and no impostors until the first cull pass, in the state the render graph expects
+	engine.immediate_submit( [&]( VkCommandBuffer cmd ){
+			VkImageSubresourceRange range{
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.baseMipLevel = 0,
+				.levelCount = 1,
+				.baseArrayLayer = 0,
+				.layerCount = 1,
+			};
+
+			VkImageMemoryBarrier to_transfer{
+				.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+				.pNext = nullptr,
+				.srcAccessMask = 0,
+				.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+				.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+				.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.image = atlas.image,
+				.subresourceRange = range,
+			};
+
+			vkCmdPipelineBarrier(
+					cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+					0, nullptr,
+					0, nullptr,
+					1, &to_transfer );
+
+			VkClearColorValue transparent{ .float32 = { 0.0f, 0.0f, 0.0f, 0.0f }};
+			vkCmdClearColorImage( cmd, atlas.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &transparent, 1, &range );
+			vkCmdFillBuffer( cmd, draw_cmd.buffer, 0, VK_WHOLE_SIZE, 0 );
+
+			VkImageMemoryBarrier to_initial = to_transfer;
+			to_initial.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			to_initial.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			to_initial.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			to_initial.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+			VkMemoryBarrier filled{
+				.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+				.pNext = nullptr,
+				.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+				.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+			};
+
+			vkCmdPipelineBarrier(
+					cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+					1, &filled,
+					0, nullptr,
+					1, &to_initial );
+		});
+
+	auto sampler_inf = vkinit::sampler_create_info( VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE );
+	VK_CHECK( vkCreateSampler( dev, &sampler_inf, nullptr, &sampler ));
+
+	engine.deletion_queue.push( list );
+	engine.deletion_queue.push( draw_cmd );
+	engine.deletion_queue.push( sampler );
+	engine.deletion_queue.push( atlas_view );
+	engine.deletion_queue.push( atlas );
+
+	PipelineBuilder pipe_builder;
+
+	VertexInputDescription vertex_desc{ Vertex::get_vk_description() };
+
+	//Baking, the material's texture with fixed lighting
+	VkShaderModule bake_vert{}, bake_frag{};
+
+	if( !engine.vk_load_shader( FILE_PREFIX "shader/impostor_bake.vert.spv", &bake_vert )){
+		std::cout << "Failed to load impostor bake vert shader" << std::endl;
+	}
+
+	if( !engine.vk_load_shader( FILE_PREFIX "shader/impostor_bake.frag.spv", &bake_frag )){
+		std::cout << "Failed to load impostor bake frag shader" << std::endl;
+	}
+
+	VkPushConstantRange bake_push_constant{
+		.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+		.offset = 0,
+		.size = sizeof( ImpostorBakePushConstants ),
+	};
+
+	auto bake_lay_cr_inf = vkinit::pipeline_layout();
+	bake_lay_cr_inf.setLayoutCount = 1;
+	bake_lay_cr_inf.pSetLayouts = &engine.single_tex_layout;
+	bake_lay_cr_inf.pushConstantRangeCount = 1;
+	bake_lay_cr_inf.pPushConstantRanges = &bake_push_constant;
+
+	VK_CHECK( vkCreatePipelineLayout( dev, &bake_lay_cr_inf, nullptr, &bake_layout ));
+
+	pipe_builder.vertex_in_info = vkinit::vertex_input_state_create_info();
+	pipe_builder.vertex_in_info.vertexAttributeDescriptionCount = vertex_desc.attributes.size();
+	pipe_builder.vertex_in_info.pVertexAttributeDescriptions = vertex_desc.attributes.data();
+	pipe_builder.vertex_in_info.vertexBindingDescriptionCount = vertex_desc.bindings.size();
+	pipe_builder.vertex_in_info.pVertexBindingDescriptions = vertex_desc.bindings.data();
+
+	pipe_builder.shader_stages.push_back(
+			vkinit::shader_stage_create_info( VK_SHADER_STAGE_VERTEX_BIT, bake_vert ));
+
+	pipe_builder.shader_stages.push_back(
+			vkinit::shader_stage_create_info( VK_SHADER_STAGE_FRAGMENT_BIT, bake_frag ));
+
+	pipe_builder.input_assembly = vkinit::input_assembly_state_create_info( VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST );
+
+	//Set per tile
+	pipe_builder.viewport = VkViewport{ 0.0f, 0.0f, static_cast<float>( TILE_SIZE ), static_cast<float>( TILE_SIZE ), 0.0f, 1.0f };
+	pipe_builder.scissor = VkRect2D{ { 0, 0 }, { TILE_SIZE, TILE_SIZE }};
+	pipe_builder.dynamic_states = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+	pipe_builder.rasterizer = vkinit::rasterization_state_create_info( VK_POLYGON_MODE_FILL );
+	pipe_builder.multisample_state = vkinit::multisample_state_create_info();
+	pipe_builder.color_blend = vkinit::color_blend_attachment_state();
+	pipe_builder.depth_stencil_state = vkinit::depth_stencil_state_create_info( VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL );
+	pipe_builder.pipeline_layout = bake_layout;
+
+	bake_pipeline = pipe_builder.build_pipeline( dev, bake_pass );
+
+	vkDestroyShaderModule( dev, bake_vert, nullptr );
+	vkDestroyShaderModule( dev, bake_frag, nullptr );
+
+	engine.deletion_queue.push( bake_pipeline );
+	engine.deletion_queue.push( bake_layout );
+
+	//Billboards, atlas and the list the cull pass writes
+	VkDescriptorSetLayoutBinding bindings[2]{
+		{
+			.binding = 0,
+			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+		},
+		{
+			.binding = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+		},
+	};
+
+	set_layout = engine.layouts.get( bindings, 2 );
+	set = engine.descriptors.allocate( set_layout ).set;
+
+	VkDescriptorImageInfo atlas_inf{
+		.sampler = sampler,
+		.imageView = atlas_view,
+		.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+	};
+
+	VkDescriptorBufferInfo list_inf{
+		.buffer = list.buffer,
+		.offset = 0,
+		.range = VK_WHOLE_SIZE,
+	};
+
+	VkWriteDescriptorSet writes[2]{
+		vkinit::write_descriptor_set_image( VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, set, &atlas_inf, 0 ),
+		VkWriteDescriptorSet{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.pNext = nullptr,
+			.dstSet = set,
+			.dstBinding = 1,
+			.descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.pBufferInfo = &list_inf,
+		},
+	};
+
+	vkUpdateDescriptorSets( dev, 2, writes, 0, nullptr );
+
+
+	VkShaderModule vert{}, frag{};
+
+	if( !engine.vk_load_shader( FILE_PREFIX "shader/impostor.vert.spv", &vert )){
+		std::cout << "Failed to load impostor vert shader" << std::endl;
+	}
+
+	if( !engine.vk_load_shader( FILE_PREFIX "shader/impostor.frag.spv", &frag )){
+		std::cout << "Failed to load impostor frag shader" << std::endl;
+	}
+
+	VkDescriptorSetLayout sets[2] = { engine.global_desc_layout, set_layout };
+
+	auto pipe_lay_cr_inf = vkinit::pipeline_layout();
+	pipe_lay_cr_inf.setLayoutCount = 2;
+	pipe_lay_cr_inf.pSetLayouts = sets;
+
+	VK_CHECK( vkCreatePipelineLayout( dev, &pipe_lay_cr_inf, nullptr, &layout ));
+
+	//Quads come from gl_VertexIndex, no vertex buffer
+	pipe_builder.vertex_in_info = vkinit::vertex_input_state_create_info();
+
+	pipe_builder.shader_stages.clear();
+	pipe_builder.shader_stages.push_back(
+			vkinit::shader_stage_create_info( VK_SHADER_STAGE_VERTEX_BIT, vert ));
+
+	pipe_builder.shader_stages.push_back(
+			vkinit::shader_stage_create_info( VK_SHADER_STAGE_FRAGMENT_BIT, frag ));
+
+	pipe_builder.viewport.x = 0;
+	pipe_builder.viewport.y = 0;
+	pipe_builder.viewport.width = engine.windowExtent.width;
+	pipe_builder.viewport.height = engine.windowExtent.height;
+	pipe_builder.viewport.minDepth = 0;
+	pipe_builder.viewport.maxDepth = 1;
+
+	pipe_builder.scissor.offset = { 0, 0 };
+	pipe_builder.scissor.extent = engine.windowExtent;
+	pipe_builder.dynamic_states.clear();
+
+	pipe_builder.pipeline_layout = layout;
+
+	pipeline = pipe_builder.build_pipeline( dev, pass );
+
+	vkDestroyShaderModule( dev, vert, nullptr );
+	vkDestroyShaderModule( dev, frag, nullptr );
+
+	engine.deletion_queue.push( pipeline );
+	engine.deletion_queue.push( layout );
+}
+
+void ImpostorAtlas::record_bake( VkEngine& engine, VkCommandBuffer cmd ){
+	if( bake_queue.empty() || !bake_pipeline )
+		return;
+
+	vkCmdBindPipeline( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, bake_pipeline );
+	engine.geometry.bind( cmd );
+
+	uint32_t baked = 0;
+	size_t done = 0;
+
+	for( ; done < bake_queue.size() && baked < MAX_BAKES_PER_FRAME; ++done ){
+		ImpostorSlot& slot = slots[bake_queue[done]];
+
+		//Freed while it waited
+		Mesh* mesh = engine.meshes.get( slot.mesh );
+		Material* mat = engine.materials.get( slot.mat );
+
+		if( !mesh || !mat || mesh->lods.empty() || slot.baked )
+			continue;
+
+		VkClearAttachment clears[2]{
+			{
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.colorAttachment = 0,
+				.clearValue = VkClearValue{ .color = {{ 0.0f, 0.0f, 0.0f, 0.0f }}},
+			},
+			{
+				.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+				.colorAttachment = 0,
+				.clearValue = VkClearValue{ .depthStencil = { .depth = 1.0f }},
+			},
+		};
+
+		VkClearRect clear_rect{
+			.rect = slot_rect( bake_queue[done] ),
+			.baseArrayLayer = 0,
+			.layerCount = 1,
+		};
+
+		vkCmdClearAttachments( cmd, 2, clears, 1, &clear_rect );
+
+		engine.touch_texture( mat->texture );
+
+		if( mat->tex_set )
+			vkCmdBindDescriptorSets( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, bake_layout, 0, 1, &mat->tex_set, 0, nullptr );
+
+		for( uint32_t y = 0; y < VIEWS; ++y ){
+			for( uint32_t x = 0; x < VIEWS; ++x ){
+				VkRect2D tile = tile_rect( bake_queue[done], x, y );
+
+				VkViewport tile_viewport{
+					.x = static_cast<float>( tile.offset.x ),
+					.y = static_cast<float>( tile.offset.y ),
+					.width = static_cast<float>( TILE_SIZE ),
+					.height = static_cast<float>( TILE_SIZE ),
+					.minDepth = 0.0f,
+					.maxDepth = 1.0f,
+				};
+
+				vkCmdSetViewport( cmd, 0, 1, &tile_viewport );
+				vkCmdSetScissor( cmd, 0, 1, &tile );
+
+				glm::vec3 dir = octahedral_decode( glm::vec2{ x + 0.5f, y + 0.5f } / static_cast<float>( VIEWS ));
+
+				ImpostorBakePushConstants consts{
+					.view_proj = bake_view_proj( dir, slot.sphere ),
+					.light_dir = glm::vec4{ glm::normalize( glm::vec3{ 0.3f, 1.0f, 0.5f }), 0.0f },
+				};
+
+				vkCmdPushConstants( cmd, bake_layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof( ImpostorBakePushConstants ), &consts );
+				vkCmdDraw( cmd, mesh->lods[0].vertex_count, 1, mesh->base_vertex + mesh->lods[0].first_vertex, 0 );
+			}
+		}
+
+		slot.baked = true;
+		++baked;
+	}
+
+	bake_queue.erase( bake_queue.begin(), bake_queue.begin() + done );
+
+	//Recorded before the cull pass, so this frame's batch table can already use the new slots
+	if( baked )
+		++version;
+}
+
+void ImpostorAtlas::draw( VkEngine& engine, VkCommandBuffer cmd ){
+	//The list is only written by the GPU culling path
+	if( !pipeline || !engine.indirect.enabled )
+		return;
+
+	vkCmdBindPipeline( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline );
+	vkCmdBindDescriptorSets( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &engine.get_curr_frame().global_desc, 0, nullptr );
+	vkCmdBindDescriptorSets( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 1, 1, &set, 0, nullptr );
+
+	vkCmdDrawIndirect( cmd, draw_cmd.buffer, 0, 1, sizeof( VkDrawIndirectCommand ));
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "VkTypes.hpp"
+#include "VkSlotMap.hpp"
+#include "VkMesh.hpp"
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <vector>
+
+struct VkEngine;
+struct Material;
+
+struct ImpostorBakePushConstants {
+	glm::mat4 view_proj;	//Object space into one tile
+	glm::vec4 light_dir;	//Object space, fixed for every view
+};
+
+//Layout matches the Impostors buffer in indirect_cull.comp and impostor.vert
+struct GpuImpostor {
+	glm::mat4 transform;
+	glm::vec4 sphere;		//Object space bounding sphere the slot was baked with
+	uint32_t slot;
+	uint32_t pad[3];
+};
+
+struct ImpostorSlot {
+	Handle<Mesh> mesh;
+	Handle<Material> mat;
+	glm::vec4 sphere{};
+	bool baked{ false };
+};
+
+/*
+ * Pre-rendered views of a mesh and material pair for entities too small on
+ * screen to be worth their geometry. Each slot of the atlas is a VIEWS x VIEWS
+ * grid of tiles, tile ( x, y ) is an orthographic view from the direction at
+ * its centre on an octahedral map of the sphere around the mesh.
+ *
+ * Slots are baked once, a few per frame, in their own graph pass. The GPU
+ * culling pass routes visible instances under max_pixels into the list here,
+ * which is drawn with a single instanced draw of camera facing quads that pick
+ * the tile closest to their view direction.
+ */
+struct ImpostorAtlas {
+	constexpr static uint32_t TILE_SIZE = 64;
+	constexpr static uint32_t VIEWS = 8;
+	constexpr static uint32_t SLOT_SIZE = TILE_SIZE * VIEWS;
+	constexpr static uint32_t SLOTS_X = 4;
+	constexpr static uint32_t SLOTS_Y = 4;
+	constexpr static uint32_t WIDTH = SLOTS_X * SLOT_SIZE;
+	constexpr static uint32_t HEIGHT = SLOTS_Y * SLOT_SIZE;
+	constexpr static VkFormat FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+	constexpr static uint32_t MAX_IMPOSTORS = 16384;
+	constexpr static uint32_t MAX_BAKES_PER_FRAME = 2;
+	constexpr static uint32_t NO_SLOT = UINT32_MAX;
+
+	//Entities whose bounds cover fewer pixels across are drawn as impostors
+	float max_pixels{ 48.0f };
+
+	std::vector<ImpostorSlot> slots{ SLOTS_X * SLOTS_Y };
+	//Bumped whenever a slot is baked or freed, batch tables referencing slots have to be rebuilt
+	uint32_t version{ 0 };
+
+	//False if every slot is taken. The mesh has to be uploaded
+	bool enable( VkEngine& engine, Handle<Mesh> mesh, Handle<Material> mat );
+	void disable( Handle<Mesh> mesh, Handle<Material> mat );
+	//Bakes the slots of mat again, e.g. after its texture changed
+	void rebake( Handle<Material> mat );
+
+	//Baked slot of the pair, NO_SLOT otherwise
+	uint32_t find( Handle<Mesh> mesh, Handle<Material> mat ) const;
+
+	AllocatedImage atlas{};
+	VkImageView atlas_view{ VK_NULL_HANDLE };
+	VkSampler sampler{ VK_NULL_HANDLE };
+
+	//Filled by IndirectRenderer's cull pass, one VkDrawIndirectCommand in draw
+	AllocatedBuffer list{};
+	AllocatedBuffer draw_cmd{};
+
+	//bake_pass comes from the graph, pass is the main render pass
+	void init( VkEngine& engine, VkRenderPass bake_pass, VkRenderPass pass );
+
+	void record_bake( VkEngine& engine, VkCommandBuffer cmd );
+	//False skips the bake pass in the graph
+	inline bool bake_pending() const { return !bake_queue.empty() && bake_pipeline; }
+	void draw( VkEngine& engine, VkCommandBuffer cmd );
+
+	private:
+		std::vector<uint32_t> bake_queue;
+
+		VkPipelineLayout bake_layout{ VK_NULL_HANDLE };
+		VkPipeline bake_pipeline{ VK_NULL_HANDLE };
+
+		VkDescriptorSetLayout set_layout{ VK_NULL_HANDLE };
+		VkDescriptorSet set{ VK_NULL_HANDLE };
+
+		VkPipelineLayout layout{ VK_NULL_HANDLE };
+		VkPipeline pipeline{ VK_NULL_HANDLE };
+
+		VkRect2D slot_rect( uint32_t slot ) const;
+		VkRect2D tile_rect( uint32_t slot, uint32_t x, uint32_t y ) const;
+};
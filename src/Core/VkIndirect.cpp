@@ -0,0 +1,556 @@
+#include "Core/VkIndirect.hpp"
+
+#include "Core/VkEngine.hpp"
+#include "Core/VkInit.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+void IndirectRenderer::init( VkEngine& engine, VkRenderPass pass ){
+	VkDevice dev = engine.vk_device;
+
+	instances = engine.create_buffer(
+			MAX_INSTANCES * sizeof( GpuInstance ),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VMA_MEMORY_USAGE_GPU_ONLY );
+
+	batch_table = engine.create_buffer(
+			MAX_BATCHES * sizeof( GpuBatch ),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VMA_MEMORY_USAGE_GPU_ONLY );
+
+	instance_lods = engine.create_buffer(
+			MAX_INSTANCES * sizeof( uint32_t ),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VMA_MEMORY_USAGE_GPU_ONLY );
+
+	visible = engine.create_buffer(
+			MAX_INSTANCES * MAX_MESH_LODS * sizeof( uint32_t ),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VMA_MEMORY_USAGE_GPU_ONLY );
+
+	draws = engine.create_buffer(
+			COUNTS_OFFSET + MAX_BATCHES * sizeof( uint32_t ),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VMA_MEMORY_USAGE_GPU_ONLY );
+
+	engine.deletion_queue.push( instances );
+	engine.deletion_queue.push( batch_table );
+	engine.deletion_queue.push( instance_lods );
+	engine.deletion_queue.push( visible );
+	engine.deletion_queue.push( draws );
+
+	//Shared by the cull pipeline (set 1) and the draw pipeline (set 2)
+	VkDescriptorSetLayoutBinding bindings[9];
+	for( uint32_t b = 0; b < 9; ++b ){
+		bindings[b] = VkDescriptorSetLayoutBinding{
+			.binding = b,
+			.descriptorType = b == 6 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT,
+		};
+	}
+
+	set_layout = engine.layouts.get( bindings, 9 );
+	set = engine.descriptors.allocate( set_layout ).set;
+
+	//The impostor list and its draw belong to ImpostorAtlas, init after it
+	VkDescriptorBufferInfo buffer_infs[8]{
+		{ .buffer = instances.buffer, .offset = 0, .range = VK_WHOLE_SIZE },
+		{ .buffer = batch_table.buffer, .offset = 0, .range = VK_WHOLE_SIZE },
+		{ .buffer = visible.buffer, .offset = 0, .range = VK_WHOLE_SIZE },
+		{ .buffer = draws.buffer, .offset = 0, .range = COUNTS_OFFSET },
+		{ .buffer = draws.buffer, .offset = COUNTS_OFFSET, .range = VK_WHOLE_SIZE },
+		{ .buffer = instance_lods.buffer, .offset = 0, .range = VK_WHOLE_SIZE },
+		{ .buffer = engine.impostors.list.buffer, .offset = 0, .range = VK_WHOLE_SIZE },
+		{ .buffer = engine.impostors.draw_cmd.buffer, .offset = 0, .range = VK_WHOLE_SIZE },
+	};
+
+	//Occlusion is tested against the pyramid HiZCuller builds, init after it
+	VkDescriptorImageInfo pyramid_inf{
+		.sampler = engine.hiz.sampler,
+		.imageView = engine.hiz.view,
+		.imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+	};
+
+	VkWriteDescriptorSet writes[9];
+	for( uint32_t b = 0; b < 9; ++b ){
+		if( b == 6 ){
+			writes[b] = vkinit::write_descriptor_set_image( VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, set, &pyramid_inf, 6 );
+			continue;
+		}
+
+		writes[b] = VkWriteDescriptorSet{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.pNext = nullptr,
+			.dstSet = set,
+			.dstBinding = b,
+			.descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.pBufferInfo = &buffer_infs[b < 6 ? b : b - 1],
+		};
+	}
+
+	vkUpdateDescriptorSets( dev, 9, writes, 0, nullptr );
+
+
+	//Culling
+	VkShaderModule cull_comp{};
+	if( !engine.vk_load_shader( FILE_PREFIX "shader/indirect_cull.comp.spv", &cull_comp )){
+		std::cout << "Failed to load indirect cull shader" << std::endl;
+	}
+
+	VkPushConstantRange push_constant{
+		.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		.offset = 0,
+		.size = sizeof( GpuCullParams ),
+	};
+
+	VkDescriptorSetLayout cull_sets[2] = { engine.global_desc_layout, set_layout };
+
+	auto cull_lay_cr_inf = vkinit::pipeline_layout();
+	cull_lay_cr_inf.setLayoutCount = 2;
+	cull_lay_cr_inf.pSetLayouts = cull_sets;
+	cull_lay_cr_inf.pushConstantRangeCount = 1;
+	cull_lay_cr_inf.pPushConstantRanges = &push_constant;
+
+	VK_CHECK( vkCreatePipelineLayout( dev, &cull_lay_cr_inf, nullptr, &cull_layout ));
+
+	VkComputePipelineCreateInfo cull_cr_inf{
+		.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+		.pNext = nullptr,
+		.stage = vkinit::shader_stage_create_info( VK_SHADER_STAGE_COMPUTE_BIT, cull_comp ),
+		.layout = cull_layout,
+	};
+
+	if( vkCreateComputePipelines( dev, VK_NULL_HANDLE, 1, &cull_cr_inf, nullptr, &cull_pipeline ) != VK_SUCCESS ){
+		std::cout << "Could not create indirect cull pipeline" << std::endl;
+		cull_pipeline = VK_NULL_HANDLE;
+	}
+
+	vkDestroyShaderModule( dev, cull_comp, nullptr );
+
+	engine.deletion_queue.push( cull_pipeline );
+	engine.deletion_queue.push( cull_layout );
+
+	//Drawing, same shading as the scene pipelines with transforms from the instance buffer
+	if( !engine.vk_load_shader( FILE_PREFIX "shader/indirect.vert.spv", &draw_vert )){
+		std::cout << "Failed to load indirect vert shader" << std::endl;
+	}
+
+	if( !engine.vk_load_shader( FILE_PREFIX "shader/triangle.frag.spv", &draw_frag )){
+		std::cout << "Failed to load indirect frag shader" << std::endl;
+	}
+
+	engine.deletion_queue.push( draw_vert );
+	engine.deletion_queue.push( draw_frag );
+
+	VkDescriptorSetLayout draw_sets[3] = { engine.global_desc_layout, engine.single_tex_layout, set_layout };
+
+	auto draw_lay_cr_inf = vkinit::pipeline_layout();
+	draw_lay_cr_inf.setLayoutCount = 3;
+	draw_lay_cr_inf.pSetLayouts = draw_sets;
+
+	VK_CHECK( vkCreatePipelineLayout( dev, &draw_lay_cr_inf, nullptr, &draw_layout ));
+
+	engine.deletion_queue.push( draw_layout );
+
+	draw_pass = pass;
+	draw_pipeline( engine, MATERIAL_DEFAULT );
+}
+
+VkPipeline IndirectRenderer::draw_pipeline( VkEngine& engine, uint32_t features ){
+	auto it = draw_pipelines.find( features );
+	if( it != draw_pipelines.end() )
+		return it->second;
+
+	if( !draw_vert || !draw_frag )
+		return VK_NULL_HANDLE;
+
+	MaterialSpecialization spec( features );
+
+	PipelineBuilder pipe_builder;
+
+	//Vertices are pulled from the geometry arena in set 0
+	pipe_builder.vertex_in_info = vkinit::vertex_input_state_create_info();
+
+	pipe_builder.shader_stages.push_back(
+			vkinit::shader_stage_create_info( VK_SHADER_STAGE_VERTEX_BIT, draw_vert ));
+
+	pipe_builder.shader_stages.push_back(
+			vkinit::shader_stage_create_info( VK_SHADER_STAGE_FRAGMENT_BIT, draw_frag ));
+	pipe_builder.shader_stages.back().pSpecializationInfo = &spec.info;
+
+	pipe_builder.input_assembly = vkinit::input_assembly_state_create_info( VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST );
+
+	pipe_builder.viewport.x = 0;
+	pipe_builder.viewport.y = 0;
+	pipe_builder.viewport.width = engine.windowExtent.width;
+	pipe_builder.viewport.height = engine.windowExtent.height;
+	pipe_builder.viewport.minDepth = 0;
+	pipe_builder.viewport.maxDepth = 1;
+
+	pipe_builder.scissor.offset = { 0, 0 };
+	pipe_builder.scissor.extent = engine.windowExtent;
+
+	pipe_builder.rasterizer = vkinit::rasterization_state_create_info( VK_POLYGON_MODE_FILL );
+	pipe_builder.multisample_state = vkinit::multisample_state_create_info();
+	pipe_builder.color_blend = vkinit::color_blend_attachment_state();
+	pipe_builder.depth_stencil_state = vkinit::depth_stencil_state_create_info( VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL );
+	pipe_builder.pipeline_layout = draw_layout;
+
+	VkPipeline pipeline = pipe_builder.build_pipeline( engine.vk_device, draw_pass );
+
+	engine.deletion_queue.push( pipeline );
+
+	draw_pipelines.emplace( features, pipeline );
+	return pipeline;
+}
+
+void IndirectRenderer::update( VkEngine& engine ){
+	SceneStore& scene = engine.scene;
+
+	//draw() records nothing while disabled
+	if( enabled != was_enabled ){
+		was_enabled = enabled;
+		++engine.draw_version;
+	}
+
+	//Nothing is mirrored while disabled, start over once enabled again
+	if( !enabled ){
+		scene.moved.clear();
+		scene.layout_changed = true;
+		return;
+	}
+
+	if( scene.layout_changed ){
+		rebuild_batches( engine );
+	} else {
+		for( auto i: scene.moved ){
+			if( i < instance_count )
+				pending.push_back( i );
+		}
+	}
+
+	scene.moved.clear();
+
+	//Counts as used even if every instance was culled, draw() may replay a cached recording
+	Handle<Material> last_mat{};
+	for( const Batch& batch: batches ){
+		if( batch.mat == last_mat )
+			continue;
+		last_mat = batch.mat;
+
+		if( Material* mat = engine.materials.get( batch.mat ))
+			engine.touch_texture( mat->texture );
+	}
+}
+
+void IndirectRenderer::rebuild_batches( VkEngine& engine ){
+	SceneStore& scene = engine.scene;
+
+	//Entities past MAX_INSTANCES are not drawn
+	instance_count = std::min( scene.size(), MAX_INSTANCES );
+	instance_batches.assign( instance_count, NO_BATCH );
+
+	std::vector<uint32_t> order;
+	order.reserve( instance_count );
+
+	for( uint32_t i = 0; i < instance_count; ++i ){
+		if( !( scene.flags[i] & ENTITY_HIDDEN ) && scene.render[i].mesh && scene.render[i].mat )
+			order.push_back( i );
+	}
+
+	auto features_of = [&]( Handle<Material> h ){
+		Material* mat = engine.materials.get( h );
+		return mat ? mat->features : MATERIAL_DEFAULT;
+	};
+
+	//Pipeline permutation first, then material, so draw() rebinds both as rarely as possible
+	std::sort( order.begin(), order.end(), [&]( uint32_t a, uint32_t b ){
+			const RenderHandles& ra = scene.render[a];
+			const RenderHandles& rb = scene.render[b];
+
+			uint32_t fa = features_of( ra.mat );
+			uint32_t fb = features_of( rb.mat );
+			if( fa != fb )
+				return fa < fb;
+
+			return ra.mat.id != rb.mat.id ? ra.mat.id < rb.mat.id : ra.mesh.id < rb.mesh.id;
+		});
+
+	batches.clear();
+	uint32_t next_first = 0;
+
+	for( auto i: order ){
+		const RenderHandles& r = scene.render[i];
+
+		if( batches.empty() || batches.back().mesh != r.mesh || batches.back().mat != r.mat ){
+			if( batches.size() == MAX_BATCHES )
+				break;
+
+			batches.push_back( Batch{ r.mesh, r.mat, next_first, 0 });
+			draw_pipeline( engine, features_of( r.mat ));
+		}
+
+		instance_batches[i] = batches.size() - 1;
+		++batches.back().count;
+		next_first += MAX_MESH_LODS;
+	}
+
+	pending.resize( instance_count );
+	for( uint32_t i = 0; i < instance_count; ++i )
+		pending[i] = i;
+
+	batches_pending = true;
+	scene.layout_changed = false;
+	++engine.draw_version;
+}
+
+void IndirectRenderer::record_uploads( VkEngine& engine, VkCommandBuffer cmd ){
+	SceneStore& scene = engine.scene;
+
+	//Slots were baked or freed since the table went up
+	if( impostor_version != engine.impostors.version ){
+		impostor_version = engine.impostors.version;
+		batches_pending = true;
+		++engine.draw_version;
+	}
+
+	if( batches_pending ){
+		std::vector<GpuBatch> table( batches.size() );
+
+		for( size_t b = 0; b < batches.size(); ++b ){
+			Mesh* mesh = engine.meshes.get( batches[b].mesh );
+
+			table[b] = GpuBatch{
+				.first = batches[b].first,
+				.capacity = batches[b].count,
+				.lod_count = mesh ? static_cast<uint32_t>( std::min<size_t>( mesh->lods.size(), MAX_MESH_LODS )) : 0,
+				.impostor = engine.impostors.find( batches[b].mesh, batches[b].mat ),
+			};
+
+			if( table[b].impostor != ImpostorAtlas::NO_SLOT )
+				table[b].impostor_sphere = engine.impostors.slots[table[b].impostor].sphere;
+
+			for( uint32_t l = 0; l < table[b].lod_count; ++l ){
+				table[b].lod_first_vertex[l] = mesh->base_vertex + mesh->lods[l].first_vertex;
+				table[b].lod_vertex_count[l] = mesh->lods[l].vertex_count;
+				table[b].lod_error[l] = mesh->lods[l].error;
+			}
+		}
+
+		VkDeviceSize size = table.size() * sizeof( GpuBatch );
+		VkDeviceSize offset = size ? engine.frame_staging.push( table.data(), size ) : 0;
+
+		if( offset == VK_WHOLE_SIZE )
+			return;
+
+		if( size ){
+			VkBufferCopy region{
+				.srcOffset = offset,
+				.dstOffset = 0,
+				.size = size,
+			};
+
+			vkCmdCopyBuffer( cmd, engine.frame_staging.buffer.buffer, batch_table.buffer, 1, &region );
+		}
+
+		batches_pending = false;
+		++engine.draw_version;
+	}
+
+	if( pending.empty() )
+		return;
+
+	std::sort( pending.begin(), pending.end() );
+	pending.erase( std::unique( pending.begin(), pending.end() ), pending.end() );
+
+	//Consecutive indices become one region, capped so a run always fits a staging slice
+	constexpr uint32_t MAX_RUN = 1024;
+
+	struct Run {
+		size_t begin, end;
+		GpuInstance* dst;
+	};
+
+	std::vector<VkBufferCopy> regions;
+	std::vector<Run> runs;
+	size_t done = 0;
+
+	while( done < pending.size() ){
+		size_t end = done + 1;
+		while( end < pending.size() && end - done < MAX_RUN && pending[end] == pending[end - 1] + 1 )
+			++end;
+
+		VkDeviceSize offset;
+		GpuInstance* dst = static_cast<GpuInstance*>( engine.frame_staging.alloc(( end - done ) * sizeof( GpuInstance ), 16, offset ));
+
+		//Slice exhausted, the rest goes out next frame
+		if( !dst )
+			break;
+
+		runs.push_back( Run{ done, end, dst });
+
+		regions.push_back( VkBufferCopy{
+				.srcOffset = offset,
+				.dstOffset = pending[done] * sizeof( GpuInstance ),
+				.size = ( end - done ) * sizeof( GpuInstance ),
+			});
+
+		done = end;
+	}
+
+	//Staging space is claimed above in order, the runs are filled on the job system
+	engine.jobs.parallel_for( static_cast<uint32_t>( runs.size() ), 1, [&]( uint32_t first, uint32_t count ){
+			for( uint32_t r = first; r < first + count; ++r ){
+				for( size_t n = runs[r].begin; n < runs[r].end; ++n ){
+					uint32_t i = pending[n];
+
+					float local_radius = scene.local_bounds[i].w;
+
+					runs[r].dst[n - runs[r].begin] = GpuInstance{
+						.transform = scene.world[i],
+						.bounds = scene.world_bounds[i],
+						.batch = instance_batches[i],
+						.scale = local_radius > 0.0f ? scene.world_bounds[i].w / local_radius : 1.0f,
+					};
+				}
+			}
+		});
+
+	if( !regions.empty() )
+		vkCmdCopyBuffer( cmd, engine.frame_staging.buffer.buffer, instances.buffer, regions.size(), regions.data() );
+
+	pending.erase( pending.begin(), pending.begin() + done );
+}
+
+void IndirectRenderer::record_cull( VkEngine& engine, VkCommandBuffer cmd ){
+	if( !enabled || !cull_pipeline )
+		return;
+
+	//The previous frame may still read what gets overwritten here
+	VkMemoryBarrier to_transfer{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.pNext = nullptr,
+		.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+		.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+	};
+
+	vkCmdPipelineBarrier(
+			cmd, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			1, &to_transfer,
+			0, nullptr,
+			0, nullptr );
+
+	record_uploads( engine, cmd );
+
+	//Instance counts are accumulated with atomics
+	vkCmdFillBuffer( cmd, draws.buffer, 0, VK_WHOLE_SIZE, 0 );
+	vkCmdFillBuffer( cmd, engine.impostors.draw_cmd.buffer, 0, VK_WHOLE_SIZE, 0 );
+
+	VkMemoryBarrier to_compute{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.pNext = nullptr,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+	};
+
+	vkCmdPipelineBarrier(
+			cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0,
+			1, &to_compute,
+			0, nullptr,
+			0, nullptr );
+
+	//The table on the GPU does not match batches yet, draw() skips this frame
+	if( batches_pending || batches.empty() )
+		return;
+
+	GpuCullParams params{
+		.hiz_view_proj = engine.hiz.pyramid_view_proj,
+		.pyramid_size = glm::vec2{ static_cast<float>( engine.hiz.extent.width ), static_cast<float>( engine.hiz.extent.height )},
+		.instance_count = instance_count,
+		.batch_count = static_cast<uint32_t>( batches.size() ),
+		.phase = 0,
+		.pyramid_valid = engine.hiz.enabled && engine.hiz.pyramid_valid ? 1u : 0u,
+		.focal_pixels = engine.cam.focal_pixels( engine.windowExtent.height ),
+		.impostor_pixels = engine.impostors.max_pixels,
+	};
+
+	VkDescriptorSet sets[2] = { engine.get_curr_frame().global_desc, set };
+
+	vkCmdBindPipeline( cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cull_pipeline );
+	vkCmdBindDescriptorSets( cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cull_layout, 0, 2, sets, 0, nullptr );
+
+	vkCmdPushConstants( cmd, cull_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( GpuCullParams ), &params );
+	vkCmdDispatch( cmd, ( instance_count + 63 ) / 64, 1, 1 );
+
+	VkMemoryBarrier counted{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.pNext = nullptr,
+		.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+	};
+
+	vkCmdPipelineBarrier(
+			cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+			1, &counted,
+			0, nullptr,
+			0, nullptr );
+
+	params.phase = 1;
+
+	//The first invocation also finishes the impostor draw
+	vkCmdPushConstants( cmd, cull_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( GpuCullParams ), &params );
+	vkCmdDispatch( cmd, ( params.batch_count + 63 ) / 64, 1, 1 );
+}
+
+void IndirectRenderer::draw( VkEngine& engine, VkCommandBuffer cmd ){
+	if( !enabled || draw_pipelines.empty() || !cull_pipeline || batches_pending )
+		return;
+
+	//The sets stay bound across the permutations, they share draw_layout
+	vkCmdBindDescriptorSets( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, draw_layout, 0, 1, &engine.get_curr_frame().global_desc, 0, nullptr );
+	vkCmdBindDescriptorSets( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, draw_layout, 2, 1, &set, 0, nullptr );
+
+	Handle<Material> last_mat{};
+	VkPipeline last_pipeline{ VK_NULL_HANDLE };
+
+	for( size_t b = 0; b < batches.size(); ++b ){
+		const Batch& batch = batches[b];
+
+		//Stale handles, the asset was unloaded
+		Material* mat = engine.materials.get( batch.mat );
+		Mesh* mesh = engine.meshes.get( batch.mesh );
+
+		if( !mat || !mesh )
+			continue;
+
+		//Every permutation in use was built by rebuild_batches
+		auto pipe = draw_pipelines.find( mat->features );
+		if( pipe == draw_pipelines.end() || !pipe->second )
+			continue;
+
+		if( pipe->second != last_pipeline ){
+			last_pipeline = pipe->second;
+			vkCmdBindPipeline( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, last_pipeline );
+		}
+
+		if( batch.mat != last_mat ){
+			last_mat = batch.mat;
+
+			if( mat->tex_set )
+				vkCmdBindDescriptorSets( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, draw_layout, 1, 1, &mat->tex_set, 0, nullptr );
+		}
+
+		//Count is the last level with visible instances plus one
+		vkCmdDrawIndirectCount(
+				cmd,
+				draws.buffer, b * MAX_MESH_LODS * sizeof( VkDrawIndirectCommand ),
+				draws.buffer, COUNTS_OFFSET + b * sizeof( uint32_t ),
+				MAX_MESH_LODS, sizeof( VkDrawIndirectCommand ));
+	}
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "VkTypes.hpp"
+#include "VkSlotMap.hpp"
+#include "VkMesh.hpp"
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+struct VkEngine;
+struct Material;
+
+//Layout matches the Instances buffer in indirect_cull.comp and indirect.vert
+struct GpuInstance {
+	glm::mat4 transform;
+	glm::vec4 bounds;		//World space, xyz center, w radius
+	uint32_t batch;			//NO_BATCH for entities that are never drawn
+	float scale;			//World over object space size, for the level of detail error
+	uint32_t pad[2];
+};
+
+//Every instance of one mesh and material. Visible ones are compacted per level of detail to first + lod * capacity
+struct GpuBatch {
+	uint32_t first;
+	uint32_t capacity;
+	uint32_t lod_count;
+	uint32_t impostor;			//ImpostorAtlas slot, NO_SLOT without one
+	glm::uvec4 lod_first_vertex;
+	glm::uvec4 lod_vertex_count;
+	glm::vec4 lod_error;
+	glm::vec4 impostor_sphere;	//Object space sphere the slot was baked around
+};
+
+struct GpuCullParams {
+	glm::mat4 hiz_view_proj;	//Camera the Hi-Z pyramid was built with
+	glm::vec2 pyramid_size;
+	uint32_t instance_count;
+	uint32_t batch_count;
+	uint32_t phase;				//0 cull instances, 1 write draw counts
+	uint32_t pyramid_valid;
+	float focal_pixels;			//StrategyCamera::focal_pixels
+	float impostor_pixels;		//ImpostorAtlas::max_pixels
+	uint32_t pad[2];
+};
+
+/*
+ * GPU driven path for the entities of the SceneStore. Transforms and bounds
+ * are mirrored in a storage buffer, only entities that moved are uploaded.
+ * A compute pass culls all of them against the frustum of GpuCamData and the
+ * Hi-Z pyramid, picks a level of detail with the same rule as select_lod()
+ * (the previous level per instance stays on the GPU), compacts the visible
+ * ones per batch and level and writes MAX_MESH_LODS VkDrawIndirectCommands
+ * plus a draw count per batch. Instances of batches with a baked impostor
+ * that cover less than ImpostorAtlas::max_pixels go to its list instead.
+ *
+ * The CPU records one vkCmdDrawIndirectCount per batch (a mesh and material
+ * pair), independent of how many entities there are or how many are visible.
+ */
+struct IndirectRenderer {
+	constexpr static uint32_t MAX_INSTANCES = 65536;
+	constexpr static uint32_t MAX_BATCHES = 4096;
+	constexpr static uint32_t NO_BATCH = UINT32_MAX;
+
+	//Off falls back to CPU culling and draw_objects
+	bool enabled{ true };
+
+	//MAX_MESH_LODS draw commands per batch, then one count per batch at COUNTS_OFFSET
+	AllocatedBuffer draws{};
+	constexpr static VkDeviceSize COUNTS_OFFSET = MAX_BATCHES * MAX_MESH_LODS * sizeof( VkDrawIndirectCommand );
+	//Compacted instance indices, read by the vertex shader
+	AllocatedBuffer visible{};
+
+	//Pipeline for the main render pass
+	void init( VkEngine& engine, VkRenderPass pass );
+
+	//Picks up moved entities and rebuilds the batches if the scene layout changed. After update_transforms()
+	void update( VkEngine& engine );
+
+	//Compute pass before the main pass
+	void record_cull( VkEngine& engine, VkCommandBuffer cmd );
+	void draw( VkEngine& engine, VkCommandBuffer cmd );
+
+	private:
+		struct Batch {
+			Handle<Mesh> mesh;
+			Handle<Material> mat;
+			uint32_t first;
+			uint32_t count;
+		};
+
+		std::vector<Batch> batches;
+		std::vector<uint32_t> instance_batches;
+
+		//Dense indices still to upload, spread over frames if they exceed the staging slice
+		std::vector<uint32_t> pending;
+		bool batches_pending{ false };
+		//enabled as of the last update()
+		bool was_enabled{ true };
+		uint32_t instance_count{ 0 };
+		//ImpostorAtlas::version the batch table was built with
+		uint32_t impostor_version{ 0 };
+
+		AllocatedBuffer instances{};
+		AllocatedBuffer batch_table{};
+		//Level of detail per instance in the last frame it was visible
+		AllocatedBuffer instance_lods{};
+
+		VkDescriptorSetLayout set_layout{ VK_NULL_HANDLE };
+		VkDescriptorSet set{ VK_NULL_HANDLE };
+
+		VkPipelineLayout cull_layout{ VK_NULL_HANDLE };
+		VkPipeline cull_pipeline{ VK_NULL_HANDLE };
+		VkPipelineLayout draw_layout{ VK_NULL_HANDLE };
+		//Per MaterialFeatures mask of the batches' materials
+		std::unordered_map<uint32_t, VkPipeline> draw_pipelines;
+		VkShaderModule draw_vert{ VK_NULL_HANDLE };
+		VkShaderModule draw_frag{ VK_NULL_HANDLE };
+		VkRenderPass draw_pass{ VK_NULL_HANDLE };
+
+		//Built the first time a batch needs the permutation, VK_NULL_HANDLE if the shaders did not load
+		VkPipeline draw_pipeline( VkEngine& engine, uint32_t features );
+		void rebuild_batches( VkEngine& engine );
+		void record_uploads( VkEngine& engine, VkCommandBuffer cmd );
+};
@@ -0,0 +1,163 @@
+#include "Core/VkLights.hpp"
+
+#include "Core/VkEngine.hpp"
+#include "Core/VkInit.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+Handle<PointLight> ClusteredLights::add_light( const PointLight& light ){
+	return lights.insert( light );
+}
+
+PointLight* ClusteredLights::get_light( Handle<PointLight> light ){
+	return lights.get( light );
+}
+
+void ClusteredLights::remove_light( Handle<PointLight> light ){
+	lights.remove( light );
+}
+
+void ClusteredLights::init( VkEngine& engine ){
+	VkDevice dev = engine.vk_device;
+
+	clusters = engine.create_buffer(
+			( CLUSTER_COUNT + CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER ) * sizeof( uint32_t ),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VMA_MEMORY_USAGE_GPU_ONLY );
+
+	engine.deletion_queue.push( clusters );
+
+	//The light list is rewritten every frame, one copy per frame in flight
+	frames.resize( engine.frames.size() );
+	for( size_t i = 0; i < frames.size(); ++i ){
+		auto& fr = frames[i];
+
+		VkBufferCreateInfo buf_cr_inf{
+			.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+			.pNext = nullptr,
+			.size = sizeof( LightHeader ) + MAX_LIGHTS * sizeof( PointLight ),
+			.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		};
+
+		VmaAllocationCreateInfo mapped_alloc{
+			.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT,
+			.usage = VMA_MEMORY_USAGE_CPU_TO_GPU,
+		};
+
+		VmaAllocationInfo alloc_inf;
+		VK_CHECK( vmaCreateBuffer( engine.vma_alloc, &buf_cr_inf, &mapped_alloc, &fr.lights.buffer, &fr.lights.allocation, &alloc_inf ));
+		fr.mapped = alloc_inf.pMappedData;
+
+		engine.deletion_queue.push( fr.lights );
+
+		VkDescriptorBufferInfo lights_inf{
+			.buffer = fr.lights.buffer,
+			.offset = 0,
+			.range = VK_WHOLE_SIZE,
+		};
+
+		VkDescriptorBufferInfo clusters_inf{
+			.buffer = clusters.buffer,
+			.offset = 0,
+			.range = VK_WHOLE_SIZE,
+		};
+
+		VkWriteDescriptorSet writes[2]{
+			{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.pNext = nullptr,
+				.dstSet = engine.frames[i].global_desc,
+				.dstBinding = 1,
+				.descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.pBufferInfo = &lights_inf,
+			},
+			{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.pNext = nullptr,
+				.dstSet = engine.frames[i].global_desc,
+				.dstBinding = 2,
+				.descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+				.pBufferInfo = &clusters_inf,
+			},
+		};
+
+		vkUpdateDescriptorSets( dev, 2, writes, 0, nullptr );
+	}
+
+	VkShaderModule cull_comp{};
+	if( !engine.vk_load_shader( FILE_PREFIX "shader/light_cull.comp.spv", &cull_comp )){
+		std::cout << "Failed to load light culling shader" << std::endl;
+	}
+
+	VkPushConstantRange push_constant{
+		.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		.offset = 0,
+		.size = sizeof( glm::mat4 ),
+	};
+
+	auto pipe_lay_cr_inf = vkinit::pipeline_layout();
+	pipe_lay_cr_inf.setLayoutCount = 1;
+	pipe_lay_cr_inf.pSetLayouts = &engine.global_desc_layout;
+	pipe_lay_cr_inf.pushConstantRangeCount = 1;
+	pipe_lay_cr_inf.pPushConstantRanges = &push_constant;
+
+	VK_CHECK( vkCreatePipelineLayout( dev, &pipe_lay_cr_inf, nullptr, &cull_layout ));
+
+	VkComputePipelineCreateInfo pipe_cr_inf{
+		.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+		.pNext = nullptr,
+		.stage = vkinit::shader_stage_create_info( VK_SHADER_STAGE_COMPUTE_BIT, cull_comp ),
+		.layout = cull_layout,
+	};
+
+	if( vkCreateComputePipelines( dev, VK_NULL_HANDLE, 1, &pipe_cr_inf, nullptr, &cull_pipeline ) != VK_SUCCESS ){
+		std::cout << "Could not create light culling pipeline" << std::endl;
+		cull_pipeline = VK_NULL_HANDLE;
+	}
+
+	vkDestroyShaderModule( dev, cull_comp, nullptr );
+
+	engine.deletion_queue.push( cull_pipeline );
+	engine.deletion_queue.push( cull_layout );
+}
+
+void ClusteredLights::record_cull( VkEngine& engine, VkCommandBuffer cmd ){
+	FrameResources& fr = frames.get( engine.frameNumber );
+
+	uint32_t count = std::min<size_t>( lights.size(), MAX_LIGHTS );
+
+	LightHeader header{
+		.screen = glm::vec4{ static_cast<float>( engine.windowExtent.width ), static_cast<float>( engine.windowExtent.height ), z_near, z_far },
+		.grid = glm::uvec4{ CLUSTERS_X, CLUSTERS_Y, CLUSTERS_Z, count },
+		.ambient = glm::vec4{ ambient, 1.0f },
+		.shadow = shadow_params,
+	};
+
+	memcpy( fr.mapped, &header, sizeof( LightHeader ));
+
+	//Culling and shading both happen in view space
+	glm::mat4 view = engine.cam.get_view();
+	PointLight* dst = reinterpret_cast<PointLight*>( static_cast<uint8_t*>( fr.mapped ) + sizeof( LightHeader ));
+
+	for( uint32_t i = 0; i < count; ++i ){
+		dst[i] = lights.data[i];
+		dst[i].pos = glm::vec3{ view * glm::vec4{ lights.data[i].pos, 1.0f }};
+	}
+
+	if( !cull_pipeline )
+		return;
+
+	glm::mat4 inv_proj = glm::inverse( engine.cam.get_proj() );
+
+	vkCmdBindPipeline( cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cull_pipeline );
+	vkCmdBindDescriptorSets( cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cull_layout, 0, 1, &engine.get_curr_frame().global_desc, 0, nullptr );
+	vkCmdPushConstants( cmd, cull_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof( glm::mat4 ), &inv_proj );
+
+	vkCmdDispatch( cmd, ( CLUSTER_COUNT + 63 ) / 64, 1, 1 );
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "VkTypes.hpp"
+#include "VkFrameRing.hpp"
+#include "VkSlotMap.hpp"
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <vector>
+
+struct VkEngine;
+
+//World space. Layout matches the Lights buffer in light_cull.comp and triangle.frag
+struct PointLight {
+	glm::vec3 pos;
+	float radius;
+	glm::vec3 color;
+	float intensity;
+	int32_t shadow_slot{ -1 };		//Set by ShadowAtlas
+	float pad[3]{};
+};
+
+struct LightHeader {
+	glm::vec4 screen;		//xy framebuffer size, z cluster near, w cluster far
+	glm::uvec4 grid;		//xyz cluster counts, w light count
+	glm::vec4 ambient;
+	glm::vec4 shadow;		//x face size, y slots per row, zw atlas size
+};
+
+/*
+ * Clustered forward lighting. The view frustum is split into
+ * CLUSTERS_X x CLUSTERS_Y tiles and CLUSTERS_Z exponential depth slices. Every
+ * frame a compute pass lists the lights touching each cluster, fragments then
+ * only loop over the list of the cluster they fall into.
+ * Lights and cluster lists are bindings 1 and 2 of the global descriptor set.
+ */
+struct ClusteredLights {
+	constexpr static uint32_t CLUSTERS_X = 16;
+	constexpr static uint32_t CLUSTERS_Y = 9;
+	constexpr static uint32_t CLUSTERS_Z = 24;
+	constexpr static uint32_t CLUSTER_COUNT = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+
+	constexpr static uint32_t MAX_LIGHTS = 1024;
+	//Keep in sync with MAX_LIGHTS_PER_CLUSTER in light_cull.comp and triangle.frag
+	constexpr static uint32_t MAX_LIGHTS_PER_CLUSTER = 128;
+
+	//Depth range that is sliced, closer fragments use the first slice
+	float z_near{ 0.1f };
+	float z_far{ 200.0f };
+	glm::vec3 ambient{ 0.25f };
+	//Atlas layout passed on to the shaders, set by ShadowAtlas
+	glm::vec4 shadow_params{};
+
+	SlotMap<PointLight> lights;
+
+	Handle<PointLight> add_light( const PointLight& light );
+	//nullptr for removed lights, changes are picked up next frame
+	PointLight* get_light( Handle<PointLight> light );
+	void remove_light( Handle<PointLight> light );
+
+	//Per cluster: count in the first CLUSTER_COUNT uints, then MAX_LIGHTS_PER_CLUSTER indices each
+	AllocatedBuffer clusters{};
+
+	//Writes bindings 1 and 2 of every frame's global descriptor set
+	void init( VkEngine& engine );
+	//Compute pass in the render graph, before the passes that shade with it
+	void record_cull( VkEngine& engine, VkCommandBuffer cmd );
+
+	private:
+		struct FrameResources {
+			AllocatedBuffer lights;
+			void* mapped;
+		};
+
+		FrameRing<FrameResources> frames;
+
+		VkPipelineLayout cull_layout{ VK_NULL_HANDLE };
+		VkPipeline cull_pipeline{ VK_NULL_HANDLE };
+};
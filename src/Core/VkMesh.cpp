@@ -1,6 +1,14 @@
 #include "VkMesh.hpp"
 #include <vulkan/vulkan_core.h>
 
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <queue>
+
 VertexInputDescription Vertex::get_vk_description(){
 	VertexInputDescription desc;
 
@@ -40,3 +48,307 @@ VertexInputDescription Vertex::get_vk_description(){
 
 	return desc;
 }
+
+namespace {
+	//Symmetric 4x4 matrix, sum of squared distances to a set of planes
+	struct Quadric {
+		double a[10]{};
+
+		static Quadric plane( const glm::vec3& n, float d, double weight ){
+			Quadric q;
+			double p[4] = { n.x, n.y, n.z, d };
+
+			for( int i = 0, k = 0; i < 4; ++i ){
+				for( int j = i; j < 4; ++j )
+					q.a[k++] = p[i] * p[j] * weight;
+			}
+
+			return q;
+		}
+
+		Quadric& operator+=( const Quadric& o ){
+			for( int i = 0; i < 10; ++i )
+				a[i] += o.a[i];
+			return *this;
+		}
+
+		double eval( const glm::vec3& p ) const {
+			double x = p.x, y = p.y, z = p.z;
+
+			return a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z + 2 * a[3] * x
+				+ a[4] * y * y + 2 * a[5] * y * z + 2 * a[6] * y
+				+ a[7] * z * z + 2 * a[8] * z
+				+ a[9];
+		}
+	};
+
+	struct Collapse {
+		double cost;
+		uint32_t keep, remove;
+		uint32_t keep_stamp, remove_stamp;
+
+		bool operator>( const Collapse& o ) const { return cost > o.cost; }
+	};
+
+	struct SimplifiedLod {
+		std::vector<Vertex> vertices;
+		float error;
+	};
+
+	//Open edges are kept in place by planes perpendicular to their triangle
+	constexpr double BOUNDARY_WEIGHT = 10.0;
+
+	/*
+	 * Greedy edge collapse of a triangle soup (Garland and Heckbert). Corners
+	 * are welded by position, a collapse moves one vertex onto the other, so
+	 * every corner keeps its own normal, color and uvs. Each target triangle
+	 * count produces one snapshot, until no collapse is left that does not
+	 * flip a triangle.
+	 */
+	std::vector<SimplifiedLod> simplify( const std::vector<Vertex>& soup, const std::vector<size_t>& targets ){
+		size_t tri_count = soup.size() / 3;
+
+		std::vector<glm::vec3> pos;
+		std::vector<std::array<uint32_t, 3>> tris( tri_count );
+
+		std::map<std::array<float, 3>, uint32_t> welded;
+		for( size_t c = 0; c < tri_count * 3; ++c ){
+			const glm::vec3& p = soup[c].pos;
+			auto [it, added] = welded.try_emplace( std::array<float, 3>{ p.x, p.y, p.z }, static_cast<uint32_t>( pos.size() ));
+
+			if( added )
+				pos.push_back( p );
+
+			tris[c / 3][c % 3] = it->second;
+		}
+
+		std::vector<bool> tri_alive( tri_count, true );
+		std::vector<std::vector<uint32_t>> vertex_tris( pos.size() );
+		std::vector<Quadric> quadrics( pos.size() );
+		std::map<std::pair<uint32_t, uint32_t>, uint32_t> edge_use;
+
+		size_t alive = 0;
+
+		for( uint32_t t = 0; t < tri_count; ++t ){
+			auto& v = tris[t];
+
+			glm::vec3 n = glm::cross( pos[v[1]] - pos[v[0]], pos[v[2]] - pos[v[0]] );
+			float len = glm::length( n );
+
+			if( v[0] == v[1] || v[1] == v[2] || v[0] == v[2] || len == 0.0f ){
+				tri_alive[t] = false;
+				continue;
+			}
+
+			n /= len;
+			Quadric q = Quadric::plane( n, -glm::dot( n, pos[v[0]] ), 1.0 );
+
+			for( int j = 0; j < 3; ++j ){
+				quadrics[v[j]] += q;
+				vertex_tris[v[j]].push_back( t );
+				++edge_use[std::minmax( v[j], v[( j + 1 ) % 3] )];
+			}
+
+			++alive;
+		}
+
+		for( uint32_t t = 0; t < tri_count; ++t ){
+			if( !tri_alive[t] )
+				continue;
+
+			auto& v = tris[t];
+			glm::vec3 n = glm::normalize( glm::cross( pos[v[1]] - pos[v[0]], pos[v[2]] - pos[v[0]] ));
+
+			for( int j = 0; j < 3; ++j ){
+				uint32_t a = v[j], b = v[( j + 1 ) % 3];
+				if( edge_use[std::minmax( a, b )] != 1 )
+					continue;
+
+				glm::vec3 edge = pos[b] - pos[a];
+				glm::vec3 m = glm::normalize( glm::cross( edge, n ));
+				Quadric q = Quadric::plane( m, -glm::dot( m, pos[a] ), BOUNDARY_WEIGHT * glm::dot( edge, edge ));
+
+				quadrics[a] += q;
+				quadrics[b] += q;
+			}
+		}
+
+		std::vector<uint32_t> stamps( pos.size(), 0 );
+		std::vector<bool> removed( pos.size(), false );
+		std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+
+		auto push = [&]( uint32_t a, uint32_t b ){
+			Quadric q = quadrics[a];
+			q += quadrics[b];
+
+			double cost_a = std::max( q.eval( pos[a] ), 0.0 );
+			double cost_b = std::max( q.eval( pos[b] ), 0.0 );
+
+			if( cost_a <= cost_b )
+				heap.push( Collapse{ cost_a, a, b, stamps[a], stamps[b] });
+			else
+				heap.push( Collapse{ cost_b, b, a, stamps[b], stamps[a] });
+		};
+
+		for( uint32_t t = 0; t < tri_count; ++t ){
+			if( !tri_alive[t] )
+				continue;
+
+			for( int j = 0; j < 3; ++j ){
+				if( tris[t][j] < tris[t][( j + 1 ) % 3] )
+					push( tris[t][j], tris[t][( j + 1 ) % 3] );
+			}
+		}
+
+		auto snapshot = [&]( double error ){
+			SimplifiedLod lod{ .error = static_cast<float>( std::sqrt( error )) };
+			lod.vertices.reserve( alive * 3 );
+
+			for( uint32_t t = 0; t < tri_count; ++t ){
+				if( !tri_alive[t] )
+					continue;
+
+				for( int j = 0; j < 3; ++j ){
+					Vertex v = soup[t * 3 + j];
+					v.pos = pos[tris[t][j]];
+					lod.vertices.push_back( v );
+				}
+			}
+
+			return lod;
+		};
+
+		std::vector<SimplifiedLod> result;
+		double max_error = 0.0;
+
+		for( size_t target: targets ){
+			while( alive > target && !heap.empty() ){
+				Collapse c = heap.top();
+				heap.pop();
+
+				if( removed[c.keep] || removed[c.remove] || stamps[c.keep] != c.keep_stamp || stamps[c.remove] != c.remove_stamp )
+					continue;
+
+				//Moving remove onto keep must not turn any remaining triangle around
+				bool flips = false;
+				for( auto t: vertex_tris[c.remove] ){
+					auto& v = tris[t];
+					if( !tri_alive[t] || v[0] == c.keep || v[1] == c.keep || v[2] == c.keep )
+						continue;
+
+					std::array<glm::vec3, 3> p;
+					for( int j = 0; j < 3; ++j )
+						p[j] = pos[v[j] == c.remove ? c.keep : v[j]];
+
+					glm::vec3 before = glm::cross( pos[v[1]] - pos[v[0]], pos[v[2]] - pos[v[0]] );
+					glm::vec3 after = glm::cross( p[1] - p[0], p[2] - p[0] );
+
+					if( glm::dot( before, after ) <= 0.0f ){
+						flips = true;
+						break;
+					}
+				}
+
+				if( flips )
+					continue;
+
+				for( auto t: vertex_tris[c.remove] ){
+					auto& v = tris[t];
+					if( !tri_alive[t] )
+						continue;
+
+					if( v[0] == c.keep || v[1] == c.keep || v[2] == c.keep ){
+						tri_alive[t] = false;
+						--alive;
+						continue;
+					}
+
+					for( auto& corner: v ){
+						if( corner == c.remove )
+							corner = c.keep;
+					}
+
+					vertex_tris[c.keep].push_back( t );
+				}
+
+				quadrics[c.keep] += quadrics[c.remove];
+				removed[c.remove] = true;
+				vertex_tris[c.remove].clear();
+				++stamps[c.keep];
+				max_error = std::max( max_error, c.cost );
+
+				//Drop dead triangles so the adjacency of long lived vertices stays short
+				auto& kt = vertex_tris[c.keep];
+				kt.erase( std::remove_if( kt.begin(), kt.end(), [&]( uint32_t t ){ return !tri_alive[t]; }), kt.end() );
+
+				for( auto t: kt ){
+					for( auto other: tris[t] ){
+						if( other != c.keep )
+							push( c.keep, other );
+					}
+				}
+			}
+
+			if( alive > target )
+				break;
+
+			result.push_back( snapshot( max_error ));
+		}
+
+		return result;
+	}
+}
+
+void generate_lods( Mesh& mesh ){
+	//Never simplify a mesh below this, the savings would not pay for the extra state
+	constexpr size_t MIN_LOD_TRIANGLES = 16;
+
+	mesh.vertices.resize( mesh.lods.empty() ? mesh.vertices.size() : mesh.lods[0].vertex_count );
+	mesh.lods.assign( 1, MeshLod{
+			.first_vertex = 0,
+			.vertex_count = static_cast<uint32_t>( mesh.vertices.size() ),
+			.error = 0.0f,
+		});
+
+	size_t tri_count = mesh.vertices.size() / 3;
+
+	std::vector<size_t> targets;
+	for( size_t t = tri_count / 2; t >= MIN_LOD_TRIANGLES && targets.size() + 1 < MAX_MESH_LODS; t /= 2 )
+		targets.push_back( t );
+
+	if( targets.empty() )
+		return;
+
+	auto levels = simplify( mesh.vertices, targets );
+
+	for( auto& level: levels ){
+		//Less than 10% fewer triangles is not worth a level
+		if( level.vertices.size() * 10 > mesh.lods.back().vertex_count * 9 )
+			break;
+
+		mesh.lods.push_back( MeshLod{
+				.first_vertex = static_cast<uint32_t>( mesh.vertices.size() ),
+				.vertex_count = static_cast<uint32_t>( level.vertices.size() ),
+				.error = level.error,
+			});
+
+		mesh.vertices.insert( mesh.vertices.end(), level.vertices.begin(), level.vertices.end() );
+	}
+}
+
+uint32_t select_lod( const Mesh& mesh, float pixels_per_unit, uint32_t current ){
+	if( mesh.lods.empty() )
+		return 0;
+
+	current = std::min<uint32_t>( current, mesh.lods.size() - 1 );
+
+	//Finer as soon as the current level is off by more than the limit
+	while( current > 0 && mesh.lods[current].error * pixels_per_unit > LOD_ERROR_PIXELS )
+		--current;
+
+	//Coarser only once the next level is well below it
+	while( current + 1 < mesh.lods.size() && mesh.lods[current + 1].error * pixels_per_unit < LOD_ERROR_PIXELS * LOD_HYSTERESIS )
+		++current;
+
+	return current;
+}
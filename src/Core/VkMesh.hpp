@@ -6,6 +6,7 @@
 #include <glm/vec4.hpp>
 #include <glm/mat4x4.hpp>
 
+#include <cstdint>
 #include <vector>
 #include <vulkan/vulkan_core.h>
 
@@ -25,12 +26,41 @@ struct Vertex {
 	static VertexInputDescription get_vk_description();
 };
 
+//Shaders that pull vertices read them as this many packed floats, see triangle.vert
+constexpr uint32_t VERTEX_FLOATS = 13;
+static_assert( sizeof( Vertex ) == VERTEX_FLOATS * sizeof( float ));
+
 struct PushConstants {
 	glm::vec4 data;
 	glm::mat4 camera;
 };
 
+//Range of Mesh::vertices drawn for one level of detail
+struct MeshLod {
+	uint32_t first_vertex;
+	uint32_t vertex_count;
+	float error;			//Estimated object space distance to the full mesh
+};
+
+//Keep in sync with MAX_LODS in indirect_cull.comp
+constexpr uint32_t MAX_MESH_LODS = 4;
+//Coarser levels are used while their error stays below this many pixels
+constexpr float LOD_ERROR_PIXELS = 1.0f;
+//Switching to a coarser level needs the error this far below the limit, so levels do not flicker
+constexpr float LOD_HYSTERESIS = 0.75f;
+
 struct Mesh {
+	//Every level of detail back to back, lods[0] is the full mesh
 	std::vector<Vertex> vertices;
-	AllocatedBuffer buffer;
+	std::vector<MeshLod> lods;
+
+	//Range in the geometry arena, draws add base_vertex to a level's first_vertex
+	uint32_t base_vertex{ 0 };
+	uint32_t vertex_count{ 0 };
 };
+
+//Appends quadric simplified levels at 1/2, 1/4 and 1/8 of the triangles, called by upload_mesh
+void generate_lods( Mesh& mesh );
+
+//pixels_per_unit is the projected size of one object space unit, current the level used last frame
+uint32_t select_lod( const Mesh& mesh, float pixels_per_unit, uint32_t current );
@@ -0,0 +1,473 @@
+#include "Core/VkOverlay.hpp"
+
+#include "Core/VkEngine.hpp"
+#include "Core/VkInit.hpp"
+#include "Core/VkOverlayFont.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+static uint32_t pack_color( glm::vec4 color ){
+	glm::vec4 c = glm::clamp( color, 0.0f, 1.0f ) * 255.0f + 0.5f;
+
+	return static_cast<uint32_t>( c.x ) | static_cast<uint32_t>( c.y ) << 8 | static_cast<uint32_t>( c.z ) << 16 | static_cast<uint32_t>( c.w ) << 24;
+}
+
+//Texel rectangle of a glyph cell without its border, in atlas uvs
+static void cell_uv( uint32_t cell, glm::vec2& uv_min, glm::vec2& uv_max ){
+	glm::vec2 atlas_size{ static_cast<float>( OverlayRenderer::ATLAS_WIDTH ), static_cast<float>( OverlayRenderer::ATLAS_HEIGHT )};
+	glm::vec2 origin{
+		static_cast<float>(( cell % OverlayRenderer::ATLAS_COLUMNS ) * OverlayRenderer::CELL_WIDTH + 1 ),
+		static_cast<float>(( cell / OverlayRenderer::ATLAS_COLUMNS ) * OverlayRenderer::CELL_HEIGHT + 1 ),
+	};
+
+	uv_min = origin / atlas_size;
+	uv_max = ( origin + glm::vec2{ static_cast<float>( OVERLAY_FONT_WIDTH ), static_cast<float>( OVERLAY_FONT_HEIGHT )}) / atlas_size;
+}
+
+//Centre of the white cell, every sample in it is opaque white
+static glm::vec2 white_uv(){
+	glm::vec2 uv_min, uv_max;
+	cell_uv( OVERLAY_FONT_COUNT, uv_min, uv_max );
+
+	return ( uv_min + uv_max ) * 0.5f;
+}
+
+void OverlayRenderer::push( const glm::vec2 pos[4], glm::vec2 uv_min, glm::vec2 uv_max, uint32_t color, Handle<Texture> texture ){
+	if( quads.size() >= MAX_QUADS )
+		return;
+
+	quads.push_back( OverlayQuad{
+			.pos = { pos[0], pos[1], pos[2], pos[3] },
+			.uv = { uv_min, { uv_max.x, uv_min.y }, uv_max, { uv_min.x, uv_max.y }},
+			.color = color,
+			.layer = layer,
+			.texture = texture,
+		});
+}
+
+void OverlayRenderer::rect( glm::vec2 min, glm::vec2 max, glm::vec4 color ){
+	glm::vec2 pos[4] = { min, { max.x, min.y }, max, { min.x, max.y }};
+	glm::vec2 uv = white_uv();
+
+	push( pos, uv, uv, pack_color( color ), {} );
+}
+
+void OverlayRenderer::quad( glm::vec2 min, glm::vec2 max, Handle<Texture> texture, glm::vec4 color, glm::vec2 uv_min, glm::vec2 uv_max ){
+	glm::vec2 pos[4] = { min, { max.x, min.y }, max, { min.x, max.y }};
+
+	push( pos, uv_min, uv_max, pack_color( color ), texture );
+}
+
+void OverlayRenderer::line( glm::vec2 a, glm::vec2 b, float width, glm::vec4 color ){
+	glm::vec2 d = b - a;
+	float len = glm::length( d );
+
+	if( len <= 0.0f )
+		return;
+
+	glm::vec2 n = glm::vec2{ -d.y, d.x } / len * ( width * 0.5f );
+	glm::vec2 pos[4] = { a + n, b + n, b - n, a - n };
+	glm::vec2 uv = white_uv();
+
+	push( pos, uv, uv, pack_color( color ), {} );
+}
+
+void OverlayRenderer::ring( glm::vec2 center, float radius, float width, glm::vec4 color, uint32_t segments ){
+	uint32_t packed = pack_color( color );
+	glm::vec2 uv = white_uv();
+
+	float inner = std::max( radius - width * 0.5f, 0.0f );
+	float outer = radius + width * 0.5f;
+
+	for( uint32_t s = 0; s < segments; ++s ){
+		float a0 = 2.0f * static_cast<float>( M_PI ) * s / segments;
+		float a1 = 2.0f * static_cast<float>( M_PI ) * ( s + 1 ) / segments;
+
+		glm::vec2 d0{ std::cos( a0 ), std::sin( a0 )};
+		glm::vec2 d1{ std::cos( a1 ), std::sin( a1 )};
+
+		glm::vec2 pos[4] = { center + d0 * outer, center + d1 * outer, center + d1 * inner, center + d0 * inner };
+		push( pos, uv, uv, packed, {} );
+	}
+}
+
+glm::vec2 OverlayRenderer::text( glm::vec2 pos, std::string_view str, glm::vec4 color, float scale ){
+	uint32_t packed = pack_color( color );
+	glm::vec2 glyph = glm::vec2{ static_cast<float>( OVERLAY_FONT_WIDTH ), static_cast<float>( OVERLAY_FONT_HEIGHT )} * scale;
+	glm::vec2 pen = pos;
+
+	for( char c: str ){
+		if( c == '\n' ){
+			pen = glm::vec2{ pos.x, pen.y + glyph.y };
+			continue;
+		}
+
+		uint32_t code = static_cast<unsigned char>( c );
+
+		//Unknown characters show up as '?', spaces only advance
+		if( code < OVERLAY_FONT_FIRST || code >= OVERLAY_FONT_FIRST + OVERLAY_FONT_COUNT )
+			code = '?';
+
+		if( code != ' ' ){
+			glm::vec2 uv_min, uv_max;
+			cell_uv( code - OVERLAY_FONT_FIRST, uv_min, uv_max );
+
+			glm::vec2 corners[4] = { pen, { pen.x + glyph.x, pen.y }, pen + glyph, { pen.x, pen.y + glyph.y }};
+			push( corners, uv_min, uv_max, packed, {} );
+		}
+
+		pen.x += glyph.x;
+	}
+
+	return text_size( str, scale );
+}
+
+glm::vec2 OverlayRenderer::text_size( std::string_view str, float scale ) const {
+	uint32_t columns = 0, lines = str.empty() ? 0 : 1, current = 0;
+
+	for( char c: str ){
+		if( c == '\n' ){
+			++lines;
+			current = 0;
+			continue;
+		}
+
+		columns = std::max( columns, ++current );
+	}
+
+	return glm::vec2{ static_cast<float>( columns * OVERLAY_FONT_WIDTH ), static_cast<float>( lines * OVERLAY_FONT_HEIGHT )} * scale;
+}
+
+bool OverlayRenderer::project( const glm::mat4& view_proj, VkExtent2D extent, glm::vec3 world, glm::vec2& screen ){
+	glm::vec4 clip = view_proj * glm::vec4{ world, 1.0f };
+
+	if( clip.w <= 0.0f )
+		return false;
+
+	//Projections here flip y, so ndc y -1 is the top of the screen like pixel rows
+	glm::vec2 ndc = glm::vec2{ clip } / clip.w;
+	screen = ( ndc * 0.5f + 0.5f ) * glm::vec2{ static_cast<float>( extent.width ), static_cast<float>( extent.height )};
+
+	return true;
+}
+
+void OverlayRenderer::init( VkEngine& engine, VkRenderPass pass ){
+	VkDevice dev = engine.vk_device;
+
+	//Glyph atlas, white with the coverage in alpha
+	std::vector<uint32_t> pixels( ATLAS_WIDTH * ATLAS_HEIGHT, 0x00ffffffu );
+
+	for( uint32_t g = 0; g <= OVERLAY_FONT_COUNT; ++g ){
+		uint32_t x0 = ( g % ATLAS_COLUMNS ) * CELL_WIDTH;
+		uint32_t y0 = ( g / ATLAS_COLUMNS ) * CELL_HEIGHT;
+
+		for( uint32_t y = 0; y < CELL_HEIGHT; ++y ){
+			for( uint32_t x = 0; x < CELL_WIDTH; ++x ){
+				bool inside = x >= 1 && x <= OVERLAY_FONT_WIDTH && y >= 1 && y <= OVERLAY_FONT_HEIGHT;
+
+				//The white cell is filled including its border, so filtering never reaches a transparent texel
+				bool covered = g == OVERLAY_FONT_COUNT || ( inside && ( OVERLAY_FONT[g][y - 1] >> ( x - 1 )) & 1 );
+
+				if( covered )
+					pixels[( y0 + y ) * ATLAS_WIDTH + x0 + x] = 0xffffffffu;
+			}
+		}
+	}
+
+	VkDeviceSize data_size = pixels.size() * sizeof( uint32_t );
+	AllocatedBuffer staging = engine.create_buffer( data_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY );
+
+	void* data;
+	vmaMapMemory( engine.vma_alloc, staging.allocation, &data );
+	memcpy( data, pixels.data(), data_size );
+	vmaUnmapMemory( engine.vma_alloc, staging.allocation );
+
+	VkExtent3D atlas_size{ ATLAS_WIDTH, ATLAS_HEIGHT, 1 };
+
+	VmaAllocationCreateInfo img_alloc{
+		.usage = VMA_MEMORY_USAGE_GPU_ONLY,
+	};
+
+	auto atlas_cr_inf = vkinit::image_create_info( VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, atlas_size );
+	VK_CHECK( vmaCreateImage( engine.vma_alloc, &atlas_cr_inf, &img_alloc, &atlas.image, &atlas.allocation, nullptr ));
+
+	engine.immediate_submit( [&]( VkCommandBuffer cmd ){
+			VkImageSubresourceRange range{
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.baseMipLevel = 0,
+				.levelCount = 1,
+				.baseArrayLayer = 0,
+				.layerCount = 1,
+			};
+
+			VkImageMemoryBarrier to_transfer{
+				.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+				.pNext = nullptr,
+				.srcAccessMask = 0,
+				.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+				.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+				.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.image = atlas.image,
+				.subresourceRange = range,
+			};
+
+			vkCmdPipelineBarrier(
+					cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+					0, nullptr,
+					0, nullptr,
+					1, &to_transfer );
+
+			VkBufferImageCopy img_cpy{
+				.bufferOffset = 0,
+				.bufferRowLength = 0,
+				.bufferImageHeight = 0,
+				.imageSubresource = VkImageSubresourceLayers{
+					.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+					.mipLevel = 0,
+					.baseArrayLayer = 0,
+					.layerCount = 1,
+				},
+				.imageExtent = atlas_size,
+			};
+
+			vkCmdCopyBufferToImage( cmd, staging.buffer, atlas.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &img_cpy );
+
+			VkImageMemoryBarrier to_shader = to_transfer;
+			to_shader.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			to_shader.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			to_shader.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			to_shader.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+			vkCmdPipelineBarrier(
+					cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+					0, nullptr,
+					0, nullptr,
+					1, &to_shader );
+		});
+
+	vmaDestroyBuffer( engine.vma_alloc, staging.buffer, staging.allocation );
+
+	auto view_inf = vkinit::image_view_create_info( VK_FORMAT_R8G8B8A8_UNORM, atlas.image, VK_IMAGE_ASPECT_COLOR_BIT );
+	VK_CHECK( vkCreateImageView( dev, &view_inf, nullptr, &atlas_view ));
+
+	auto sampler_inf = vkinit::sampler_create_info( VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE );
+	VK_CHECK( vkCreateSampler( dev, &sampler_inf, nullptr, &sampler ));
+
+	engine.deletion_queue.push( sampler );
+	engine.deletion_queue.push( atlas_view );
+	engine.deletion_queue.push( atlas );
+
+	atlas_set = engine.descriptors.allocate( engine.single_tex_layout ).set;
+
+	VkDescriptorImageInfo atlas_inf{
+		.sampler = sampler,
+		.imageView = atlas_view,
+		.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+	};
+
+	auto atlas_write = vkinit::write_descriptor_set_image( VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, atlas_set, &atlas_inf, 0 );
+	vkUpdateDescriptorSets( dev, 1, &atlas_write, 0, nullptr );
+
+	//One mapped vertex buffer per frame in flight, six vertices per quad
+	frames.resize( engine.frames.size() );
+	for( auto& fr: frames ){
+		VkBufferCreateInfo buf_cr_inf{
+			.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+			.pNext = nullptr,
+			.size = MAX_QUADS * 6 * sizeof( OverlayVertex ),
+			.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		};
+
+		VmaAllocationCreateInfo mapped_alloc{
+			.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT,
+			.usage = VMA_MEMORY_USAGE_CPU_TO_GPU,
+		};
+
+		VmaAllocationInfo alloc_info;
+		VK_CHECK( vmaCreateBuffer( engine.vma_alloc, &buf_cr_inf, &mapped_alloc, &fr.vertices.buffer, &fr.vertices.allocation, &alloc_info ));
+		fr.mapped = alloc_info.pMappedData;
+
+		engine.deletion_queue.push( fr.vertices );
+	}
+
+	quads.reserve( MAX_QUADS );
+
+	VkShaderModule vert{}, frag{};
+
+	if( !engine.vk_load_shader( FILE_PREFIX "shader/overlay.vert.spv", &vert )){
+		std::cout << "Failed to load overlay vert shader" << std::endl;
+	}
+
+	if( !engine.vk_load_shader( FILE_PREFIX "shader/overlay.frag.spv", &frag )){
+		std::cout << "Failed to load overlay frag shader" << std::endl;
+	}
+
+	VkPushConstantRange push_constant{
+		.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+		.offset = 0,
+		.size = sizeof( glm::vec2 ),
+	};
+
+	auto pipe_lay_cr_inf = vkinit::pipeline_layout();
+	pipe_lay_cr_inf.setLayoutCount = 1;
+	pipe_lay_cr_inf.pSetLayouts = &engine.single_tex_layout;
+	pipe_lay_cr_inf.pushConstantRangeCount = 1;
+	pipe_lay_cr_inf.pPushConstantRanges = &push_constant;
+
+	VK_CHECK( vkCreatePipelineLayout( dev, &pipe_lay_cr_inf, nullptr, &layout ));
+
+	VkVertexInputBindingDescription binding{
+		.binding = 0,
+		.stride = sizeof( OverlayVertex ),
+		.inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+	};
+
+	VkVertexInputAttributeDescription attributes[3]{
+		{ .location = 0, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = offsetof( OverlayVertex, pos )},
+		{ .location = 1, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = offsetof( OverlayVertex, uv )},
+		{ .location = 2, .binding = 0, .format = VK_FORMAT_R8G8B8A8_UNORM, .offset = offsetof( OverlayVertex, color )},
+	};
+
+	PipelineBuilder pipe_builder;
+
+	pipe_builder.vertex_in_info = vkinit::vertex_input_state_create_info();
+	pipe_builder.vertex_in_info.vertexBindingDescriptionCount = 1;
+	pipe_builder.vertex_in_info.pVertexBindingDescriptions = &binding;
+	pipe_builder.vertex_in_info.vertexAttributeDescriptionCount = 3;
+	pipe_builder.vertex_in_info.pVertexAttributeDescriptions = attributes;
+
+	pipe_builder.shader_stages.push_back(
+			vkinit::shader_stage_create_info( VK_SHADER_STAGE_VERTEX_BIT, vert ));
+
+	pipe_builder.shader_stages.push_back(
+			vkinit::shader_stage_create_info( VK_SHADER_STAGE_FRAGMENT_BIT, frag ));
+
+	pipe_builder.input_assembly = vkinit::input_assembly_state_create_info( VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST );
+
+	pipe_builder.viewport.x = 0;
+	pipe_builder.viewport.y = 0;
+	pipe_builder.viewport.width = engine.windowExtent.width;
+	pipe_builder.viewport.height = engine.windowExtent.height;
+	pipe_builder.viewport.minDepth = 0;
+	pipe_builder.viewport.maxDepth = 1;
+
+	pipe_builder.scissor.offset = { 0, 0 };
+	pipe_builder.scissor.extent = engine.windowExtent;
+
+	pipe_builder.rasterizer = vkinit::rasterization_state_create_info( VK_POLYGON_MODE_FILL );
+	pipe_builder.multisample_state = vkinit::multisample_state_create_info();
+
+	pipe_builder.color_blend = vkinit::color_blend_attachment_state();
+	pipe_builder.color_blend.blendEnable = VK_TRUE;
+	pipe_builder.color_blend.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	pipe_builder.color_blend.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	pipe_builder.color_blend.colorBlendOp = VK_BLEND_OP_ADD;
+	pipe_builder.color_blend.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	pipe_builder.color_blend.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	pipe_builder.color_blend.alphaBlendOp = VK_BLEND_OP_ADD;
+
+	//On top of everything, in submission order
+	pipe_builder.depth_stencil_state = vkinit::depth_stencil_state_create_info( VK_FALSE, VK_FALSE, VK_COMPARE_OP_ALWAYS );
+	pipe_builder.pipeline_layout = layout;
+
+	pipeline = pipe_builder.build_pipeline( dev, pass );
+
+	vkDestroyShaderModule( dev, vert, nullptr );
+	vkDestroyShaderModule( dev, frag, nullptr );
+
+	engine.deletion_queue.push( pipeline );
+	engine.deletion_queue.push( layout );
+}
+
+VkDescriptorSet OverlayRenderer::texture_set( VkEngine& engine, Handle<Texture> texture ){
+	if( !texture )
+		return atlas_set;
+
+	Texture* tex = engine.textures.get( texture );
+	if( !tex )
+		return VK_NULL_HANDLE;
+
+	engine.touch_texture( texture );
+
+	auto it = texture_sets.find( texture.id );
+	if( it != texture_sets.end() )
+		return it->second;
+
+	//Written fresh every frame, so a texture that was streamed in since needs no tracking
+	VkDescriptorSet set = engine.get_curr_frame().descriptors.allocate( engine.single_tex_layout ).set;
+
+	VkDescriptorImageInfo img_inf{
+		.sampler = sampler,
+		.imageView = tex->view,
+		.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+	};
+
+	auto write = vkinit::write_descriptor_set_image( VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, set, &img_inf, 0 );
+	vkUpdateDescriptorSets( engine.vk_device, 1, &write, 0, nullptr );
+
+	texture_sets.emplace( texture.id, set );
+	return set;
+}
+
+void OverlayRenderer::draw( VkEngine& engine, VkCommandBuffer cmd ){
+	draw_count = 0;
+
+	if( quads.empty() || !pipeline ){
+		quads.clear();
+		return;
+	}
+
+	std::stable_sort( quads.begin(), quads.end(), []( const OverlayQuad& a, const OverlayQuad& b ){
+			return a.layer != b.layer ? a.layer < b.layer : a.texture.id < b.texture.id;
+		});
+
+	FrameResources& fr = frames.get( engine.frameNumber );
+	OverlayVertex* dst = static_cast<OverlayVertex*>( fr.mapped );
+
+	//Last frame's sets went back with its descriptor pools
+	texture_sets.clear();
+
+	constexpr uint32_t CORNERS[6] = { 0, 1, 2, 2, 3, 0 };
+
+	for( size_t q = 0; q < quads.size(); ++q ){
+		for( uint32_t v = 0; v < 6; ++v ){
+			uint32_t c = CORNERS[v];
+			dst[q * 6 + v] = OverlayVertex{ quads[q].pos[c], quads[q].uv[c], quads[q].color };
+		}
+	}
+
+	glm::vec2 screen{ static_cast<float>( engine.windowExtent.width ), static_cast<float>( engine.windowExtent.height )};
+
+	vkCmdBindPipeline( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline );
+	vkCmdPushConstants( cmd, layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof( glm::vec2 ), &screen );
+
+	VkDeviceSize off = 0;
+	vkCmdBindVertexBuffers( cmd, 0, 1, &fr.vertices.buffer, &off );
+
+	//One draw per run of quads with the same texture
+	size_t first = 0;
+	while( first < quads.size() ){
+		size_t end = first + 1;
+		while( end < quads.size() && quads[end].texture == quads[first].texture )
+			++end;
+
+		VkDescriptorSet set = texture_set( engine, quads[first].texture );
+
+		if( set ){
+			vkCmdBindDescriptorSets( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &set, 0, nullptr );
+			vkCmdDraw( cmd, ( end - first ) * 6, 1, first * 6, 0 );
+			++draw_count;
+		}
+
+		first = end;
+	}
+
+	quads.clear();
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "VkTypes.hpp"
+#include "VkFrameRing.hpp"
+#include "VkSlotMap.hpp"
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct VkEngine;
+struct Texture;
+
+//Layout matches the inputs of overlay.vert
+struct OverlayVertex {
+	glm::vec2 pos;			//Pixels, origin in the top left corner
+	glm::vec2 uv;
+	uint32_t color;			//RGBA8
+};
+
+struct OverlayQuad {
+	glm::vec2 pos[4];
+	glm::vec2 uv[4];
+	uint32_t color;
+	uint32_t layer;
+	Handle<Texture> texture;	//Empty for the glyph atlas, which has a white cell for untextured shapes
+};
+
+/*
+ * Screen space shapes and text drawn on top of the scene: labels, health
+ * bars, selection rings, rulers. Everything is a quad, collected during the
+ * frame and written to a persistently mapped per-frame vertex buffer when the
+ * main pass is recorded. Quads are sorted by layer, then by texture (stable,
+ * so submission order holds within a texture), and each run of one texture is
+ * a single draw. Untextured shapes and text share the glyph atlas, so they end
+ * up in the same draw.
+ */
+struct OverlayRenderer {
+	constexpr static uint32_t MAX_QUADS = 16384;
+	//Glyph cells with a one texel border, the cell after the last glyph is white
+	constexpr static uint32_t CELL_WIDTH = 10;
+	constexpr static uint32_t CELL_HEIGHT = 18;
+	constexpr static uint32_t ATLAS_COLUMNS = 16;
+	constexpr static uint32_t ATLAS_ROWS = 6;
+	constexpr static uint32_t ATLAS_WIDTH = ATLAS_COLUMNS * CELL_WIDTH;
+	constexpr static uint32_t ATLAS_HEIGHT = ATLAS_ROWS * CELL_HEIGHT;
+
+	//Later layers are drawn on top, regardless of texture
+	uint32_t layer{ 0 };
+
+	//Draws issued for the last frame
+	uint32_t draw_count{ 0 };
+
+	void rect( glm::vec2 min, glm::vec2 max, glm::vec4 color );
+	void quad( glm::vec2 min, glm::vec2 max, Handle<Texture> texture, glm::vec4 color = glm::vec4{ 1.0f }, glm::vec2 uv_min = { 0.0f, 0.0f }, glm::vec2 uv_max = { 1.0f, 1.0f });
+	void line( glm::vec2 a, glm::vec2 b, float width, glm::vec4 color );
+	void ring( glm::vec2 center, float radius, float width, glm::vec4 color, uint32_t segments = 32 );
+	//Top left corner at pos, '\n' starts a new line. Returns the size of the text
+	glm::vec2 text( glm::vec2 pos, std::string_view str, glm::vec4 color, float scale = 1.0f );
+	glm::vec2 text_size( std::string_view str, float scale = 1.0f ) const;
+
+	//Pixel position of a world point, false behind the camera
+	static bool project( const glm::mat4& view_proj, VkExtent2D extent, glm::vec3 world, glm::vec2& screen );
+
+	void init( VkEngine& engine, VkRenderPass pass );
+	//Last in the main pass, consumes everything submitted since the previous call
+	void draw( VkEngine& engine, VkCommandBuffer cmd );
+
+	private:
+		struct FrameResources {
+			AllocatedBuffer vertices;
+			void* mapped;
+		};
+
+		FrameRing<FrameResources> frames;
+		std::vector<OverlayQuad> quads;
+
+		AllocatedImage atlas{};
+		VkImageView atlas_view{ VK_NULL_HANDLE };
+		VkSampler sampler{ VK_NULL_HANDLE };
+
+		VkDescriptorSet atlas_set{ VK_NULL_HANDLE };
+		//Per texture handle drawn this frame, from the frame's transient descriptors
+		std::unordered_map<uint32_t, VkDescriptorSet> texture_sets;
+
+		VkPipelineLayout layout{ VK_NULL_HANDLE };
+		VkPipeline pipeline{ VK_NULL_HANDLE };
+
+		void push( const glm::vec2 pos[4], glm::vec2 uv_min, glm::vec2 uv_max, uint32_t color, Handle<Texture> texture );
+		VkDescriptorSet texture_set( VkEngine& engine, Handle<Texture> texture );
+};
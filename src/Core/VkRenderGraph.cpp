@@ -0,0 +1,726 @@
+#include "Core/VkRenderGraph.hpp"
+
+#include "Core/VkEngine.hpp"
+#include "Core/VkInit.hpp"
+
+#include <algorithm>
+#include <vulkan/vulkan_core.h>
+
+static bool is_depth_format( VkFormat format ){
+	return format == VK_FORMAT_D16_UNORM
+		|| format == VK_FORMAT_D32_SFLOAT
+		|| format == VK_FORMAT_D16_UNORM_S8_UINT
+		|| format == VK_FORMAT_D24_UNORM_S8_UINT
+		|| format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
+
+static bool is_attachment( RGUsage usage ){
+	return usage == RGUsage::ColorAttachment || usage == RGUsage::DepthAttachment;
+}
+
+static VkAccessFlags write_bits( VkAccessFlags access ){
+	return access & ( VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+			| VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+			| VK_ACCESS_SHADER_WRITE_BIT
+			| VK_ACCESS_TRANSFER_WRITE_BIT
+			| VK_ACCESS_HOST_WRITE_BIT
+			| VK_ACCESS_MEMORY_WRITE_BIT );
+}
+
+static RGResourceState access_state( const RGAccess& access, VkPipelineBindPoint bind_point ){
+	VkPipelineStageFlags shader_stages = bind_point == VK_PIPELINE_BIND_POINT_COMPUTE
+		? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+		: VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+	RGResourceState state;
+
+	switch( access.usage ){
+		case RGUsage::ColorAttachment:
+			state.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			state.stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+			state.access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
+			if( access.write )
+				state.access |= VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			break;
+		case RGUsage::DepthAttachment:
+			state.layout = access.write ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+			state.stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+			state.access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+			if( access.write )
+				state.access |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			break;
+		case RGUsage::Sampled:
+			state.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			state.stages = shader_stages;
+			state.access = VK_ACCESS_SHADER_READ_BIT;
+			break;
+		case RGUsage::Storage:
+			state.layout = VK_IMAGE_LAYOUT_GENERAL;
+			state.stages = shader_stages;
+			state.access = VK_ACCESS_SHADER_READ_BIT;
+			if( access.write )
+				state.access |= VK_ACCESS_SHADER_WRITE_BIT;
+			break;
+		case RGUsage::Indirect:
+			state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			state.stages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+			state.access = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+			break;
+		case RGUsage::Transfer:
+			state.layout = access.write ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			state.stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+			state.access = access.write ? VK_ACCESS_TRANSFER_WRITE_BIT : VK_ACCESS_TRANSFER_READ_BIT;
+			break;
+	}
+
+	return state;
+}
+
+static VkImageUsageFlags usage_flags( const RGAccess& access ){
+	switch( access.usage ){
+		case RGUsage::ColorAttachment:
+			return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		case RGUsage::DepthAttachment:
+			return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		case RGUsage::Sampled:
+			return VK_IMAGE_USAGE_SAMPLED_BIT;
+		case RGUsage::Storage:
+			return VK_IMAGE_USAGE_STORAGE_BIT;
+		case RGUsage::Transfer:
+			return access.write ? VK_IMAGE_USAGE_TRANSFER_DST_BIT : VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		case RGUsage::Indirect:
+			return 0;
+	}
+	return 0;
+}
+
+RGPass& RGPass::read( uint32_t res, RGUsage usage ){
+	accesses.push_back( RGAccess{ .res = res, .usage = usage, .write = false });
+	return *this;
+}
+
+RGPass& RGPass::write( uint32_t res, RGUsage usage ){
+	accesses.push_back( RGAccess{ .res = res, .usage = usage, .write = true });
+	return *this;
+}
+
+RGPass& RGPass::clear( uint32_t res, VkClearValue value ){
+	for( auto it = accesses.rbegin(); it != accesses.rend(); ++it ){
+		if( it->res == res ){
+			it->clear = true;
+			it->clear_value = value;
+			break;
+		}
+	}
+	return *this;
+}
+
+uint32_t RenderGraph::import_image( const std::string& name, VkFormat format, VkExtent2D extent, RGResourceState initial, VkImageLayout final_layout ){
+	resources.push_back( RGResource{
+			.name = name,
+			.is_image = true,
+			.imported = true,
+			.format = format,
+			.extent = extent,
+			.initial = initial,
+			.final_layout = final_layout,
+		});
+	return resources.size() - 1;
+}
+
+uint32_t RenderGraph::create_image( const std::string& name, VkFormat format, VkExtent2D extent, uint32_t mip_levels ){
+	resources.push_back( RGResource{
+			.name = name,
+			.is_image = true,
+			.format = format,
+			.extent = extent,
+			.mip_levels = mip_levels,
+		});
+	return resources.size() - 1;
+}
+
+uint32_t RenderGraph::import_buffer( const std::string& name, RGResourceState initial ){
+	resources.push_back( RGResource{
+			.name = name,
+			.is_image = false,
+			.imported = true,
+			.initial = initial,
+		});
+	return resources.size() - 1;
+}
+
+RGPass& RenderGraph::add_pass( const std::string& name, VkPipelineBindPoint bind_point ){
+	passes.push_back( RGPass{
+			.name = name,
+			.bind_point = bind_point,
+		});
+	return passes.back();
+}
+
+void RenderGraph::set_image( uint32_t res, VkImage image, VkImageView view ){
+	resources[res].img.image = image;
+	resources[res].view = view;
+}
+
+void RenderGraph::set_buffer( uint32_t res, VkBuffer buffer ){
+	resources[res].buffer = buffer;
+}
+
+RGPass* RenderGraph::get_pass( const std::string& name ){
+	for( auto& pass: passes ){
+		if( pass.name == name )
+			return &pass;
+	}
+	return nullptr;
+}
+
+//Moves curr past one access of a pass. True if the access needs barrier first
+static bool track_access( RGTrack& curr, const RGAccess& acc, VkPipelineBindPoint bind_point, bool is_image, RGBarrier& barrier ){
+	RGResourceState next = access_state( acc, bind_point );
+
+	bool layout_change = is_image && curr.layout != next.layout;
+
+	if( layout_change || acc.write ){
+		bool discard = is_attachment( acc.usage ) && acc.load_op != VK_ATTACHMENT_LOAD_OP_LOAD;
+
+		barrier = RGBarrier{
+			.res = acc.res,
+			.src = {
+				.layout = discard ? VK_IMAGE_LAYOUT_UNDEFINED : curr.layout,
+				.stages = curr.write_stages | curr.read_stages,
+				.access = curr.write_access,
+			},
+			.dst = next,
+		};
+
+		curr.layout = next.layout;
+		curr.write_stages = next.stages;
+		curr.write_access = acc.write ? write_bits( next.access ) : 0;
+		curr.read_stages = acc.write ? 0 : next.stages;
+		curr.visible_stages = next.stages;
+		return true;
+	}
+
+	bool needed = next.stages & ~curr.visible_stages;
+
+	if( needed ){
+		barrier = RGBarrier{
+			.res = acc.res,
+			.src = {
+				.layout = curr.layout,
+				.stages = curr.write_stages,
+				.access = curr.write_access,
+			},
+			.dst = next,
+		};
+	}
+
+	curr.read_stages |= next.stages;
+	curr.visible_stages |= next.stages;
+	return needed;
+}
+
+void RenderGraph::compile( VkEngine& engine ){
+	//Lifetimes and image usage
+	for( size_t p = 0; p < passes.size(); ++p ){
+		for( auto& acc: passes[p].accesses ){
+			auto& res = resources[acc.res];
+
+			if( res.first_pass < 0 )
+				res.first_pass = p;
+			res.last_pass = p;
+			res.image_usage |= usage_flags( acc );
+		}
+	}
+
+	//Load/store ops. Content only has to reach memory if something before it produced it or something after consumes it
+	std::vector<bool> written( resources.size(), false );
+	std::vector<bool> needs_memory( resources.size(), false );
+
+	for( size_t p = 0; p < passes.size(); ++p ){
+		for( auto& acc: passes[p].accesses ){
+			auto& res = resources[acc.res];
+
+			if( !is_attachment( acc.usage )){
+				needs_memory[acc.res] = true;
+			} else {
+				bool valid_before = written[acc.res] || ( res.imported && res.initial.layout != VK_IMAGE_LAYOUT_UNDEFINED );
+				bool used_after = res.imported || res.last_pass > static_cast<int>( p );
+
+				acc.load_op = acc.clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : valid_before ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+				acc.store_op = used_after ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+				if( acc.load_op == VK_ATTACHMENT_LOAD_OP_LOAD || acc.store_op == VK_ATTACHMENT_STORE_OP_STORE )
+					needs_memory[acc.res] = true;
+			}
+
+			if( acc.write )
+				written[acc.res] = true;
+		}
+	}
+
+	//Images and memory
+	VkDevice dev = engine.vk_device;
+
+	struct AliasCandidate {
+		uint32_t res;
+		VkMemoryRequirements reqs;
+	};
+
+	struct AliasSlot {
+		VkMemoryRequirements reqs;
+		std::vector<uint32_t> owners;
+	};
+
+	std::vector<AliasCandidate> candidates;
+	std::vector<AliasSlot> slots;
+
+	for( uint32_t r = 0; r < resources.size(); ++r ){
+		auto& res = resources[r];
+
+		if( res.imported || !res.is_image || res.first_pass < 0 )
+			continue;
+
+		res.transient = !needs_memory[r];
+
+		if( res.transient )
+			res.image_usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+
+		auto img_cr_inf = vkinit::image_create_info( res.format, res.image_usage, VkExtent3D{ res.extent.width, res.extent.height, 1 });
+		img_cr_inf.mipLevels = res.mip_levels;
+
+		VK_CHECK( vkCreateImage( dev, &img_cr_inf, nullptr, &res.img.image ));
+
+		VkMemoryRequirements reqs;
+		vkGetImageMemoryRequirements( dev, res.img.image, &reqs );
+
+		//Tile based GPUs never back these, desktop GPUs have no lazily allocated memory and fall through to aliasing
+		if( res.transient ){
+			VmaAllocationCreateInfo lazy_alloc{
+				.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED,
+			};
+
+			if( vmaAllocateMemory( engine.vma_alloc, &reqs, &lazy_alloc, &res.img.allocation, nullptr ) == VK_SUCCESS ){
+				VK_CHECK( vmaBindImageMemory( engine.vma_alloc, res.img.allocation, res.img.image ));
+				allocations.push_back( res.img.allocation );
+				continue;
+			}
+		}
+
+		candidates.push_back({ r, reqs });
+	}
+
+	std::sort( candidates.begin(), candidates.end(), []( const AliasCandidate& a, const AliasCandidate& b ){
+			return a.reqs.size > b.reqs.size;
+		});
+
+	for( auto& cand: candidates ){
+		auto& res = resources[cand.res];
+
+		auto overlaps = [&]( const AliasSlot& slot ){
+			for( auto o: slot.owners ){
+				if( resources[o].first_pass <= res.last_pass && res.first_pass <= resources[o].last_pass )
+					return true;
+			}
+			return false;
+		};
+
+		AliasSlot* target = nullptr;
+		for( auto& slot: slots ){
+			if(( slot.reqs.memoryTypeBits & cand.reqs.memoryTypeBits ) && !overlaps( slot )){
+				target = &slot;
+				break;
+			}
+		}
+
+		if( !target ){
+			slots.push_back({ .reqs = cand.reqs });
+			target = &slots.back();
+		} else {
+			target->reqs.size = std::max( target->reqs.size, cand.reqs.size );
+			target->reqs.alignment = std::max( target->reqs.alignment, cand.reqs.alignment );
+			target->reqs.memoryTypeBits &= cand.reqs.memoryTypeBits;
+		}
+
+		target->owners.push_back( cand.res );
+		res.alias_slot = target - slots.data();
+	}
+
+	for( auto& slot: slots ){
+		VmaAllocationCreateInfo alloc_inf{
+			.usage = VMA_MEMORY_USAGE_GPU_ONLY,
+		};
+
+		VmaAllocation allocation;
+		VK_CHECK( vmaAllocateMemory( engine.vma_alloc, &slot.reqs, &alloc_inf, &allocation, nullptr ));
+		allocations.push_back( allocation );
+
+		for( auto o: slot.owners ){
+			resources[o].img.allocation = allocation;
+			VK_CHECK( vmaBindImageMemory( engine.vma_alloc, allocation, resources[o].img.image ));
+		}
+
+		std::sort( slot.owners.begin(), slot.owners.end(), [this]( uint32_t a, uint32_t b ){
+				return resources[a].first_pass < resources[b].first_pass;
+			});
+	}
+
+	for( auto& res: resources ){
+		if( res.imported || !res.is_image || !res.img.image )
+			continue;
+
+		auto view_cr_inf = vkinit::image_view_create_info( res.format, res.img.image, is_depth_format( res.format ) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT );
+		view_cr_inf.subresourceRange.levelCount = res.mip_levels;
+
+		VK_CHECK( vkCreateImageView( dev, &view_cr_inf, nullptr, &res.view ));
+	}
+
+	//Barriers. The first sweep finds the state every resource ends the frame in, which is where the next frame (or the next owner of aliased memory) starts from
+	auto sweep = [&]( std::vector<RGTrack>& track, bool emit ){
+		for( size_t p = 0; p < passes.size(); ++p ){
+			auto& pass = passes[p];
+
+			for( auto& acc: pass.accesses ){
+				if( emit )
+					acc.before = track[acc.res];
+
+				RGBarrier barrier;
+				if( track_access( track[acc.res], acc, pass.bind_point, resources[acc.res].is_image, barrier ) && emit )
+					pass.barriers.push_back( barrier );
+			}
+		}
+	};
+
+	std::vector<RGTrack> end_track( resources.size() );
+	sweep( end_track, false );
+
+	std::vector<RGTrack> track( resources.size() );
+	for( uint32_t r = 0; r < resources.size(); ++r ){
+		auto& res = resources[r];
+
+		if( res.imported ){
+			track[r].layout = res.initial.layout;
+			track[r].write_stages = res.initial.stages;
+			track[r].write_access = res.initial.access;
+			continue;
+		}
+
+		//Start after whoever used the memory last, which is this resource itself in the previous frame unless aliased
+		uint32_t prev = r;
+		if( res.alias_slot >= 0 ){
+			auto& owners = slots[res.alias_slot].owners;
+			auto it = std::find( owners.begin(), owners.end(), r );
+			prev = it == owners.begin() ? owners.back() : *( it - 1 );
+		}
+
+		track[r].layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		track[r].write_stages = end_track[prev].write_stages | end_track[prev].read_stages;
+		track[r].write_access = end_track[prev].write_access;
+	}
+
+	sweep( track, true );
+
+	for( uint32_t r = 0; r < resources.size(); ++r ){
+		auto& res = resources[r];
+
+		res.end_state = {
+			.layout = track[r].layout,
+			.stages = track[r].write_stages | track[r].read_stages,
+			.access = track[r].write_access,
+		};
+
+		if( res.imported && res.is_image && res.final_layout != VK_IMAGE_LAYOUT_UNDEFINED && res.final_layout != track[r].layout ){
+			final_barriers.push_back( RGBarrier{
+					.res = r,
+					.src = res.end_state,
+					.dst = {
+						.layout = res.final_layout,
+						.stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+						.access = 0,
+					},
+				});
+		}
+	}
+
+	//Render passes. Layouts are handled by the barriers, so attachments stay in one layout
+	for( auto& pass: passes ){
+		if( pass.bind_point != VK_PIPELINE_BIND_POINT_GRAPHICS )
+			continue;
+
+		std::vector<VkAttachmentDescription> descs;
+		std::vector<VkAttachmentReference> color_refs;
+		VkAttachmentReference depth_ref{};
+		bool has_depth = false;
+
+		for( auto& acc: pass.accesses ){
+			if( !is_attachment( acc.usage ))
+				continue;
+
+			auto& res = resources[acc.res];
+			VkImageLayout layout = access_state( acc, pass.bind_point ).layout;
+
+			VkAttachmentReference ref{
+				.attachment = static_cast<uint32_t>( descs.size() ),
+				.layout = layout,
+			};
+
+			descs.push_back( VkAttachmentDescription{
+					.format = res.format,
+					.samples = VK_SAMPLE_COUNT_1_BIT,
+					.loadOp = acc.load_op,
+					.storeOp = acc.store_op,
+					.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+					.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+					.initialLayout = layout,
+					.finalLayout = layout,
+				});
+
+			if( acc.usage == RGUsage::DepthAttachment ){
+				depth_ref = ref;
+				has_depth = true;
+			} else {
+				color_refs.push_back( ref );
+			}
+
+			pass.attachments.push_back( acc.res );
+			pass.clear_values.push_back( acc.clear_value );
+			pass.extent = res.extent;
+		}
+
+		VkSubpassDescription subpass{
+			.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+			.colorAttachmentCount = static_cast<uint32_t>( color_refs.size() ),
+			.pColorAttachments = color_refs.data(),
+			.pDepthStencilAttachment = has_depth ? &depth_ref : nullptr,
+		};
+
+		VkRenderPassCreateInfo render_pass_cr_inf{
+			.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+			.pNext = nullptr,
+			.attachmentCount = static_cast<uint32_t>( descs.size() ),
+			.pAttachments = descs.data(),
+			.subpassCount = 1,
+			.pSubpasses = &subpass,
+		};
+
+		VK_CHECK( vkCreateRenderPass( dev, &render_pass_cr_inf, nullptr, &pass.render_pass ));
+	}
+}
+
+void RenderGraph::emit_barriers( VkCommandBuffer cmd, const std::vector<RGBarrier>& barriers ){
+	if( barriers.empty() )
+		return;
+
+	std::vector<VkImageMemoryBarrier> img_barriers;
+	std::vector<VkBufferMemoryBarrier> buf_barriers;
+	VkPipelineStageFlags src_stages = 0;
+	VkPipelineStageFlags dst_stages = 0;
+
+	for( auto& b: barriers ){
+		auto& res = resources[b.res];
+
+		src_stages |= b.src.stages;
+		dst_stages |= b.dst.stages;
+
+		if( res.is_image ){
+			img_barriers.push_back( VkImageMemoryBarrier{
+					.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+					.pNext = nullptr,
+					.srcAccessMask = b.src.access,
+					.dstAccessMask = b.dst.access,
+					.oldLayout = b.src.layout,
+					.newLayout = b.dst.layout,
+					.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+					.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+					.image = res.img.image,
+					.subresourceRange = {
+						.aspectMask = is_depth_format( res.format ) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT,
+						.baseMipLevel = 0,
+						.levelCount = VK_REMAINING_MIP_LEVELS,
+						.baseArrayLayer = 0,
+						.layerCount = 1,
+					},
+				});
+		} else {
+			buf_barriers.push_back( VkBufferMemoryBarrier{
+					.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+					.pNext = nullptr,
+					.srcAccessMask = b.src.access,
+					.dstAccessMask = b.dst.access,
+					.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+					.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+					.buffer = res.buffer,
+					.offset = 0,
+					.size = VK_WHOLE_SIZE,
+				});
+		}
+	}
+
+	vkCmdPipelineBarrier(
+			cmd, src_stages ? src_stages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dst_stages, 0,
+			0, nullptr,
+			buf_barriers.size(), buf_barriers.data(),
+			img_barriers.size(), img_barriers.data() );
+}
+
+void RenderGraph::execute( VkEngine& engine, VkCommandBuffer cmd ){
+	live.resize( resources.size() );
+	diverged.assign( resources.size(), false );
+	used.assign( resources.size(), false );
+	bool any_diverged = false;
+
+	for( auto& pass: passes ){
+		if( pass.active && !pass.active() ){
+			//Whatever the pass would have done, its resources stay as they were before it
+			for( auto& acc: pass.accesses ){
+				if( !diverged[acc.res] ){
+					live[acc.res] = acc.before;
+					diverged[acc.res] = true;
+				}
+			}
+
+			any_diverged = true;
+			continue;
+		}
+
+		for( auto& acc: pass.accesses )
+			used[acc.res] = true;
+
+		if( !any_diverged ){
+			emit_barriers( cmd, pass.barriers );
+		} else {
+			std::vector<RGBarrier> barriers;
+
+			for( auto& b: pass.barriers ){
+				if( !diverged[b.res] )
+					barriers.push_back( b );
+			}
+
+			for( auto& acc: pass.accesses ){
+				RGBarrier barrier;
+				if( diverged[acc.res] && track_access( live[acc.res], acc, pass.bind_point, resources[acc.res].is_image, barrier ))
+					barriers.push_back( barrier );
+			}
+
+			emit_barriers( cmd, barriers );
+		}
+
+		if( pass.bind_point != VK_PIPELINE_BIND_POINT_GRAPHICS ){
+			if( pass.record )
+				pass.record( cmd );
+			continue;
+		}
+
+		std::vector<VkImageView> views;
+		for( auto a: pass.attachments )
+			views.push_back( resources[a].view );
+
+		auto fb = pass.framebuffers.find( views );
+		if( fb == pass.framebuffers.end() ){
+			VkFramebufferCreateInfo frame_cr_inf{
+				.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+				.pNext = nullptr,
+				.renderPass = pass.render_pass,
+				.attachmentCount = static_cast<uint32_t>( views.size() ),
+				.pAttachments = views.data(),
+				.width = pass.extent.width,
+				.height = pass.extent.height,
+				.layers = 1,
+			};
+
+			VkFramebuffer framebuffer;
+			VK_CHECK( vkCreateFramebuffer( engine.vk_device, &frame_cr_inf, nullptr, &framebuffer ));
+			fb = pass.framebuffers.emplace( views, framebuffer ).first;
+		}
+
+		VkRenderPassBeginInfo render_beg_inf{
+			.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+			.pNext = nullptr,
+			.renderPass = pass.render_pass,
+			.framebuffer = fb->second,
+			.renderArea = VkRect2D{
+				.offset = { 0, 0 },
+				.extent = pass.extent,
+			},
+			.clearValueCount = static_cast<uint32_t>( pass.clear_values.size() ),
+			.pClearValues = pass.clear_values.data(),
+		};
+
+		vkCmdBeginRenderPass( cmd, &render_beg_inf, pass.secondary ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE );
+
+		if( pass.record )
+			pass.record( cmd );
+
+		vkCmdEndRenderPass( cmd );
+	}
+
+	if( !any_diverged ){
+		emit_barriers( cmd, final_barriers );
+		return;
+	}
+
+	//The next frame's compiled barriers start from the end state, or the final layout of imported images
+	std::vector<RGBarrier> barriers;
+
+	for( auto& b: final_barriers ){
+		if( !diverged[b.res] )
+			barriers.push_back( b );
+	}
+
+	for( uint32_t r = 0; r < resources.size(); ++r ){
+		//Untouched this frame, still in the state it started the frame in
+		if( !diverged[r] || !used[r] )
+			continue;
+
+		auto& res = resources[r];
+		auto& curr = live[r];
+
+		//Internal images start the next frame undefined anyway
+		RGResourceState target = res.end_state;
+		if( !res.imported )
+			target.layout = curr.layout;
+		else if( res.is_image && res.final_layout != VK_IMAGE_LAYOUT_UNDEFINED )
+			target.layout = res.final_layout;
+		target.access = 0;
+
+		barriers.push_back( RGBarrier{
+				.res = r,
+				.src = {
+					.layout = curr.layout,
+					.stages = curr.write_stages | curr.read_stages,
+					.access = curr.write_access,
+				},
+				.dst = target,
+			});
+	}
+
+	emit_barriers( cmd, barriers );
+}
+
+void RenderGraph::destroy( VkEngine& engine ){
+	for( auto& pass: passes ){
+		for( auto& [views, framebuffer]: pass.framebuffers )
+			vkDestroyFramebuffer( engine.vk_device, framebuffer, nullptr );
+
+		if( pass.render_pass )
+			vkDestroyRenderPass( engine.vk_device, pass.render_pass, nullptr );
+	}
+
+	for( auto& res: resources ){
+		if( res.imported || !res.is_image )
+			continue;
+
+		if( res.view )
+			vkDestroyImageView( engine.vk_device, res.view, nullptr );
+		if( res.img.image )
+			vkDestroyImage( engine.vk_device, res.img.image, nullptr );
+	}
+
+	for( auto allocation: allocations )
+		vmaFreeMemory( engine.vma_alloc, allocation );
+
+	passes.clear();
+	resources.clear();
+	final_barriers.clear();
+	allocations.clear();
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "VkTypes.hpp"
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+struct VkEngine;
+
+enum class RGUsage {
+	ColorAttachment,
+	DepthAttachment,	//read() is a depth test without depth writes
+	Sampled,
+	Storage,
+	Indirect,
+	Transfer,
+};
+
+struct RGResourceState {
+	VkImageLayout layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+	VkPipelineStageFlags stages{ VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT };
+	VkAccessFlags access{ 0 };
+};
+
+struct RGResource {
+	std::string name;
+	bool is_image{ true };
+	bool imported{ false };
+
+	VkFormat format{ VK_FORMAT_UNDEFINED };
+	VkExtent2D extent{};
+	uint32_t mip_levels{ 1 };
+
+	//Imported resources: state before the graph runs and the layout it has to be left in
+	RGResourceState initial{};
+	VkImageLayout final_layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+
+	//Derived by compile()
+	VkImageUsageFlags image_usage{ 0 };
+	int first_pass{ -1 };
+	int last_pass{ -1 };
+	bool transient{ false };
+	int alias_slot{ -1 };
+	RGResourceState end_state{};
+
+	AllocatedImage img{};
+	VkImageView view{ VK_NULL_HANDLE };
+	VkBuffer buffer{ VK_NULL_HANDLE };
+};
+
+//Synchronisation state of one resource while walking the passes
+struct RGTrack {
+	VkImageLayout layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+	VkPipelineStageFlags write_stages{ VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT };
+	VkAccessFlags write_access{ 0 };
+	VkPipelineStageFlags read_stages{ 0 };
+	VkPipelineStageFlags visible_stages{ 0 };
+};
+
+struct RGAccess {
+	uint32_t res;
+	RGUsage usage;
+	bool write;
+	bool clear{ false };
+	VkClearValue clear_value{};
+
+	//Derived by compile() for attachments
+	VkAttachmentLoadOp load_op{ VK_ATTACHMENT_LOAD_OP_DONT_CARE };
+	VkAttachmentStoreOp store_op{ VK_ATTACHMENT_STORE_OP_DONT_CARE };
+	//Derived by compile(), the state the pass finds the resource in
+	RGTrack before{};
+};
+
+struct RGBarrier {
+	uint32_t res;
+	RGResourceState src, dst;
+};
+
+struct RGPass {
+	std::string name;
+	VkPipelineBindPoint bind_point;
+	std::vector<RGAccess> accesses;
+
+	std::function<void( VkCommandBuffer )> record;
+	//record() only executes secondary command buffers inheriting render_pass
+	bool secondary{ false };
+	//Checked every frame if set, false skips the pass and its barriers
+	std::function<bool()> active;
+
+	RGPass& read( uint32_t res, RGUsage usage );
+	RGPass& write( uint32_t res, RGUsage usage );
+	RGPass& clear( uint32_t res, VkClearValue value );
+
+	//Derived by compile()
+	VkRenderPass render_pass{ VK_NULL_HANDLE };
+	VkExtent2D extent{};
+	std::vector<uint32_t> attachments;
+	std::vector<VkClearValue> clear_values;
+	std::vector<RGBarrier> barriers;
+
+	std::map<std::vector<VkImageView>, VkFramebuffer> framebuffers;
+};
+
+/*
+ * Passes are executed in the order they are added. compile() derives from the
+ * declared accesses: load/store ops, the barriers in front of every pass and
+ * which attachments never touch memory (transient, lazily allocated).
+ * Internal images with disjoint lifetimes share memory.
+ *
+ * A skipped pass leaves its resources in an earlier state than the compiled
+ * barriers expect. execute() tracks those resources itself for the rest of
+ * the frame and brings them back to their end of frame state.
+ */
+struct RenderGraph {
+	std::vector<RGResource> resources;
+	std::deque<RGPass> passes;
+	std::vector<RGBarrier> final_barriers;
+	std::vector<VmaAllocation> allocations;
+
+	uint32_t import_image( const std::string& name, VkFormat format, VkExtent2D extent, RGResourceState initial, VkImageLayout final_layout );
+	uint32_t create_image( const std::string& name, VkFormat format, VkExtent2D extent, uint32_t mip_levels = 1 );
+	//Buffers reused every frame pass the stages that last touched them, so the first write waits for them
+	uint32_t import_buffer( const std::string& name, RGResourceState initial = {} );
+
+	RGPass& add_pass( const std::string& name, VkPipelineBindPoint bind_point );
+
+	//Imported resources can change every frame (e.g. swapchain images)
+	void set_image( uint32_t res, VkImage image, VkImageView view );
+	void set_buffer( uint32_t res, VkBuffer buffer );
+
+	RGPass* get_pass( const std::string& name );
+
+	void compile( VkEngine& engine );
+	void execute( VkEngine& engine, VkCommandBuffer cmd );
+	void destroy( VkEngine& engine );
+
+	private:
+		void emit_barriers( VkCommandBuffer cmd, const std::vector<RGBarrier>& barriers );
+
+		//Actual state of resources that diverged from the compiled barriers this frame
+		std::vector<RGTrack> live;
+		std::vector<bool> diverged;
+		//Accessed by a pass that ran this frame
+		std::vector<bool> used;
+};
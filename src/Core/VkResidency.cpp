@@ -0,0 +1,75 @@
+#include "Core/VkResidency.hpp"
+
+#include "Core/VkEngine.hpp"
+
+#include <algorithm>
+#include <vector>
+
+void TextureResidency::update( VkEngine& engine ){
+	uint64_t frame = engine.frameNumber;
+
+	//Evicted textures that were drawn again since
+	evicted = 0;
+	for( uint32_t i = 0; i < engine.textures.size(); ++i ){
+		Texture& tex = engine.textures.data[i];
+
+		if( !tex.borrowed || tex.path.empty() )
+			continue;
+
+		if( !tex.loading && tex.last_used + 1 >= frame )
+			engine.reload_texture( engine.textures.handle_of( i ));
+		else
+			++evicted;
+	}
+
+	const VkPhysicalDeviceMemoryProperties* props;
+	vmaGetMemoryProperties( engine.vma_alloc, &props );
+
+	VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+	vmaGetBudget( engine.vma_alloc, budgets );
+
+	usage = 0;
+	VkDeviceSize granted = 0;
+
+	for( uint32_t h = 0; h < props->memoryHeapCount; ++h ){
+		if( props->memoryHeaps[h].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT ){
+			usage += budgets[h].usage;
+			granted += budgets[h].budget;
+		}
+	}
+
+	budget = budget_bytes ? budget_bytes : static_cast<VkDeviceSize>( static_cast<double>( granted ) * budget_fraction );
+
+	if( usage <= budget || frame < settle_frame )
+		return;
+
+	std::vector<uint32_t> candidates;
+
+	for( uint32_t i = 0; i < engine.textures.size(); ++i ){
+		Texture& tex = engine.textures.data[i];
+
+		//Only streamed textures can come back
+		if( tex.borrowed || tex.path.empty() || tex.last_used + min_idle_frames > frame )
+			continue;
+
+		candidates.push_back( i );
+	}
+
+	std::sort( candidates.begin(), candidates.end(), [&]( uint32_t a, uint32_t b ){
+			return engine.textures.data[a].last_used < engine.textures.data[b].last_used;
+		});
+
+	VkDeviceSize excess = usage - budget;
+	VkDeviceSize freed = 0;
+
+	for( uint32_t i: candidates ){
+		if( freed >= excess )
+			break;
+
+		freed += engine.textures.data[i].bytes;
+		engine.evict_texture( engine.textures.handle_of( i ));
+	}
+
+	if( freed )
+		settle_frame = frame + engine.frames.size() + 1;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "VkTypes.hpp"
+
+#include <cstdint>
+
+struct VkEngine;
+
+/*
+ * Keeps streamed textures within a budget of device local memory. Every bind
+ * marks a texture with the current frame. Once VMA reports more usage than
+ * the budget, the least recently used textures fall back to the placeholder
+ * and their images are retired. A texture that is used again while evicted is
+ * streamed back in from its file.
+ *
+ * Usage and budget come from VK_EXT_memory_budget when the device has it,
+ * otherwise VMA estimates them from its own allocations and the heap sizes.
+ */
+struct TextureResidency {
+	//Share of the budget the driver grants, used when budget_bytes is 0
+	float budget_fraction{ 0.9f };
+	//Fixed budget for all device local heaps, e.g. to test a 4GB laptop on a bigger GPU
+	VkDeviceSize budget_bytes{ 0 };
+	//Textures used this recently are never evicted
+	uint32_t min_idle_frames{ 8 };
+
+	//Device local memory at the last update()
+	VkDeviceSize usage{ 0 };
+	VkDeviceSize budget{ 0 };
+	//Streamed textures showing the placeholder, loading or evicted
+	uint32_t evicted{ 0 };
+
+	//Start of the frame, after the uploads of earlier frames were swapped in
+	void update( VkEngine& engine );
+
+	private:
+		//Retired images are only freed a few frames later, until then usage still counts them
+		uint64_t settle_frame{ 0 };
+};
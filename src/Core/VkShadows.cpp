@@ -0,0 +1,449 @@
+#include "Core/VkShadows.hpp"
+
+#include "Core/VkEngine.hpp"
+#include "Core/VkInit.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <iostream>
+
+struct CubeFace {
+	glm::vec3 fwd;
+	glm::vec3 right;
+	glm::vec3 up;
+};
+
+//Keep in sync with the FACE_* tables in triangle.frag. Face f is tile ( f % 3, f / 3 ) of its slot
+static const CubeFace FACES[6] = {
+	{ {  1.0f,  0.0f,  0.0f }, {  0.0f,  0.0f, -1.0f }, {  0.0f, -1.0f,  0.0f }},
+	{ { -1.0f,  0.0f,  0.0f }, {  0.0f,  0.0f,  1.0f }, {  0.0f, -1.0f,  0.0f }},
+	{ {  0.0f,  1.0f,  0.0f }, {  1.0f,  0.0f,  0.0f }, {  0.0f,  0.0f,  1.0f }},
+	{ {  0.0f, -1.0f,  0.0f }, {  1.0f,  0.0f,  0.0f }, {  0.0f,  0.0f, -1.0f }},
+	{ {  0.0f,  0.0f,  1.0f }, {  1.0f,  0.0f,  0.0f }, {  0.0f, -1.0f,  0.0f }},
+	{ {  0.0f,  0.0f, -1.0f }, { -1.0f,  0.0f,  0.0f }, {  0.0f, -1.0f,  0.0f }},
+};
+
+constexpr static float SHADOW_NEAR = 0.05f;
+
+static glm::mat4 face_view( uint32_t face, glm::vec3 light_pos ){
+	const CubeFace& f = FACES[face];
+
+	glm::mat4 view{ 1.0f };
+	for( int i = 0; i < 3; ++i ){
+		view[i][0] = f.right[i];
+		view[i][1] = f.up[i];
+		view[i][2] = f.fwd[i];
+	}
+
+	view[3] = glm::vec4{ -glm::dot( f.right, light_pos ), -glm::dot( f.up, light_pos ), -glm::dot( f.fwd, light_pos ), 1.0f };
+	return view;
+}
+
+static bool touches( const glm::vec4& light, const glm::vec4& bounds ){
+	return glm::length( glm::vec3{ bounds } - glm::vec3{ light }) <= light.w + bounds.w;
+}
+
+//Sphere against the 90 degree pyramid of one face
+static bool touches_face( uint32_t face, const glm::vec4& light, const glm::vec4& bounds ){
+	const CubeFace& f = FACES[face];
+	glm::vec3 c = glm::vec3{ bounds } - glm::vec3{ light };
+	float slack = bounds.w * 1.41421356f;
+
+	float d = glm::dot( c, f.fwd );
+	float r = glm::dot( c, f.right );
+	float u = glm::dot( c, f.up );
+
+	return d - r >= -slack && d + r >= -slack && d - u >= -slack && d + u >= -slack;
+}
+
+bool ShadowAtlas::enable( ClusteredLights& lights, Handle<PointLight> light ){
+	PointLight* l = lights.get_light( light );
+	if( !l )
+		return false;
+
+	if( l->shadow_slot >= 0 )
+		return true;
+
+	for( uint32_t s = 0; s < slots.size(); ++s ){
+		if( slots[s].light )
+			continue;
+
+		slots[s] = ShadowSlot{ .light = light };
+		l->shadow_slot = s;
+		return true;
+	}
+
+	return false;
+}
+
+void ShadowAtlas::disable( ClusteredLights& lights, Handle<PointLight> light ){
+	for( auto& slot: slots ){
+		if( slot.light == light )
+			slot = ShadowSlot{};
+	}
+
+	if( PointLight* l = lights.get_light( light ))
+		l->shadow_slot = -1;
+}
+
+VkRect2D ShadowAtlas::face_rect( uint32_t slot, uint32_t face ) const {
+	return VkRect2D{
+		.offset = {
+			static_cast<int32_t>((( slot % SLOTS_X ) * 3 + face % 3 ) * FACE_SIZE ),
+			static_cast<int32_t>((( slot / SLOTS_X ) * 2 + face / 3 ) * FACE_SIZE ),
+		},
+		.extent = { FACE_SIZE, FACE_SIZE },
+	};
+}
+
+void ShadowAtlas::begin_face( VkCommandBuffer cmd, uint32_t slot, uint32_t face ) const {
+	VkRect2D rect = face_rect( slot, face );
+
+	VkViewport viewport{
+		.x = static_cast<float>( rect.offset.x ),
+		.y = static_cast<float>( rect.offset.y ),
+		.width = static_cast<float>( FACE_SIZE ),
+		.height = static_cast<float>( FACE_SIZE ),
+		.minDepth = 0.0f,
+		.maxDepth = 1.0f,
+	};
+
+	vkCmdSetViewport( cmd, 0, 1, &viewport );
+	vkCmdSetScissor( cmd, 0, 1, &rect );
+}
+
+void ShadowAtlas::init( VkEngine& engine, VkRenderPass pass ){
+	VkDevice dev = engine.vk_device;
+
+	VmaAllocationCreateInfo img_alloc{
+		.usage = VMA_MEMORY_USAGE_GPU_ONLY,
+	};
+
+	auto cache_cr_inf = vkinit::image_create_info( FORMAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VkExtent3D{ WIDTH, HEIGHT, 1 });
+	auto atlas_cr_inf = vkinit::image_create_info( FORMAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VkExtent3D{ WIDTH, HEIGHT, 1 });
+
+	VK_CHECK( vmaCreateImage( engine.vma_alloc, &cache_cr_inf, &img_alloc, &cache.image, &cache.allocation, nullptr ));
+	VK_CHECK( vmaCreateImage( engine.vma_alloc, &atlas_cr_inf, &img_alloc, &atlas.image, &atlas.allocation, nullptr ));
+
+	auto cache_view_inf = vkinit::image_view_create_info( FORMAT, cache.image, VK_IMAGE_ASPECT_DEPTH_BIT );
+	auto atlas_view_inf = vkinit::image_view_create_info( FORMAT, atlas.image, VK_IMAGE_ASPECT_DEPTH_BIT );
+
+	VK_CHECK( vkCreateImageView( dev, &cache_view_inf, nullptr, &cache_view ));
+	VK_CHECK( vkCreateImageView( dev, &atlas_view_inf, nullptr, &atlas_view ));
+
+	//Both start out unshadowed, in the state the render graph expects at the start of a frame
+	engine.immediate_submit( [&]( VkCommandBuffer cmd ){
+			VkImageSubresourceRange range{
+				.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+				.baseMipLevel = 0,
+				.levelCount = 1,
+				.baseArrayLayer = 0,
+				.layerCount = 1,
+			};
+
+			VkImageMemoryBarrier to_transfer[2];
+			VkImageMemoryBarrier to_initial[2];
+			VkImage images[2] = { cache.image, atlas.image };
+			VkImageLayout layouts[2] = { VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+
+			for( int i = 0; i < 2; ++i ){
+				to_transfer[i] = VkImageMemoryBarrier{
+					.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+					.pNext = nullptr,
+					.srcAccessMask = 0,
+					.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+					.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+					.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+					.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+					.image = images[i],
+					.subresourceRange = range,
+				};
+
+				to_initial[i] = VkImageMemoryBarrier{
+					.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+					.pNext = nullptr,
+					.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+					.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+					.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					.newLayout = layouts[i],
+					.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+					.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+					.image = images[i],
+					.subresourceRange = range,
+				};
+			}
+
+			vkCmdPipelineBarrier(
+					cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+					0, nullptr,
+					0, nullptr,
+					2, to_transfer );
+
+			VkClearDepthStencilValue far{ .depth = 1.0f, .stencil = 0 };
+			vkCmdClearDepthStencilImage( cmd, cache.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &far, 1, &range );
+			vkCmdClearDepthStencilImage( cmd, atlas.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &far, 1, &range );
+
+			vkCmdPipelineBarrier(
+					cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+					0, nullptr,
+					0, nullptr,
+					2, to_initial );
+		});
+
+	auto sampler_inf = vkinit::sampler_create_info( VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE );
+	VK_CHECK( vkCreateSampler( dev, &sampler_inf, nullptr, &sampler ));
+
+	for( size_t i = 0; i < engine.frames.size(); ++i ){
+		VkDescriptorImageInfo img_inf{
+			.sampler = sampler,
+			.imageView = atlas_view,
+			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		};
+
+		auto write = vkinit::write_descriptor_set_image( VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, engine.frames[i].global_desc, &img_inf, 3 );
+		vkUpdateDescriptorSets( dev, 1, &write, 0, nullptr );
+	}
+
+	engine.lights.shadow_params = glm::vec4{ FACE_SIZE, SLOTS_X, WIDTH, HEIGHT };
+
+	//Depth only pipeline, shared by the static and the dynamic pass
+	VkShaderModule shadow_vert{}, shadow_frag{};
+
+	if( !engine.vk_load_shader( FILE_PREFIX "shader/shadow.vert.spv", &shadow_vert )){
+		std::cout << "Failed to load shadow vert shader" << std::endl;
+	}
+
+	if( !engine.vk_load_shader( FILE_PREFIX "shader/shadow.frag.spv", &shadow_frag )){
+		std::cout << "Failed to load shadow frag shader" << std::endl;
+	}
+
+	VkPushConstantRange push_constant{
+		.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+		.offset = 0,
+		.size = sizeof( ShadowPushConstants ),
+	};
+
+	auto pipe_lay_cr_inf = vkinit::pipeline_layout();
+	pipe_lay_cr_inf.pushConstantRangeCount = 1;
+	pipe_lay_cr_inf.pPushConstantRanges = &push_constant;
+
+	VK_CHECK( vkCreatePipelineLayout( dev, &pipe_lay_cr_inf, nullptr, &layout ));
+
+	PipelineBuilder pipe_builder;
+
+	VertexInputDescription vertex_desc{ Vertex::get_vk_description() };
+
+	pipe_builder.vertex_in_info = vkinit::vertex_input_state_create_info();
+	pipe_builder.vertex_in_info.vertexAttributeDescriptionCount = vertex_desc.attributes.size();
+	pipe_builder.vertex_in_info.pVertexAttributeDescriptions = vertex_desc.attributes.data();
+	pipe_builder.vertex_in_info.vertexBindingDescriptionCount = vertex_desc.bindings.size();
+	pipe_builder.vertex_in_info.pVertexBindingDescriptions = vertex_desc.bindings.data();
+
+	pipe_builder.shader_stages.push_back(
+			vkinit::shader_stage_create_info( VK_SHADER_STAGE_VERTEX_BIT, shadow_vert ));
+
+	pipe_builder.shader_stages.push_back(
+			vkinit::shader_stage_create_info( VK_SHADER_STAGE_FRAGMENT_BIT, shadow_frag ));
+
+	pipe_builder.input_assembly = vkinit::input_assembly_state_create_info( VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST );
+
+	//Set per face
+	pipe_builder.viewport = VkViewport{ 0.0f, 0.0f, static_cast<float>( FACE_SIZE ), static_cast<float>( FACE_SIZE ), 0.0f, 1.0f };
+	pipe_builder.scissor = VkRect2D{ { 0, 0 }, { FACE_SIZE, FACE_SIZE }};
+	pipe_builder.dynamic_states = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+	pipe_builder.rasterizer = vkinit::rasterization_state_create_info( VK_POLYGON_MODE_FILL );
+	pipe_builder.multisample_state = vkinit::multisample_state_create_info();
+	pipe_builder.color_blend = vkinit::color_blend_attachment_state();
+	pipe_builder.color_attachment_count = 0;
+	pipe_builder.depth_stencil_state = vkinit::depth_stencil_state_create_info( VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL );
+	pipe_builder.pipeline_layout = layout;
+
+	pipeline = pipe_builder.build_pipeline( dev, pass );
+
+	vkDestroyShaderModule( dev, shadow_vert, nullptr );
+	vkDestroyShaderModule( dev, shadow_frag, nullptr );
+
+	engine.deletion_queue.push( pipeline );
+	engine.deletion_queue.push( layout );
+	engine.deletion_queue.push( sampler );
+	engine.deletion_queue.push( cache_view );
+	engine.deletion_queue.push( atlas_view );
+	engine.deletion_queue.push( cache );
+	engine.deletion_queue.push( atlas );
+}
+
+void ShadowAtlas::update( VkEngine& engine ){
+	static_updates.clear();
+	dynamic_updates.clear();
+	faces_rendered = 0;
+
+	for( uint32_t s = 0; s < slots.size(); ++s ){
+		ShadowSlot& slot = slots[s];
+		if( !slot.light )
+			continue;
+
+		PointLight* light = engine.lights.get_light( slot.light );
+		if( !light ){
+			slot = ShadowSlot{};
+			continue;
+		}
+
+		glm::vec4 now{ light->pos, light->radius };
+		if( now != slot.rendered ){
+			slot.rendered = now;
+			slot.static_dirty = true;
+		}
+
+		for( auto& b: engine.static_layer.changed )
+			slot.static_dirty |= touches( now, b );
+
+		for( auto& b: engine.scene.moved_casters )
+			slot.dynamic_dirty |= touches( now, b );
+
+		//The cache is copied under the moving casters, so a new cache means a new composite
+		if( slot.static_dirty )
+			static_updates.push_back( s );
+		if( slot.static_dirty || slot.dynamic_dirty )
+			dynamic_updates.push_back( s );
+
+		slot.static_dirty = false;
+		slot.dynamic_dirty = false;
+	}
+
+	engine.static_layer.changed.clear();
+	engine.scene.moved_casters.clear();
+}
+
+void ShadowAtlas::record_static( VkEngine& engine, VkCommandBuffer cmd ){
+	if( static_updates.empty() || !pipeline )
+		return;
+
+	vkCmdBindPipeline( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline );
+	engine.geometry.bind( cmd );
+
+	for( auto s: static_updates ){
+		const glm::vec4& light = slots[s].rendered;
+
+		for( uint32_t face = 0; face < 6; ++face ){
+			begin_face( cmd, s, face );
+
+			VkClearAttachment clear{
+				.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+				.colorAttachment = 0,
+				.clearValue = VkClearValue{ .depthStencil = { .depth = 1.0f }},
+			};
+
+			VkClearRect clear_rect{
+				.rect = face_rect( s, face ),
+				.baseArrayLayer = 0,
+				.layerCount = 1,
+			};
+
+			vkCmdClearAttachments( cmd, 1, &clear, 1, &clear_rect );
+
+			//Chunks are already in world space
+			ShadowPushConstants consts{
+				.model_view = face_view( face, glm::vec3{ light }),
+				.params = glm::vec4{ SHADOW_NEAR, light.w, 0.0f, 0.0f },
+			};
+
+			vkCmdPushConstants( cmd, layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof( ShadowPushConstants ), &consts );
+
+			for( auto& [key, chunk]: engine.static_layer.chunks ){
+				ChunkGeometry* geo = chunk.geometry.get();
+				if( !geo || !touches( light, geo->bounds ) || !touches_face( face, light, geo->bounds ))
+					continue;
+
+				//Batches are consecutive, depth does not care about materials
+				vkCmdDraw( cmd, geo->vertex_count, 1, geo->base_vertex, 0 );
+			}
+
+			++faces_rendered;
+		}
+	}
+}
+
+void ShadowAtlas::record_copy( VkEngine& engine, VkCommandBuffer cmd ){
+	if( dynamic_updates.empty() )
+		return;
+
+	std::vector<VkImageCopy> regions;
+	regions.reserve( dynamic_updates.size() );
+
+	for( auto s: dynamic_updates ){
+		VkRect2D rect = face_rect( s, 0 );
+
+		regions.push_back( VkImageCopy{
+				.srcSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1 },
+				.srcOffset = { rect.offset.x, rect.offset.y, 0 },
+				.dstSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1 },
+				.dstOffset = { rect.offset.x, rect.offset.y, 0 },
+				.extent = { 3 * FACE_SIZE, 2 * FACE_SIZE, 1 },
+			});
+	}
+
+	vkCmdCopyImage(
+			cmd,
+			cache.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			atlas.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			regions.size(), regions.data() );
+}
+
+void ShadowAtlas::record_dynamic( VkEngine& engine, VkCommandBuffer cmd ){
+	if( dynamic_updates.empty() || !pipeline )
+		return;
+
+	SceneStore& scene = engine.scene;
+
+	vkCmdBindPipeline( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline );
+	engine.geometry.bind( cmd );
+
+	for( auto s: dynamic_updates ){
+		const glm::vec4& light = slots[s].rendered;
+
+		//Casters in range, tested per face below
+		std::vector<uint32_t> casters;
+		for( uint32_t i = 0; i < scene.size(); ++i ){
+			if(( scene.flags[i] & ( ENTITY_CASTS_SHADOW | ENTITY_HIDDEN )) == ENTITY_CASTS_SHADOW && touches( light, scene.world_bounds[i] ))
+				casters.push_back( i );
+		}
+
+		if( casters.empty() )
+			continue;
+
+		for( uint32_t face = 0; face < 6; ++face ){
+			begin_face( cmd, s, face );
+
+			glm::mat4 view = face_view( face, glm::vec3{ light });
+			MeshHandle last_mesh{};
+			Mesh* mesh = nullptr;
+
+			for( auto i: casters ){
+				if( !touches_face( face, light, scene.world_bounds[i] ))
+					continue;
+
+				if( scene.render[i].mesh != last_mesh ){
+					mesh = engine.meshes.get( scene.render[i].mesh );
+					last_mesh = scene.render[i].mesh;
+				}
+
+				if( !mesh )
+					continue;
+
+				ShadowPushConstants consts{
+					.model_view = view * scene.world[i],
+					.params = glm::vec4{ SHADOW_NEAR, light.w, 0.0f, 0.0f },
+				};
+
+				vkCmdPushConstants( cmd, layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof( ShadowPushConstants ), &consts );
+				//Full detail, the cached faces do not depend on the camera
+				vkCmdDraw( cmd, mesh->lods[0].vertex_count, 1, mesh->base_vertex, 0 );
+			}
+
+			++faces_rendered;
+		}
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "VkTypes.hpp"
+#include "VkSlotMap.hpp"
+#include "VkLights.hpp"
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <vector>
+
+struct VkEngine;
+
+struct ShadowPushConstants {
+	glm::mat4 model_view;	//Into the space of one cube face, z along the face direction
+	glm::vec4 params;		//x near, y far (the light radius)
+};
+
+struct ShadowSlot {
+	Handle<PointLight> light;
+	glm::vec4 rendered{};		//Position and radius the cached faces were rendered with
+	bool static_dirty{ true };
+	bool dynamic_dirty{ true };
+};
+
+/*
+ * Omnidirectional shadows for point lights. Each shadowed light owns one slot
+ * of the atlas, holding its six cube faces (3 x 2 tiles) as distance / radius.
+ *
+ * Static map geometry is rendered into a cached atlas only when the light or
+ * a static chunk in its radius changes. When a shadow casting entity in the
+ * radius moves, the slot is copied from the cache and just the entities are
+ * drawn on top. Slots without changes cost nothing.
+ */
+struct ShadowAtlas {
+	constexpr static uint32_t FACE_SIZE = 256;
+	constexpr static uint32_t SLOTS_X = 4;
+	constexpr static uint32_t SLOTS_Y = 4;
+	constexpr static uint32_t WIDTH = SLOTS_X * 3 * FACE_SIZE;
+	constexpr static uint32_t HEIGHT = SLOTS_Y * 2 * FACE_SIZE;
+	constexpr static VkFormat FORMAT = VK_FORMAT_D32_SFLOAT;
+
+	std::vector<ShadowSlot> slots{ SLOTS_X * SLOTS_Y };
+
+	//False if every slot is taken
+	bool enable( ClusteredLights& lights, Handle<PointLight> light );
+	void disable( ClusteredLights& lights, Handle<PointLight> light );
+
+	//Static casters only, reused while nothing in the slots changes
+	AllocatedImage cache{};
+	VkImageView cache_view{ VK_NULL_HANDLE };
+	//What the lighting samples: cache plus moving casters
+	AllocatedImage atlas{};
+	VkImageView atlas_view{ VK_NULL_HANDLE };
+	VkSampler sampler{ VK_NULL_HANDLE };
+
+	//Cube faces drawn in the last frame
+	uint32_t faces_rendered{ 0 };
+
+	//Render passes come from the graph, writes binding 3 of every frame's global descriptor set
+	void init( VkEngine& engine, VkRenderPass pass );
+
+	//Collects the slots to redraw. Needs this frame's transforms and static chunks
+	void update( VkEngine& engine );
+
+	void record_static( VkEngine& engine, VkCommandBuffer cmd );
+	void record_copy( VkEngine& engine, VkCommandBuffer cmd );
+	void record_dynamic( VkEngine& engine, VkCommandBuffer cmd );
+
+	//Whether the passes have anything to record this frame, the graph skips them otherwise
+	inline bool static_pending() const { return !static_updates.empty() && pipeline; }
+	inline bool copy_pending() const { return !dynamic_updates.empty(); }
+	inline bool dynamic_pending() const { return !dynamic_updates.empty() && pipeline; }
+
+	private:
+		VkPipelineLayout layout{ VK_NULL_HANDLE };
+		VkPipeline pipeline{ VK_NULL_HANDLE };
+
+		std::vector<uint32_t> static_updates;
+		std::vector<uint32_t> dynamic_updates;
+
+		VkRect2D face_rect( uint32_t slot, uint32_t face ) const;
+		void begin_face( VkCommandBuffer cmd, uint32_t slot, uint32_t face ) const;
+};
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+constexpr uint32_t HANDLE_INDEX_BITS = 20;
+
+// 32 bit handle: 20 bit slot index, 12 bit generation. Id 0 is never handed
+// out, a default constructed handle is invalid.
+// At most 2^20 slots can be live. The generation wraps after 4095 reuses of a
+// slot, a handle kept across that many removes of the same slot aliases again.
+template<typename T>
+struct Handle {
+	constexpr static uint32_t INDEX_BITS = HANDLE_INDEX_BITS;
+	constexpr static uint32_t INDEX_MASK = ( 1u << INDEX_BITS ) - 1;
+	constexpr static uint32_t GENERATION_MASK = ( 1u << ( 32 - INDEX_BITS )) - 1;
+
+	uint32_t id{ 0 };
+
+	inline uint32_t index() const { return id & INDEX_MASK; }
+	inline uint32_t generation() const { return id >> INDEX_BITS; }
+
+	inline explicit operator bool() const { return id != 0; }
+	inline bool operator==( const Handle& ) const = default;
+};
+
+// Slot index -> dense index, with the generation that handle ids are checked
+// against. Shared by everything that hands out handles to densely stored data.
+struct SlotTable {
+	constexpr static uint32_t INDEX_MASK = ( 1u << HANDLE_INDEX_BITS ) - 1;
+	constexpr static uint32_t GENERATION_MASK = ( 1u << ( 32 - HANDLE_INDEX_BITS )) - 1;
+
+	struct Slot {
+		uint32_t dense;
+		uint32_t generation;
+	};
+
+	std::vector<Slot> slots;
+	std::vector<uint32_t> free_slots;
+
+	//Id of a slot pointing at dense
+	inline uint32_t acquire( uint32_t dense ){
+		uint32_t slot;
+
+		if( free_slots.empty() ){
+			//The next index would spill into the generation bits
+			if( slots.size() > INDEX_MASK )
+				throw std::runtime_error( "Slot table is full" );
+
+			slot = slots.size();
+			slots.push_back({ 0, 1 });
+		} else {
+			slot = free_slots.back();
+			free_slots.pop_back();
+		}
+
+		slots[slot].dense = dense;
+		return id_of( slot );
+	}
+
+	//Ids of the slot stop resolving
+	inline void release( uint32_t slot ){
+		slots[slot].generation = ( slots[slot].generation + 1 ) & GENERATION_MASK;
+		if( slots[slot].generation == 0 )
+			slots[slot].generation = 1;
+
+		free_slots.push_back( slot );
+	}
+
+	inline bool contains( uint32_t id ) const {
+		uint32_t slot = id & INDEX_MASK;
+		return id != 0 && slot < slots.size() && slots[slot].generation == id >> HANDLE_INDEX_BITS;
+	}
+
+	inline uint32_t id_of( uint32_t slot ) const {
+		return ( slots[slot].generation << HANDLE_INDEX_BITS ) | slot;
+	}
+
+	//Dense index of a valid id
+	inline uint32_t& dense( uint32_t id ){
+		return slots[id & INDEX_MASK].dense;
+	}
+
+	inline uint32_t dense( uint32_t id ) const {
+		return slots[id & INDEX_MASK].dense;
+	}
+};
+
+// Values are stored densely (removal swaps with the last element), handles
+// go through a slot table. Removing bumps the slot generation, so stale
+// handles resolve to nullptr instead of aliasing a newer value.
+// Pointers returned by get() are only valid until the next insert/remove.
+template<typename T>
+struct SlotMap {
+	using handle_type = Handle<T>;
+
+	std::vector<T> data;
+	std::vector<uint32_t> dense_to_slot;
+	SlotTable table;
+
+	inline handle_type insert( T&& value ){
+		handle_type h{ table.acquire( data.size() )};
+
+		data.push_back( std::move( value ));
+		dense_to_slot.push_back( h.index() );
+
+		return h;
+	}
+
+	inline handle_type insert( const T& value ){
+		return insert( T( value ));
+	}
+
+	inline bool contains( handle_type h ) const {
+		return table.contains( h.id );
+	}
+
+	inline T* get( handle_type h ){
+		return contains( h ) ? &data[table.dense( h.id )] : nullptr;
+	}
+
+	inline bool remove( handle_type h ){
+		if( !contains( h ))
+			return false;
+
+		uint32_t dense = table.dense( h.id );
+		uint32_t last = data.size() - 1;
+
+		if( dense != last ){
+			data[dense] = std::move( data[last] );
+			dense_to_slot[dense] = dense_to_slot[last];
+			table.slots[dense_to_slot[last]].dense = dense;
+		}
+
+		data.pop_back();
+		dense_to_slot.pop_back();
+
+		table.release( h.index() );
+		return true;
+	}
+
+	//Handle of the value at data[dense]
+	inline handle_type handle_of( uint32_t dense ) const {
+		return handle_type{ table.id_of( dense_to_slot[dense] )};
+	}
+
+	inline size_t size() const { return data.size(); }
+
+	inline typename std::vector<T>::iterator begin(){ return data.begin(); }
+	inline typename std::vector<T>::iterator end(){ return data.end(); }
+};
+
+// Name -> handle, resolved once at load time so nothing hashes strings per frame
+template<typename T>
+struct NameTable {
+	std::unordered_map<std::string, Handle<T>> names;
+
+	inline void set( const std::string& name, Handle<T> h ){
+		names[name] = h;
+	}
+
+	inline Handle<T> find( const std::string& name ) const {
+		auto it = names.find( name );
+		return it == names.end() ? Handle<T>{} : it->second;
+	}
+
+	inline void erase( Handle<T> h ){
+		for( auto it = names.begin(); it != names.end(); ++it ){
+			if( it->second == h ){
+				names.erase( it );
+				return;
+			}
+		}
+	}
+};
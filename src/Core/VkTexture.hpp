@@ -2,8 +2,21 @@
 
 #include "Core/VkTypes.hpp"
 
+#include <cstdint>
+#include <vector>
+
 struct VkEngine;
 
 namespace vkutil {
+	//img is owned by the caller. Blocks until the GPU copy finished
 	bool load_image_file( VkEngine& engine, const char* path, AllocatedImage& img );
+	//Same for tightly packed RGBA8 pixels
+	void create_image( VkEngine& engine, const void* pixels, VkExtent3D extent, AllocatedImage& img );
+
+	//Stages of VkEngine::load_texture, safe on any thread
+	bool read_file( const char* path, std::vector<uint8_t>& data );
+	//RGBA8 pixels in a new CPU_ONLY staging buffer plus a matching sampled image, both owned by the caller
+	bool decode_image( VkEngine& engine, const std::vector<uint8_t>& data, AllocatedBuffer& staging, AllocatedImage& img, VkExtent3D& extent );
+	//Copies staging into mip 0 of img, which ends up SHADER_READ_ONLY_OPTIMAL
+	void record_image_copy( VkCommandBuffer cmd, const AllocatedBuffer& staging, const AllocatedImage& img, VkExtent3D extent );
 }
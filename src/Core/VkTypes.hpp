@@ -3,6 +3,29 @@
 #include <vulkan/vulkan.h>
 #include <vk_mem_alloc.h>
 
+#include <iostream>
+#include <stdexcept>
+
+//Relative path from the build directory to the repository root (shaders, assets)
+#ifdef NO_FILE_PREFIX
+	#define FILE_PREFIX
+#else
+	#if _WIN32
+		#define FILE_PREFIX "../../../../"
+	#else
+		#define FILE_PREFIX "../../"
+	#endif
+#endif
+
+#define VK_CHECK( x ) 											\
+	do { 														\
+		VkResult err = x; 										\
+		if( err ){ 												\
+			std::cout << "Vulkan error: " << err << std::endl; 	\
+			throw std::runtime_error( "Vulkan error" ); 		\
+		} 														\
+	}while( 0 )
+
 struct AllocatedBuffer {
 	VkBuffer buffer;
 	VmaAllocation allocation;
@@ -0,0 +1,71 @@
+#include "Core/VkUploads.hpp"
+
+#include "Core/VkEngine.hpp"
+#include "Core/VkTexture.hpp"
+
+void UploadQueue::ImageAwaiter::await_suspend( std::coroutine_handle<> h ){
+	upload.waiter = h;
+
+	std::lock_guard<std::mutex> guard( queue.lock );
+	queue.queued.push_back( &upload );
+}
+
+void UploadQueue::record( VkEngine& engine, VkCommandBuffer cmd ){
+	std::vector<ImageUpload*> batch;
+
+	{
+		std::lock_guard<std::mutex> guard( lock );
+
+		//At least one per frame, even if it is larger than the budget
+		VkDeviceSize bytes = 0;
+		while( !queued.empty() && ( batch.empty() || bytes < BYTES_PER_FRAME )){
+			ImageUpload* up = queued.front();
+			bytes += static_cast<VkDeviceSize>( up->extent.width ) * up->extent.height * 4;
+
+			batch.push_back( up );
+			queued.pop_front();
+		}
+	}
+
+	if( batch.empty() )
+		return;
+
+	//Later submissions on the queue are ordered after the copies, the images can be used from the next frame on
+	for( ImageUpload* up: batch ){
+		vkutil::record_image_copy( cmd, up->staging, up->image, up->extent );
+
+		//Freed once this frame's fence signalled
+		engine.retire( up->staging );
+		up->copied = true;
+	}
+
+	recorded.insert( recorded.end(), batch.begin(), batch.end() );
+}
+
+void UploadQueue::resume_recorded(){
+	//Resumed coroutines may queue further uploads, which wait for the next record()
+	std::vector<ImageUpload*> ready;
+	ready.swap( recorded );
+
+	for( ImageUpload* up: ready )
+		up->waiter.resume();
+}
+
+void UploadQueue::cancel(){
+	resume_recorded();
+
+	std::deque<ImageUpload*> dropped;
+
+	{
+		std::lock_guard<std::mutex> guard( lock );
+		dropped.swap( queued );
+	}
+
+	for( ImageUpload* up: dropped )
+		up->waiter.resume();
+}
+
+size_t UploadQueue::pending_count(){
+	std::lock_guard<std::mutex> guard( lock );
+	return queued.size() + recorded.size();
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "VkTypes.hpp"
+
+#include <coroutine>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+struct VkEngine;
+
+struct ImageUpload {
+	AllocatedBuffer staging;
+	AllocatedImage image;
+	VkExtent3D extent;
+
+	std::coroutine_handle<> waiter;
+	bool copied{ false };
+};
+
+/*
+ * GPU copies requested by loading coroutines from any thread. record() runs
+ * as the first pass of the frame and copies at most BYTES_PER_FRAME, so a
+ * scene load streams in over several frames instead of stalling one. The
+ * waiting coroutines continue on the render thread at the start of a later
+ * frame, before anything of it is recorded, so swapping resources in is
+ * atomic as far as any frame is concerned.
+ */
+struct UploadQueue {
+	constexpr static VkDeviceSize BYTES_PER_FRAME = 32 * 1024 * 1024;
+
+	struct ImageAwaiter {
+		UploadQueue& queue;
+		ImageUpload upload;
+
+		inline bool await_ready() noexcept { return false; }
+		void await_suspend( std::coroutine_handle<> h );
+		//False if the engine shut down first, staging and image are then the caller's again
+		inline bool await_resume() noexcept { return upload.copied; }
+	};
+
+	//co_await copies staging (tightly packed RGBA8) into mip 0 of image, which ends up SHADER_READ_ONLY_OPTIMAL
+	inline ImageAwaiter upload_image( AllocatedBuffer staging, AllocatedImage image, VkExtent3D extent ){
+		return ImageAwaiter{ *this, ImageUpload{ .staging = staging, .image = image, .extent = extent }};
+	}
+
+	void record( VkEngine& engine, VkCommandBuffer cmd );
+	//Start of the frame, the copies recorded before went out with an earlier submission
+	void resume_recorded();
+	//After vkDeviceWaitIdle at shutdown: recorded copies finish, queued ones are cancelled
+	void cancel();
+
+	//Uploads whose coroutine has not continued yet, render thread only
+	size_t pending_count();
+
+	private:
+		std::mutex lock;
+		std::deque<ImageUpload*> queued;
+
+		//Render thread only
+		std::vector<ImageUpload*> recorded;
+};
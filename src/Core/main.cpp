@@ -1,9 +1,49 @@
 #include "Core/VkEngine.hpp"
 
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
 int main( int argc, char** argv ){
 	VkEngine e;
 
+	//--validate-fog renders until the fog is computed, compares it with the CPU reference and exits
+	bool validate_fog = false;
+	//--validate-scene moves and removes the token, checking the hierarchy, and exits
+	bool validate_scene = false;
+	std::vector<char*> args;
+
+	for( int i = 1; i < argc; ++i ){
+		if( std::strcmp( argv[i], "--validate-fog" ) == 0 )
+			validate_fog = true;
+		else if( std::strcmp( argv[i], "--validate-scene" ) == 0 )
+			validate_scene = true;
+		else
+			args.push_back( argv[i] );
+	}
+
+	//Optional first argument: frames in flight
+	if( args.size() > 0 ){
+		e.frame_overlap = std::atoi( args[0] );
+	}
+
+	//Optional second argument: texture budget in MiB, 0 follows the driver's budget
+	if( args.size() > 1 ){
+		e.residency.budget_bytes = static_cast<VkDeviceSize>( std::atoll( args[1] )) << 20;
+	}
+
 	e.init();
-	e.run();
+
+	int status = EXIT_SUCCESS;
+
+	if( validate_fog ){
+		status = e.validate_fog() ? EXIT_SUCCESS : EXIT_FAILURE;
+	} else if( validate_scene ){
+		status = e.validate_scene() ? EXIT_SUCCESS : EXIT_FAILURE;
+	} else {
+		e.run();
+	}
+
 	e.deinit();
+	return status;
 }
@@ -0,0 +1,178 @@
+#include "Jobs/JobSystem.hpp"
+
+#include <algorithm>
+
+//Worker index of the calling thread in the pool that owns it, -1 outside of any pool
+static thread_local const JobSystem* current_system = nullptr;
+static thread_local int32_t current_worker = -1;
+
+void JobSystem::init( uint32_t worker_count ){
+	if( worker_count == 0 )
+		worker_count = std::max( std::thread::hardware_concurrency(), 2u ) - 1;
+
+	stopping = false;
+
+	workers.reserve( worker_count );
+	for( uint32_t w = 0; w < worker_count; ++w )
+		workers.push_back( std::make_unique<Worker>() );
+
+	//Started once every deque exists, workers steal from all of them
+	for( uint32_t w = 0; w < worker_count; ++w )
+		workers[w]->thread = std::thread( &JobSystem::worker_main, this, static_cast<int32_t>( w ));
+}
+
+void JobSystem::deinit(){
+	//Whatever is still queued runs before the workers leave
+	while( run_one( -1 ))
+		continue;
+
+	{
+		std::lock_guard<std::mutex> guard( sleep_lock );
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for( auto& w: workers )
+		w->thread.join();
+
+	workers.clear();
+}
+
+JobHandle JobSystem::submit( std::function<void()> fn, std::initializer_list<JobHandle> dependencies ){
+	JobHandle job = std::make_shared<Job>();
+	job->fn = std::move( fn );
+
+	for( auto& dep: dependencies ){
+		if( !dep )
+			continue;
+
+		std::lock_guard<std::mutex> guard( dep->lock );
+		if( !dep->completed ){
+			job->blockers.fetch_add( 1 );
+			dep->continuations.push_back( job );
+		}
+	}
+
+	//Drops the submission guard, if every dependency already finished the job is ready now
+	if( job->blockers.fetch_sub( 1 ) == 1 )
+		schedule( job );
+
+	return job;
+}
+
+void JobSystem::schedule( JobHandle job ){
+	//Counted under the queue lock, so nobody takes the job before it is counted
+	if( current_system == this && current_worker >= 0 ){
+		Worker& w = *workers[current_worker];
+		std::lock_guard<std::mutex> guard( w.lock );
+		queued.fetch_add( 1 );
+		w.jobs.push_back( std::move( job ));
+	} else {
+		std::lock_guard<std::mutex> guard( shared_lock );
+		queued.fetch_add( 1 );
+		shared.push_back( std::move( job ));
+	}
+
+	{
+		std::lock_guard<std::mutex> guard( sleep_lock );
+	}
+	wake.notify_one();
+}
+
+void JobSystem::finish( const JobHandle& job ){
+	std::vector<JobHandle> ready;
+
+	{
+		std::lock_guard<std::mutex> guard( job->lock );
+		job->completed = true;
+		ready.swap( job->continuations );
+	}
+
+	//Frees captures before anyone waiting on the job wakes up
+	job->fn = nullptr;
+	job->finished.store( true, std::memory_order_release );
+
+	for( auto& cont: ready ){
+		if( cont->blockers.fetch_sub( 1 ) == 1 )
+			schedule( std::move( cont ));
+	}
+}
+
+JobHandle JobSystem::take( int32_t self ){
+	if( self >= 0 ){
+		Worker& w = *workers[self];
+		std::lock_guard<std::mutex> guard( w.lock );
+
+		if( !w.jobs.empty() ){
+			JobHandle job = std::move( w.jobs.back() );
+			w.jobs.pop_back();
+			return job;
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> guard( shared_lock );
+
+		if( !shared.empty() ){
+			JobHandle job = std::move( shared.front() );
+			shared.pop_front();
+			return job;
+		}
+	}
+
+	//Oldest job of another worker, it likely spawned the most work below it
+	size_t count = workers.size();
+	for( size_t i = 1; i <= count; ++i ){
+		Worker& victim = *workers[( self + i ) % count];
+		std::lock_guard<std::mutex> guard( victim.lock );
+
+		if( !victim.jobs.empty() ){
+			JobHandle job = std::move( victim.jobs.front() );
+			victim.jobs.pop_front();
+			return job;
+		}
+	}
+
+	return nullptr;
+}
+
+bool JobSystem::run_one( int32_t self ){
+	if( queued.load() == 0 )
+		return false;
+
+	JobHandle job = take( self );
+	if( !job )
+		return false;
+
+	queued.fetch_sub( 1 );
+
+	job->fn();
+	finish( job );
+
+	return true;
+}
+
+void JobSystem::wait( const JobHandle& job ){
+	int32_t self = current_system == this ? current_worker : -1;
+
+	while( !done( job )){
+		if( !run_one( self ))
+			std::this_thread::yield();
+	}
+}
+
+void JobSystem::worker_main( int32_t self ){
+	current_system = this;
+	current_worker = self;
+
+	while( true ){
+		if( run_one( self ))
+			continue;
+
+		std::unique_lock<std::mutex> guard( sleep_lock );
+		wake.wait( guard, [&]{ return stopping || queued.load() > 0; });
+
+		if( stopping && queued.load() == 0 )
+			return;
+	}
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Job {
+	std::function<void()> fn;
+
+	//Dependencies still running, plus one while the job is being submitted
+	std::atomic<uint32_t> blockers{ 1 };
+	std::atomic<bool> finished{ false };
+
+	//Jobs waiting on this one, scheduled when it finishes
+	std::mutex lock;
+	std::vector<std::shared_ptr<Job>> continuations;
+	bool completed{ false };
+};
+
+using JobHandle = std::shared_ptr<Job>;
+
+/*
+ * Engine wide thread pool. Every worker owns a deque, it pushes and pops
+ * its own jobs at the back (newest first, the data is still in cache) and
+ * steals from the front of the others when it runs dry. Jobs submitted from
+ * threads outside the pool go to a shared queue.
+ *
+ * A job may depend on other jobs and only starts once all of them finished.
+ * Waiting threads run queued jobs instead of blocking, so waiting inside a
+ * job is fine and a pool without workers still makes progress.
+ */
+struct JobSystem {
+	//0 picks one worker less than the hardware threads, the main thread helps out while waiting
+	void init( uint32_t worker_count = 0 );
+	//Finishes queued jobs, then joins the workers
+	void deinit();
+
+	uint32_t worker_count() const { return static_cast<uint32_t>( workers.size() ); }
+
+	JobHandle submit( std::function<void()> fn, std::initializer_list<JobHandle> dependencies = {} );
+	//Runs fn once dependency finished
+	inline JobHandle then( const JobHandle& dependency, std::function<void()> fn ){
+		return submit( std::move( fn ), { dependency });
+	}
+
+	//Empty handles count as finished
+	inline bool done( const JobHandle& job ) const {
+		return !job || job->finished.load( std::memory_order_acquire );
+	}
+
+	void wait( const JobHandle& job );
+
+	//f( first, count ) over [0, count) in ranges of at most grain, returns once all ran
+	template<typename F>
+	void parallel_for( uint32_t count, uint32_t grain, F&& f ){
+		grain = grain ? grain : 1;
+		uint32_t ranges = ( count + grain - 1 ) / grain;
+
+		if( ranges <= 1 || workers.empty() ){
+			for( uint32_t first = 0; first < count; first += grain )
+				f( first, std::min( grain, count - first ));
+			return;
+		}
+
+		//Ranges are claimed from a shared counter, so late helpers find nothing left and return at once
+		std::atomic<uint32_t> next{ 0 };
+
+		auto run = [&](){
+			for( uint32_t r = next.fetch_add( 1 ); r < ranges; r = next.fetch_add( 1 )){
+				uint32_t first = r * grain;
+				f( first, std::min( grain, count - first ));
+			}
+		};
+
+		std::vector<JobHandle> helpers;
+		uint32_t helper_count = std::min<uint32_t>( worker_count(), ranges - 1 );
+		helpers.reserve( helper_count );
+
+		for( uint32_t h = 0; h < helper_count; ++h )
+			helpers.push_back( submit( run ));
+
+		run();
+
+		for( auto& h: helpers )
+			wait( h );
+	}
+
+	private:
+		struct Worker {
+			std::mutex lock;
+			std::deque<JobHandle> jobs;
+			std::thread thread;
+		};
+
+		std::vector<std::unique_ptr<Worker>> workers;
+
+		std::mutex shared_lock;
+		std::deque<JobHandle> shared;
+
+		//Jobs sitting in any queue, sleeping workers wake up when it rises
+		std::atomic<uint32_t> queued{ 0 };
+		std::mutex sleep_lock;
+		std::condition_variable wake;
+		bool stopping{ false };
+
+		void schedule( JobHandle job );
+		void finish( const JobHandle& job );
+		JobHandle take( int32_t self );
+		bool run_one( int32_t self );
+		void worker_main( int32_t self );
+};
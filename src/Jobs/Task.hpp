@@ -0,0 +1,119 @@
+#pragma once
+
+#include "Jobs/JobSystem.hpp"
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <utility>
+
+/*
+ * Coroutine that starts running as soon as it is called. co_await on a Task
+ * continues the awaiting coroutine on whichever thread finished the task, at
+ * most one coroutine may wait on it. Dropping a Task detaches it, the frame is
+ * freed by the last of the Task object and the finished coroutine.
+ */
+template<typename T>
+struct Task {
+	struct promise_type;
+	using handle_type = std::coroutine_handle<promise_type>;
+
+	struct FinalAwaiter {
+		inline bool await_ready() noexcept { return false; }
+
+		inline std::coroutine_handle<> await_suspend( handle_type h ) noexcept {
+			void* waiter = h.promise().waiter.exchange( done_marker(), std::memory_order_acq_rel );
+			release( h );
+
+			if( waiter )
+				return std::coroutine_handle<>::from_address( waiter );
+			return std::noop_coroutine();
+		}
+
+		inline void await_resume() noexcept {}
+	};
+
+	struct promise_type {
+		std::optional<T> value;
+		std::exception_ptr error;
+
+		//Awaiting coroutine while running, done_marker() once finished
+		std::atomic<void*> waiter{ nullptr };
+		//Task object and coroutine
+		std::atomic<uint32_t> refs{ 2 };
+
+		inline Task get_return_object(){ return Task{ handle_type::from_promise( *this )}; }
+		inline std::suspend_never initial_suspend() noexcept { return {}; }
+		inline FinalAwaiter final_suspend() noexcept { return {}; }
+
+		template<typename U>
+		inline void return_value( U&& v ){ value.emplace( std::forward<U>( v )); }
+		inline void unhandled_exception(){ error = std::current_exception(); }
+	};
+
+	Task() = default;
+	inline Task( Task&& o ) noexcept : h( std::exchange( o.h, {})) {}
+	inline Task& operator=( Task&& o ) noexcept {
+		if( this != &o ){
+			if( h )
+				release( h );
+			h = std::exchange( o.h, {});
+		}
+		return *this;
+	}
+	inline ~Task(){
+		if( h )
+			release( h );
+	}
+
+	Task( const Task& ) = delete;
+	Task& operator=( const Task& ) = delete;
+
+	inline bool done() const {
+		return h && h.promise().waiter.load( std::memory_order_acquire ) == done_marker();
+	}
+
+	inline bool await_ready() const noexcept { return done(); }
+
+	//False if the task finished in the meantime, the awaiting coroutine then just continues
+	inline bool await_suspend( std::coroutine_handle<> awaiting ) noexcept {
+		void* expected = nullptr;
+		return h.promise().waiter.compare_exchange_strong( expected, awaiting.address(), std::memory_order_acq_rel, std::memory_order_acquire );
+	}
+
+	inline T await_resume(){
+		if( h.promise().error )
+			std::rethrow_exception( h.promise().error );
+		return std::move( *h.promise().value );
+	}
+
+	private:
+		handle_type h{};
+
+		inline explicit Task( handle_type handle ): h( handle ) {}
+
+		static inline void* done_marker(){
+			static char marker;
+			return &marker;
+		}
+
+		static inline void release( handle_type handle ){
+			if( handle.promise().refs.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+				handle.destroy();
+		}
+};
+
+//co_await resume_on( jobs ) continues the coroutine as a job
+inline auto resume_on( JobSystem& jobs ){
+	struct Awaiter {
+		JobSystem& jobs;
+
+		inline bool await_ready() noexcept { return false; }
+		inline void await_suspend( std::coroutine_handle<> h ){ jobs.submit( [h]{ h.resume(); }); }
+		inline void await_resume() noexcept {}
+	};
+
+	return Awaiter{ jobs };
+}
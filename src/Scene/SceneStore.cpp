@@ -0,0 +1,305 @@
+#include "Scene/SceneStore.hpp"
+
+#include "Core/VkEngine.hpp"
+
+#include <glm/glm.hpp>
+
+#include <type_traits>
+
+std::array<glm::vec4, 6> extract_frustum( const glm::mat4& view_proj ){
+	auto row = [&]( int i ){
+		return glm::vec4{ view_proj[0][i], view_proj[1][i], view_proj[2][i], view_proj[3][i] };
+	};
+
+	//Vulkan clip space, z in [0, w]
+	std::array<glm::vec4, 6> planes{
+		row( 3 ) + row( 0 ),
+		row( 3 ) - row( 0 ),
+		row( 3 ) + row( 1 ),
+		row( 3 ) - row( 1 ),
+		row( 2 ),
+		row( 3 ) - row( 2 ),
+	};
+
+	for( auto& p: planes )
+		p /= glm::length( glm::vec3{ p });
+
+	return planes;
+}
+
+Entity SceneStore::create( const glm::mat4& transform, Handle<Mesh> mesh, Handle<Material> mat, const glm::vec4& bounds, Entity parent ){
+	//Appending keeps the order topological, the parent already exists
+	Entity e{ table.acquire( size() )};
+
+	local.push_back( transform );
+	world.push_back( transform );
+	parents.push_back( alive( parent ) ? index_of( parent ) : NO_PARENT );
+	local_bounds.push_back( bounds );
+	world_bounds.push_back( bounds );
+	render.push_back({ mesh, mat });
+	flags.push_back( ENTITY_VISIBLE | ENTITY_CASTS_SHADOW | ENTITY_DIRTY );
+	tokens.push_back({});
+	lods.push_back( 0 );
+	dense_to_slot.push_back( e.index() );
+
+	layout_changed = true;
+
+	return e;
+}
+
+void SceneStore::destroy( Entity e ){
+	if( !alive( e ))
+		return;
+
+	uint32_t root = index_of( e );
+
+	//Descendants come after their ancestors, one sweep finds the whole subtree
+	std::vector<bool> removed( size(), false );
+	removed[root] = true;
+
+	for( uint32_t i = root + 1; i < size(); ++i ){
+		if( parents[i] != NO_PARENT && removed[parents[i]] )
+			removed[i] = true;
+	}
+
+	std::vector<uint32_t> order;
+	order.reserve( size() );
+
+	for( uint32_t i = 0; i < size(); ++i ){
+		if( !removed[i] )
+			order.push_back( i );
+		else if( flags[i] & ENTITY_CASTS_SHADOW )
+			moved_casters.push_back( world_bounds[i] );
+	}
+
+	reorder( order );
+}
+
+bool SceneStore::alive( Entity e ) const {
+	return table.contains( e.id );
+}
+
+uint32_t SceneStore::index_of( Entity e ) const {
+	return alive( e ) ? table.dense( e.id ) : UINT32_MAX;
+}
+
+Entity SceneStore::entity_at( uint32_t index ) const {
+	return Entity{ table.id_of( dense_to_slot[index] )};
+}
+
+void SceneStore::set_transform( Entity e, const glm::mat4& transform ){
+	uint32_t i = index_of( e );
+	if( i == UINT32_MAX )
+		return;
+
+	local[i] = transform;
+	flags[i] |= ENTITY_DIRTY;
+}
+
+void SceneStore::set_hidden( Entity e, bool hidden ){
+	uint32_t i = index_of( e );
+	if( i == UINT32_MAX )
+		return;
+
+	flags[i] = hidden ? ( flags[i] | ENTITY_HIDDEN ) : ( flags[i] & ~ENTITY_HIDDEN );
+	//Shadows around it have to be redrawn
+	flags[i] |= ENTITY_DIRTY;
+	layout_changed = true;
+}
+
+bool SceneStore::set_parent( Entity e, Entity parent ){
+	uint32_t i = index_of( e );
+	if( i == UINT32_MAX )
+		return false;
+
+	uint32_t p = alive( parent ) ? index_of( parent ) : NO_PARENT;
+
+	for( uint32_t a = p; a != NO_PARENT; a = parents[a] ){
+		if( a == i )
+			return false;
+	}
+
+	parents[i] = p;
+	flags[i] |= ENTITY_DIRTY;
+
+	if( p == NO_PARENT || p < i )
+		return true;
+
+	//The new parent comes after e, sorting by depth restores a topological order
+	std::vector<uint32_t> depth( size(), 0 );
+	for( uint32_t n = 0; n < size(); ++n ){
+		for( uint32_t a = parents[n]; a != NO_PARENT; a = parents[a] )
+			++depth[n];
+	}
+
+	std::vector<uint32_t> order( size() );
+	for( uint32_t n = 0; n < size(); ++n )
+		order[n] = n;
+
+	std::stable_sort( order.begin(), order.end(), [&]( uint32_t a, uint32_t b ){
+			return depth[a] < depth[b];
+		});
+
+	reorder( order );
+	return true;
+}
+
+void SceneStore::reorder( const std::vector<uint32_t>& order ){
+	std::vector<uint32_t> remap( size(), NO_PARENT );
+	for( uint32_t n = 0; n < order.size(); ++n )
+		remap[order[n]] = n;
+
+	for( uint32_t old = 0; old < size(); ++old ){
+		if( remap[old] != NO_PARENT )
+			continue;
+
+		table.release( dense_to_slot[old] );
+	}
+
+	auto apply = [&]( auto& v ){
+		std::remove_reference_t<decltype( v )> sorted;
+		sorted.reserve( order.size() );
+
+		for( auto o: order )
+			sorted.push_back( v[o] );
+
+		v = std::move( sorted );
+	};
+
+	apply( local );
+	apply( world );
+	apply( parents );
+	apply( local_bounds );
+	apply( world_bounds );
+	apply( render );
+	apply( flags );
+	apply( tokens );
+	apply( lods );
+	apply( dense_to_slot );
+
+	for( uint32_t n = 0; n < size(); ++n ){
+		if( parents[n] != NO_PARENT )
+			parents[n] = remap[parents[n]];
+
+		table.slots[dense_to_slot[n]].dense = n;
+	}
+
+	layout_changed = true;
+}
+
+void SceneStore::update_transforms(){
+	for( uint32_t i = 0; i < size(); ++i ){
+		uint32_t p = parents[i];
+
+		//Parents are visited first, so their dirty bit is already final
+		if( p != NO_PARENT && ( flags[p] & ENTITY_DIRTY ))
+			flags[i] |= ENTITY_DIRTY;
+
+		if( !( flags[i] & ENTITY_DIRTY ))
+			continue;
+
+		world[i] = p == NO_PARENT ? local[i] : world[p] * local[i];
+
+		const glm::mat4& m = world[i];
+		const glm::vec4& b = local_bounds[i];
+
+		float scale = std::max({
+				glm::length( glm::vec3{ m[0] }),
+				glm::length( glm::vec3{ m[1] }),
+				glm::length( glm::vec3{ m[2] })});
+
+		glm::vec4 center = m * glm::vec4{ b.x, b.y, b.z, 1.0f };
+
+		if( flags[i] & ENTITY_CASTS_SHADOW )
+			moved_casters.push_back( world_bounds[i] );
+
+		world_bounds[i] = glm::vec4{ center.x, center.y, center.z, b.w * scale };
+
+		if( flags[i] & ENTITY_CASTS_SHADOW )
+			moved_casters.push_back( world_bounds[i] );
+
+		moved.push_back( i );
+	}
+
+	for_each_batch( [&]( uint32_t first, uint32_t count ){
+			for( uint32_t i = first; i < first + count; ++i )
+				flags[i] &= ~ENTITY_DIRTY;
+		});
+}
+
+uint32_t SceneStore::validate() const {
+	uint32_t errors = 0;
+
+	for( uint32_t i = 0; i < size(); ++i ){
+		uint32_t p = parents[i];
+		glm::mat4 expected = p == NO_PARENT ? local[i] : world[p] * local[i];
+
+		float diff = 0.0f;
+		for( int c = 0; c < 4; ++c )
+			diff = std::max( diff, glm::length( expected[c] - world[i][c] ));
+
+		if(( p != NO_PARENT && p >= i ) || diff > 1e-4f || index_of( entity_at( i )) != i )
+			++errors;
+	}
+
+	return errors;
+}
+
+void SceneStore::cull( const glm::mat4& view_proj, JobSystem& jobs ){
+	auto planes = extract_frustum( view_proj );
+
+	for_each_batch( jobs, [&]( uint32_t first, uint32_t count ){
+			const glm::vec4* bounds = world_bounds.data() + first;
+			uint8_t* f = flags.data() + first;
+
+			//Branch free inner loop over one batch, vectorizes per plane
+			for( uint32_t i = 0; i < count; ++i ){
+				bool inside = true;
+
+				for( auto& p: planes )
+					inside &= p.x * bounds[i].x + p.y * bounds[i].y + p.z * bounds[i].z + p.w >= -bounds[i].w;
+
+				f[i] = ( f[i] & ~ENTITY_VISIBLE ) | ( inside ? ENTITY_VISIBLE : 0 );
+			}
+		});
+}
+
+void SceneStore::select_lods( SlotMap<Mesh>& meshes, const glm::mat4& view, float focal_pixels, JobSystem& jobs ){
+	for_each_batch( jobs, [&]( uint32_t first, uint32_t count ){
+			for( uint32_t i = first; i < first + count; ++i ){
+				if(( flags[i] & ( ENTITY_VISIBLE | ENTITY_HIDDEN )) != ENTITY_VISIBLE )
+					continue;
+
+				Mesh* mesh = meshes.get( render[i].mesh );
+				if( !mesh )
+					continue;
+
+				const glm::vec4& b = world_bounds[i];
+
+				//Nearest point of the bounds, object space errors grow with the entity's scale
+				float depth = std::max( -( view * glm::vec4{ b.x, b.y, b.z, 1.0f }).z - b.w, 0.01f );
+				float scale = local_bounds[i].w > 0.0f ? b.w / local_bounds[i].w : 1.0f;
+
+				lods[i] = select_lod( *mesh, focal_pixels * scale / depth, lods[i] );
+			}
+		});
+}
+
+void SceneStore::gather_visible( std::vector<RenderableObject>& out ){
+	out.clear();
+
+	for_each_batch( [&]( uint32_t first, uint32_t count ){
+			for( uint32_t i = first; i < first + count; ++i ){
+				if(( flags[i] & ( ENTITY_VISIBLE | ENTITY_HIDDEN )) != ENTITY_VISIBLE )
+					continue;
+
+				out.push_back( RenderableObject{
+						.mesh = render[i].mesh,
+						.mat = render[i].mat,
+						.transform = world[i],
+						.bounds = world_bounds[i],
+						.lod = lods[i],
+					});
+			}
+		});
+}
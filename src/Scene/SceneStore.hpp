@@ -0,0 +1,126 @@
+#pragma once
+
+#include "Core/VkMesh.hpp"
+#include "Core/VkSlotMap.hpp"
+#include "Jobs/JobSystem.hpp"
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+struct Material;
+struct RenderableObject;
+struct SceneEntity;
+
+using Entity = Handle<SceneEntity>;
+
+enum EntityFlags : uint8_t {
+	ENTITY_VISIBLE = 1 << 0,	//Result of the last cull()
+	ENTITY_HIDDEN = 1 << 1,		//Never drawn, e.g. a token hidden by the GM
+	ENTITY_CASTS_SHADOW = 1 << 2,
+	ENTITY_DIRTY = 1 << 3,		//Local transform changed since the last update_transforms()
+};
+
+struct RenderHandles {
+	Handle<Mesh> mesh;
+	Handle<Material> mat;
+};
+
+struct TokenInfo {
+	uint32_t owner{ 0 };
+	uint32_t layer{ 0 };
+};
+
+/*
+ * Components live in parallel arrays indexed by a dense index, so a pass only
+ * touches the arrays it needs. Entities keep their id while the dense index
+ * changes.
+ *
+ * The arrays are kept in topological order (every parent before its
+ * children), so update_transforms() is a single forward sweep and world
+ * is contiguous, ready to be copied to the GPU as is.
+ */
+struct SceneStore {
+	//64 entities: one cache line of flags, a multiple of every SIMD width
+	constexpr static uint32_t BATCH_SIZE = 64;
+	//Entities per job, small sweeps are not worth waking workers for
+	constexpr static uint32_t JOB_GRAIN = BATCH_SIZE * 32;
+	constexpr static uint32_t NO_PARENT = UINT32_MAX;
+
+	std::vector<glm::mat4> local;
+	std::vector<glm::mat4> world;
+	std::vector<uint32_t> parents;			//Dense index or NO_PARENT
+	std::vector<glm::vec4> local_bounds;	//xyz center, w radius
+	std::vector<glm::vec4> world_bounds;
+	std::vector<RenderHandles> render;
+	std::vector<uint8_t> flags;
+	std::vector<TokenInfo> tokens;
+	std::vector<uint8_t> lods;				//Level of detail drawn last, kept for hysteresis
+
+	//Old and new world bounds of shadow casters changed since the consumer last cleared it
+	std::vector<glm::vec4> moved_casters;
+	//Dense indices with a new world transform since the consumer last cleared it
+	std::vector<uint32_t> moved;
+	//Dense indices, render handles or ENTITY_HIDDEN changed, moved is meaningless until cleared
+	bool layout_changed{ true };
+
+	Entity create( const glm::mat4& transform, Handle<Mesh> mesh, Handle<Material> mat, const glm::vec4& bounds, Entity parent = {} );
+	//Destroys e and all its descendants
+	void destroy( Entity e );
+
+	bool alive( Entity e ) const;
+	//Dense index of e, only valid until the next create/destroy/set_parent
+	uint32_t index_of( Entity e ) const;
+	Entity entity_at( uint32_t index ) const;
+
+	//Transform relative to the parent
+	void set_transform( Entity e, const glm::mat4& transform );
+	void set_hidden( Entity e, bool hidden );
+	//Fails if parent is e or one of its descendants
+	bool set_parent( Entity e, Entity parent );
+
+	//Recomputes world matrices and bounds of dirty entities and their subtrees
+	void update_transforms();
+	//Entities after a parent, with a stale world matrix or a broken id, call after update_transforms()
+	uint32_t validate() const;
+
+	inline uint32_t size() const { return local.size(); }
+
+	//f( first, count ) for consecutive dense ranges of at most BATCH_SIZE
+	template<typename F>
+	inline void for_each_batch( F&& f ){
+		for( uint32_t first = 0; first < size(); first += BATCH_SIZE )
+			f( first, std::min( BATCH_SIZE, size() - first ));
+	}
+
+	//Same, with ranges of JOB_GRAIN entities spread over jobs. f must only touch its own range
+	template<typename F>
+	inline void for_each_batch( JobSystem& jobs, F&& f ){
+		jobs.parallel_for( size(), JOB_GRAIN, [&]( uint32_t first, uint32_t count ){
+				for( uint32_t end = first + count; first < end; first += BATCH_SIZE )
+					f( first, std::min( BATCH_SIZE, end - first ));
+			});
+	}
+
+	//Sets ENTITY_VISIBLE for every entity whose bounds touch the frustum of view_proj
+	void cull( const glm::mat4& view_proj, JobSystem& jobs );
+
+	//Picks the level of detail of every visible entity from its projected size
+	void select_lods( SlotMap<Mesh>& meshes, const glm::mat4& view, float focal_pixels, JobSystem& jobs );
+
+	//AoS view of the visible entities for draw_objects
+	void gather_visible( std::vector<RenderableObject>& out );
+
+	private:
+		std::vector<uint32_t> dense_to_slot;
+		SlotTable table;
+
+		//Rearranges every component array so that new index i holds old index order[i]. Entries not in order are dropped
+		void reorder( const std::vector<uint32_t>& order );
+};
+
+std::array<glm::vec4, 6> extract_frustum( const glm::mat4& view_proj );
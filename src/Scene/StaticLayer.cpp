@@ -0,0 +1,294 @@
+#include "Scene/StaticLayer.hpp"
+
+#include "Core/VkEngine.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+static AllocatedBuffer upload_buffer( VmaAllocator alloc, const void* data, size_t size, VkBufferUsageFlags usage ){
+	VkBufferCreateInfo buf_cr_inf{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.pNext = nullptr,
+		.size = size,
+		.usage = usage,
+	};
+
+	VmaAllocationCreateInfo vma_alloc_inf{
+		.usage = VMA_MEMORY_USAGE_CPU_TO_GPU,
+	};
+
+	AllocatedBuffer buf;
+	VK_CHECK( vmaCreateBuffer( alloc, &buf_cr_inf, &vma_alloc_inf, &buf.buffer, &buf.allocation, nullptr ));
+
+	void* mapped;
+	VK_CHECK( vmaMapMemory( alloc, buf.allocation, &mapped ));
+	memcpy( mapped, data, size );
+	vmaUnmapMemory( alloc, buf.allocation );
+
+	return buf;
+}
+
+//Runs as a job. Only touches its own copies and VMA, which is internally synchronized
+static std::unique_ptr<ChunkGeometry> bake_chunk(
+		VmaAllocator alloc,
+		std::vector<StaticInstance> instances,
+		std::unordered_map<uint32_t, std::vector<Vertex>> mesh_vertices ){
+
+	std::vector<uint32_t> order( instances.size() );
+	std::iota( order.begin(), order.end(), 0 );
+	std::stable_sort( order.begin(), order.end(), [&]( uint32_t a, uint32_t b ){
+			return instances[a].mat.id < instances[b].mat.id;
+		});
+
+	auto geo = std::make_unique<ChunkGeometry>();
+
+	std::vector<Vertex> vertices;
+
+	glm::vec3 min{ INFINITY }, max{ -INFINITY };
+
+	for( auto i: order ){
+		const StaticInstance& inst = instances[i];
+		const std::vector<Vertex>& src = mesh_vertices[inst.mesh.id];
+
+		if( geo->batches.empty() || geo->batches.back().mat != inst.mat ){
+			geo->batches.push_back( ChunkBatch{
+					.mat = inst.mat,
+					.first_vertex = static_cast<uint32_t>( vertices.size() ),
+					.vertex_count = 0,
+				});
+		}
+
+		glm::mat3 normal_mat{ inst.transform };
+
+		for( auto& v: src ){
+			Vertex w = v;
+			glm::vec4 p = inst.transform * glm::vec4{ v.pos, 1.0f };
+			w.pos = glm::vec3{ p };
+			w.normal = glm::normalize( normal_mat * v.normal );
+
+			min = glm::min( min, w.pos );
+			max = glm::max( max, w.pos );
+
+			vertices.push_back( w );
+		}
+
+		geo->batches.back().vertex_count += src.size();
+	}
+
+	if( vertices.empty() )
+		return nullptr;
+
+	glm::vec3 center = 0.5f * ( min + max );
+	geo->bounds = glm::vec4{ center, 0.5f * glm::length( max - min ) };
+
+	geo->staging = upload_buffer( alloc, vertices.data(), vertices.size() * sizeof( Vertex ), VK_BUFFER_USAGE_TRANSFER_SRC_BIT );
+	geo->vertex_count = vertices.size();
+
+	return geo;
+}
+
+uint64_t StaticLayer::chunk_key( const glm::mat4& transform ) const {
+	float chunk_size = cell_size * CHUNK_CELLS;
+
+	int32_t x = static_cast<int32_t>( std::floor( transform[3].x / chunk_size ));
+	int32_t z = static_cast<int32_t>( std::floor( transform[3].z / chunk_size ));
+
+	return ( static_cast<uint64_t>( static_cast<uint32_t>( x )) << 32 ) | static_cast<uint32_t>( z );
+}
+
+uint32_t StaticLayer::add( const StaticInstance& inst ){
+	uint32_t id = next_id++;
+	uint64_t key = chunk_key( inst.transform );
+
+	StaticChunk& chunk = chunks[key];
+	chunk.ids.push_back( id );
+	chunk.instances.push_back( inst );
+	++chunk.version;
+
+	id_to_chunk[id] = key;
+	return id;
+}
+
+void StaticLayer::remove( uint32_t id ){
+	auto it = id_to_chunk.find( id );
+	if( it == id_to_chunk.end() )
+		return;
+
+	StaticChunk& chunk = chunks[it->second];
+	auto pos = std::find( chunk.ids.begin(), chunk.ids.end(), id );
+	size_t i = pos - chunk.ids.begin();
+
+	chunk.ids[i] = chunk.ids.back();
+	chunk.instances[i] = chunk.instances.back();
+	chunk.ids.pop_back();
+	chunk.instances.pop_back();
+	++chunk.version;
+
+	id_to_chunk.erase( it );
+}
+
+void StaticLayer::update( VkEngine& engine ){
+	//Baked results still own their staging buffer, swapped in ones a range of the arena
+	auto retire = [&]( std::unique_ptr<ChunkGeometry>& geo ){
+		if( !geo )
+			return;
+
+		if( geo->staging.buffer )
+			engine.retire( geo->staging );
+		else
+			engine.geometry.release( engine, geo->base_vertex, geo->vertex_count );
+
+		geo.reset();
+	};
+
+	for( auto it = chunks.begin(); it != chunks.end(); ){
+		StaticChunk& chunk = it->second;
+
+		if( chunk.pending ){
+			if( !engine.jobs.done( chunk.pending )){
+				++it;
+				continue;
+			}
+
+			auto geo = std::move( *chunk.pending_result );
+			chunk.pending.reset();
+			chunk.pending_result.reset();
+
+			//Edited again while baking, this result is already outdated
+			if( chunk.pending_version != chunk.version ){
+				retire( geo );
+			} else {
+				if( geo ){
+					geo->base_vertex = engine.geometry.upload( engine, geo->staging, geo->vertex_count );
+					geo->staging = {};
+
+					if( geo->base_vertex == RangeAllocator::INVALID )
+						geo.reset();
+				}
+
+				if( chunk.geometry )
+					changed.push_back( chunk.geometry->bounds );
+				if( geo )
+					changed.push_back( geo->bounds );
+
+				retire( chunk.geometry );
+				chunk.geometry = std::move( geo );
+				chunk.built_version = chunk.pending_version;
+			}
+		}
+
+		if( chunk.built_version == chunk.version ){
+			++it;
+			continue;
+		}
+
+		//Last piece removed, nothing left to bake or draw
+		if( chunk.instances.empty() ){
+			if( chunk.geometry )
+				changed.push_back( chunk.geometry->bounds );
+
+			retire( chunk.geometry );
+			it = chunks.erase( it );
+			continue;
+		}
+
+		std::unordered_map<uint32_t, std::vector<Vertex>> mesh_vertices;
+		std::vector<StaticInstance> instances;
+		instances.reserve( chunk.instances.size() );
+
+		for( auto& inst: chunk.instances ){
+			Mesh* mesh = engine.meshes.get( inst.mesh );
+			if( !mesh )
+				continue;
+
+			if( !mesh_vertices.count( inst.mesh.id ))
+				mesh_vertices[inst.mesh.id].assign( mesh->vertices.begin(), mesh->vertices.begin() + mesh->lods[0].vertex_count );
+
+			instances.push_back( inst );
+		}
+
+		auto result = std::make_shared<std::unique_ptr<ChunkGeometry>>();
+		VmaAllocator alloc = engine.vma_alloc;
+
+		chunk.pending_version = chunk.version;
+		chunk.pending_result = result;
+		chunk.pending = engine.jobs.submit( [result, alloc, instances = std::move( instances ), mesh_vertices = std::move( mesh_vertices )]() mutable {
+				*result = bake_chunk( alloc, std::move( instances ), std::move( mesh_vertices ));
+			});
+
+		++it;
+	}
+}
+
+void StaticLayer::draw( VkEngine& engine, VkCommandBuffer cmd, const glm::mat4& view_proj ){
+	auto planes = extract_frustum( view_proj );
+
+	PushConstants consts{
+		.camera = glm::mat4{ 1.0f },
+	};
+
+	Handle<Material> last_mat{};
+	Pipeline* pipe = nullptr;
+
+	for( auto& [key, chunk]: chunks ){
+		ChunkGeometry* geo = chunk.geometry.get();
+		if( !geo )
+			continue;
+
+		bool inside = true;
+		for( auto& p: planes )
+			inside &= glm::dot( glm::vec3{ p }, glm::vec3{ geo->bounds }) + p.w >= -geo->bounds.w;
+
+		if( !inside )
+			continue;
+
+		for( auto& batch: geo->batches ){
+			if( batch.mat != last_mat ){
+				Material* mat = engine.materials.get( batch.mat );
+				pipe = mat ? engine.pipelines.get( mat->pipeline ) : nullptr;
+				last_mat = batch.mat;
+
+				if( !pipe )
+					continue;
+
+				vkCmdBindPipeline( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipe->pipeline );
+				vkCmdBindDescriptorSets( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipe->layout, 0, 1, &engine.get_curr_frame().global_desc, 0, nullptr );
+
+				engine.touch_texture( mat->texture );
+
+				if( mat->tex_set ){
+					vkCmdBindDescriptorSets( cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipe->layout, 1, 1, &mat->tex_set, 0, nullptr );
+				}
+
+				//Vertices are already in world space
+				vkCmdPushConstants( cmd, pipe->layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof( PushConstants ), &consts );
+			}
+
+			if( !pipe )
+				continue;
+
+			//Pulled from the geometry arena by the scene shaders
+			vkCmdDraw( cmd, batch.vertex_count, 1, geo->base_vertex + batch.first_vertex, 0 );
+		}
+	}
+}
+
+void StaticLayer::destroy( VkEngine& engine ){
+	for( auto& [key, chunk]: chunks ){
+		if( chunk.pending ){
+			engine.jobs.wait( chunk.pending );
+
+			auto& geo = *chunk.pending_result;
+			if( geo )
+				engine.deletion_queue.push( geo->staging );
+		}
+	}
+
+	//Ranges in the arena go with its buffer
+	chunks.clear();
+	id_to_chunk.clear();
+}
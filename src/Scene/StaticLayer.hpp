@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Core/VkMesh.hpp"
+#include "Core/VkSlotMap.hpp"
+#include "Jobs/JobSystem.hpp"
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+struct VkEngine;
+struct Material;
+
+struct StaticInstance {
+	Handle<Mesh> mesh;
+	Handle<Material> mat;
+	glm::mat4 transform;
+};
+
+//One draw per material in a chunk, first_vertex is relative to the chunk's range
+struct ChunkBatch {
+	Handle<Material> mat;
+	uint32_t first_vertex;
+	uint32_t vertex_count;
+};
+
+//Merged, world space geometry of one chunk. Immutable once built
+struct ChunkGeometry {
+	//Baked vertices, handed to the geometry arena when the chunk is swapped in
+	AllocatedBuffer staging{};
+	//Range in the geometry arena
+	uint32_t base_vertex{ 0 };
+	uint32_t vertex_count{ 0 };
+	std::vector<ChunkBatch> batches;
+	glm::vec4 bounds{};		//xyz center, w radius
+};
+
+struct StaticChunk {
+	std::vector<uint32_t> ids;
+	std::vector<StaticInstance> instances;
+
+	//What is drawn, replaced as a whole when a rebuild finishes
+	std::unique_ptr<ChunkGeometry> geometry;
+
+	uint32_t version{ 0 };
+	uint32_t built_version{ 0 };
+
+	//Bake on the engine's job system, pending_result is filled once it finished
+	JobHandle pending;
+	std::shared_ptr<std::unique_ptr<ChunkGeometry>> pending_result;
+	uint32_t pending_version{ 0 };
+};
+
+/*
+ * Static map geometry (terrain, walls, props) merged into square chunks of
+ * CHUNK_CELLS x CHUNK_CELLS cells. Edits mark a chunk dirty, update() bakes it
+ * as a job and swaps the result in between frames, copying it into the
+ * geometry arena. The previous range is released through the arena, chunks
+ * left without pieces are dropped.
+ */
+struct StaticLayer {
+	constexpr static int32_t CHUNK_CELLS = 16;
+	float cell_size{ 1.0f };
+
+	std::unordered_map<uint64_t, StaticChunk> chunks;
+
+	//Bounds of chunk geometry swapped in or out since the consumer last cleared it
+	std::vector<glm::vec4> changed;
+
+	uint32_t add( const StaticInstance& inst );
+	void remove( uint32_t id );
+
+	//Starts rebuilds of edited chunks and publishes finished ones
+	void update( VkEngine& engine );
+	void draw( VkEngine& engine, VkCommandBuffer cmd, const glm::mat4& view_proj );
+
+	//Waits for running bakes, staging buffers go to the engine deletion queue
+	void destroy( VkEngine& engine );
+
+	private:
+		uint32_t next_id{ 1 };
+		std::unordered_map<uint32_t, uint64_t> id_to_chunk;
+
+		uint64_t chunk_key( const glm::mat4& transform ) const;
+};